@@ -27,17 +27,41 @@
 #include <HTTPClient.h>
 #include "esp_timer.h"
 #include "driver/rtc_io.h"
+#include <WiFiUdp.h>
+
+// Announce the camera with a UDP heartbeat instead of the HTTP ping. The HTTP ping is still sent
+// when no heartbeat reply arrives, e.g. from a Pi that does not listen for heartbeats yet.
+#define USE_UDP_HEARTBEAT 1
 
 const char* ssid = "RASPNET";
 const char* password = "123456789";
 
 const char* PING_SERVER_URL = "http://10.42.0.1/cgi-bin/ping.cgi";
 
+// Heartbeat datagram, little-endian: magic "PMHB" (0), version (4), flags (5), RSSI in dBm (6),
+// reserved (7), device ID (8), sequence number (16), uptime in seconds (20). The reply repeats it
+// with HEARTBEAT_FLAG_REPLY set, followed by a length byte and the pending command. Must match
+// application.c.
+const IPAddress HEARTBEAT_SERVER_IP(10, 42, 0, 1);
+const uint16_t HEARTBEAT_PORT = 4210;
+const uint32_t HEARTBEAT_MAGIC = 0x42484d50;
+const uint8_t HEARTBEAT_VERSION = 1;
+const size_t HEARTBEAT_SIZE = 24;
+const uint8_t HEARTBEAT_FLAG_CAPTURE_READY = 0x01;
+const uint8_t HEARTBEAT_FLAG_REPLY = 0x80;
+const unsigned long HEARTBEAT_REPLY_TIMEOUT_MS = 500;
+
+WiFiUDP heartbeatUdp;
+uint32_t heartbeatSequence = 0;
+bool cameraReady = false;
+
 WebServer server(80);
 
 // Forward declarations
 void handleStillCapture();
+uint64_t deviceId();
 void sendPing();
+bool sendHeartbeat();
 void pingTask(void* pvParameters);
 void blinkLed(int pin, int count, int delay_ms, int active_state);
 
@@ -55,6 +79,78 @@ void handleStillCapture() {
   esp_camera_fb_return(fb);
 }
 
+// The MAC address as a number (e.g., "A0:B1:C2:D3:E4:F5" -> 0xA0B1C2D3E4F5), used as device ID
+uint64_t deviceId() {
+  String macAddressStr = WiFi.macAddress();
+
+  // Convert MAC address string to a clean hexadecimal string (e.g., "A0B1C2D3E4F5")
+  String cleanMacAddress = "";
+  for (int i = 0; i < macAddressStr.length(); i++) {
+    if (macAddressStr.charAt(i) != ':') {
+      cleanMacAddress += macAddressStr.charAt(i);
+    }
+  }
+  return strtoull(cleanMacAddress.c_str(), NULL, 16);
+}
+
+static void putLe32(uint8_t* p, uint32_t v) {
+  for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint32_t getLe32(const uint8_t* p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Sends one UDP heartbeat and waits briefly for the reply carrying the pending command.
+// Returns false if no matching reply arrived.
+bool sendHeartbeat() {
+  uint8_t packet[HEARTBEAT_SIZE] = {0};
+  uint64_t id = deviceId();
+  uint32_t sequence = ++heartbeatSequence;
+  putLe32(packet, HEARTBEAT_MAGIC);
+  packet[4] = HEARTBEAT_VERSION;
+  packet[5] = cameraReady ? HEARTBEAT_FLAG_CAPTURE_READY : 0;
+  packet[6] = (uint8_t)(int8_t)WiFi.RSSI();
+  putLe32(packet + 8, (uint32_t)id);
+  putLe32(packet + 12, (uint32_t)(id >> 32));
+  putLe32(packet + 16, sequence);
+  putLe32(packet + 20, (uint32_t)(esp_timer_get_time() / 1000000));
+
+  // Blink RED LED when sending the heartbeat (active LOW)
+  digitalWrite(RED_LED_GPIO_NUM, LOW);
+  delay(50);
+  digitalWrite(RED_LED_GPIO_NUM, HIGH);
+
+  while (heartbeatUdp.parsePacket() > 0) heartbeatUdp.flush();  // Drop late replies to earlier heartbeats
+  heartbeatUdp.beginPacket(HEARTBEAT_SERVER_IP, HEARTBEAT_PORT);
+  heartbeatUdp.write(packet, sizeof(packet));
+  if (!heartbeatUdp.endPacket()) {
+    Serial.println("Heartbeat send failed.");
+    return false;
+  }
+
+  unsigned long start = millis();
+  while (millis() - start < HEARTBEAT_REPLY_TIMEOUT_MS) {
+    int length = heartbeatUdp.parsePacket();
+    if (length <= 0) {
+      delay(5);
+      continue;
+    }
+    uint8_t reply[HEARTBEAT_SIZE + 1 + 64];
+    length = heartbeatUdp.read(reply, sizeof(reply));
+    if (length < (int)HEARTBEAT_SIZE + 1 || getLe32(reply) != HEARTBEAT_MAGIC || !(reply[5] & HEARTBEAT_FLAG_REPLY) ||
+        getLe32(reply + 16) != sequence || reply[HEARTBEAT_SIZE] > length - HEARTBEAT_SIZE - 1) {
+      continue;
+    }
+    String command = "";
+    for (int i = 0; i < reply[HEARTBEAT_SIZE]; i++) command += (char)reply[HEARTBEAT_SIZE + 1 + i];
+    Serial.printf("Heartbeat %u acknowledged in %lu ms. Command: %s\n", sequence, millis() - start, command.c_str());
+    return true;
+  }
+  Serial.printf("No reply to heartbeat %u.\n", sequence);
+  return false;
+}
+
 // Function to send the PING POST request
 void sendPing() {
   // Blink RED LED when sending ping (active LOW)
@@ -68,20 +164,9 @@ void sendPing() {
 
   // Get MAC address as string (e.g., "A0:B1:C2:D3:E4:F5")
   String macAddressStr = WiFi.macAddress();
-  
-  // Convert MAC address string to a clean hexadecimal string (e.g., "A0B1C2D3E4F5")
-  String cleanMacAddress = "";
-  for (int i = 0; i < macAddressStr.length(); i++) {
-    if (macAddressStr.charAt(i) != ':') {
-      cleanMacAddress += macAddressStr.charAt(i);
-    }
-  }
-  
-  // Convert the hexadecimal MAC string to a uint64_t numerical value
-  uint64_t macAsUint64 = strtoull(cleanMacAddress.c_str(), NULL, 16);
-  
-  // Convert the uint64_t numerical value to a decimal string for the POST body
-  String postBody = String(macAsUint64);
+
+  // Convert the numerical MAC address to a decimal string for the POST body
+  String postBody = String(deviceId());
 
   // Add MAC address as a custom header for additional context/debugging
   http.addHeader("X-ESP32-MAC", macAddressStr);
@@ -102,7 +187,11 @@ void sendPing() {
 // FreeRTOS task for periodic PING requests
 void pingTask(void* pvParameters) {
   for (;;) {
+#if USE_UDP_HEARTBEAT
+    if (!sendHeartbeat()) sendPing();
+#else
     sendPing();
+#endif
     vTaskDelay(pdMS_TO_TICKS(10000));  // Delay for 10 seconds
   }
 }
@@ -167,6 +256,7 @@ void setup() {
     return;
   }
   Serial.println("Camera initialized successfully.");
+  cameraReady = true;
 
   WiFi.begin(ssid, password);
   WiFi.setSleep(false);
@@ -187,6 +277,10 @@ void setup() {
   server.begin();
   Serial.println("HTTP server started.");
 
+#if USE_UDP_HEARTBEAT
+  heartbeatUdp.begin(HEARTBEAT_PORT);
+#endif
+
   Serial.println("Creating ping task...");
   xTaskCreatePinnedToCore(
     pingTask,
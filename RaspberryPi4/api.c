@@ -0,0 +1,273 @@
+// Read-only JSON API for scripts and polling dashboards: GET /cgi-bin/api.cgi?resource=R with R one
+// of devices, plants (including each plant's latest metrics), timer or all (the default).
+//
+// Every response carries a strong ETag. While the application publishes the state segment
+// (plant_state.h) the tag is built from the writer's PID and the versions of the parts the resource
+// contains, so a conditional request is answered with 304 Not Modified from the segment header
+// alone, without formatting anything. Otherwise the tag is a hash of the data files' stat
+// signatures. Responses are sent with "Cache-Control: no-cache": clients may keep them but must
+// revalidate each time.
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <stdarg.h>
+#include <sys/stat.h>
+
+#include "plant_state.h"
+
+#define DEVICES_FILE "/var/www/html/data/devices.txt"
+#define PLANTS_FILE "/var/www/html/data/plants.txt"
+#define PROCESSES_FILE "/var/www/html/data/processes.txt"
+#define IMAGE_BASE_DIR "/var/www/html/data/images/"
+#define ETAG_MAX 128
+
+enum { RESOURCE_DEVICES = 1, RESOURCE_PLANTS = 2, RESOURCE_TIMER = 4, RESOURCE_ALL = 7 };
+
+static void log_cgi_message(const char *format, ...) {
+    time_t now = time(NULL);
+    struct tm *t = localtime(&now);
+    char ts[32];
+    strftime(ts, sizeof(ts), "%Y-%m-%d %H:%M:%S", t);
+    fprintf(stderr, "[%s] [API] ", ts);
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fprintf(stderr, "\n");
+}
+
+// Returns the RESOURCE_* mask named by the query string's resource parameter, or 0 if unknown.
+static int parse_resource(const char *query_string) {
+    if (!query_string) return RESOURCE_ALL;
+    char *qs_copy = strdup(query_string);
+    if (!qs_copy) return RESOURCE_ALL;
+    int resource = RESOURCE_ALL;
+    char *param_tok, *param_rest = qs_copy;
+    while ((param_tok = strtok_r(param_rest, "&", &param_rest))) {
+        char *val = strchr(param_tok, '=');
+        if (!val) continue;
+        *val++ = '\0';
+        if (strcmp(param_tok, "resource") != 0) continue;
+        if (strcmp(val, "devices") == 0) resource = RESOURCE_DEVICES;
+        else if (strcmp(val, "plants") == 0) resource = RESOURCE_PLANTS;
+        else if (strcmp(val, "timer") == 0) resource = RESOURCE_TIMER;
+        else if (strcmp(val, "all") == 0) resource = RESOURCE_ALL;
+        else resource = 0;
+        break;
+    }
+    free(qs_copy);
+    return resource;
+}
+
+static const char *resource_name(int resource) {
+    switch (resource) {
+        case RESOURCE_DEVICES: return "devices";
+        case RESOURCE_PLANTS: return "plants";
+        case RESOURCE_TIMER: return "timer";
+        default: return "all";
+    }
+}
+
+// 64-bit FNV-1a, for the file-based ETag.
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static uint64_t hash_file_signature(uint64_t hash, const char *path) {
+    struct stat st;
+    int64_t signature[5] = {0, 0, -1, 0, 0};
+    if (stat(path, &st) == 0) {
+        signature[0] = (int64_t)st.st_dev;
+        signature[1] = (int64_t)st.st_ino;
+        signature[2] = (int64_t)st.st_size;
+        signature[3] = (int64_t)st.st_mtim.tv_sec;
+        signature[4] = (int64_t)st.st_mtim.tv_nsec;
+    }
+    return fnv1a(hash, signature, sizeof(signature));
+}
+
+// Tag for a state snapshot. The segment's versions only grow while one application runs, and the
+// writer PID separates runs; the file hash covers the plants' series files for the metrics.
+static void make_etag(char *etag, size_t size, const PlantState *state, int from_segment, int resource) {
+    if (from_segment) {
+        int length = snprintf(etag, size, "\"s%lld-%s", (long long)state->writer_pid, resource_name(resource));
+        if (resource & RESOURCE_DEVICES) length += snprintf(etag + length, size - (size_t)length, "-d%llu", (unsigned long long)state->devices_version);
+        if (resource & RESOURCE_PLANTS) length += snprintf(etag + length, size - (size_t)length, "-p%llu-c%llu", (unsigned long long)state->plants_version, (unsigned long long)state->captures_version);
+        if (resource & RESOURCE_TIMER) length += snprintf(etag + length, size - (size_t)length, "-t%llu", (unsigned long long)state->processes_version);
+        snprintf(etag + length, size - (size_t)length, "\"");
+        return;
+    }
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    if (resource & RESOURCE_DEVICES) hash = hash_file_signature(hash, DEVICES_FILE);
+    if (resource & RESOURCE_PLANTS) {
+        hash = hash_file_signature(hash, PLANTS_FILE);
+        for (uint32_t i = 0; i < state->plant_count; ++i) {
+            char path[512];
+            snprintf(path, sizeof(path), "%splant_%u_metrics.series", IMAGE_BASE_DIR, i + 1);
+            hash = hash_file_signature(hash, path);
+        }
+    }
+    if (resource & RESOURCE_TIMER) hash = hash_file_signature(hash, PROCESSES_FILE);
+    snprintf(etag, size, "\"f-%s-%016llx\"", resource_name(resource), (unsigned long long)hash);
+}
+
+// Whether an If-None-Match header value lists `etag` (or is "*"). If-None-Match uses the weak
+// comparison, so a W/ prefix on a listed tag is ignored.
+static int etag_matches(const char *if_none_match, const char *etag) {
+    if (!if_none_match) return 0;
+    size_t etag_length = strlen(etag);
+    const char *p = if_none_match;
+    while (*p) {
+        while (*p == ' ' || *p == '\t' || *p == ',') ++p;
+        if (!*p) break;
+        if (*p == '*') return 1;
+        if (strncmp(p, "W/", 2) == 0) p += 2;
+        const char *end = p;
+        if (*end == '"') {
+            end = strchr(end + 1, '"');
+            end = end ? end + 1 : p + strlen(p);
+        } else {
+            while (*end && *end != ',') ++end;
+        }
+        if ((size_t)(end - p) == etag_length && strncmp(p, etag, etag_length) == 0) return 1;
+        p = end;
+    }
+    return 0;
+}
+
+static void print_json_string(const char *s) {
+    putchar('"');
+    for (const unsigned char *c = (const unsigned char*)s; *c; ++c) {
+        if (*c == '"' || *c == '\\') printf("\\%c", *c);
+        else if (*c < 0x20) printf("\\u%04x", *c);
+        else putchar(*c);
+    }
+    putchar('"');
+}
+
+static void print_json_number(const char *key, double value) {
+    if (isfinite(value)) printf("\"%s\":%.6g", key, value);
+    else printf("\"%s\":null", key);
+}
+
+// Prints the newest sample from plant_N_metrics.series as a JSON object, or null if there is none.
+static void print_latest_metrics(uint32_t plant_id) {
+    MetricRecord record;
+    if (!plant_series_read_latest(IMAGE_BASE_DIR, plant_id, &record)) {
+        printf("null");
+        return;
+    }
+    printf("{\"timestamp\":%lld,", (long long)record.timestamp);
+    print_json_number("canopy_area", record.canopy_area);
+    putchar(',');
+    print_json_number("color_index", record.color_index);
+    putchar(',');
+    print_json_number("height_hp", record.height_hp);
+    putchar(',');
+    print_json_number("width1", record.width1);
+    putchar(',');
+    print_json_number("width2", record.width2);
+    putchar(',');
+    print_json_number("volumetric_proxy", record.volumetric_proxy);
+    putchar('}');
+}
+
+static void print_devices(const PlantState *state) {
+    printf("\"devices\":[");
+    for (uint32_t i = 0; i < state->device_count; ++i) {
+        const PlantStateDevice *device = &state->devices[i];
+        printf("%s{\"id\":%llu,\"ip\":", i ? "," : "", (unsigned long long)device->id);
+        print_json_string(device->ip);
+        printf(",\"plant_id\":%u,\"plant_name\":", device->plant_id);
+        print_json_string(device->plant_name);
+        printf(",\"position\":\"%c\",\"last_ping\":%llu,\"command\":", device->position >= 0x20 && device->position < 0x7f && device->position != '"' && device->position != '\\' ? device->position : '?',
+               (unsigned long long)device->ping_timestamp);
+        print_json_string(device->command);
+        if (device->rssi) printf(",\"rssi\":%d", device->rssi);
+        else printf(",\"rssi\":null");
+        printf(",\"capture_ready\":%s}", device->heartbeat_flags & HEARTBEAT_FLAG_CAPTURE_READY ? "true" : "false");
+    }
+    printf("],\"device_total\":%llu", (unsigned long long)state->device_total);
+}
+
+static void print_plants(const PlantState *state) {
+    printf("\"plants\":[");
+    for (uint32_t i = 0; i < state->plant_count; ++i) {
+        const PlantStatePlant *plant = &state->plants[i];
+        printf("%s{\"id\":%u,\"name\":", i ? "," : "", i + 1);
+        print_json_string(plant->name);
+        printf(",\"remaining_duration\":%lld,\"configured_duration\":%lld,\"last_capture\":",
+               (long long)plant->remaining_duration, (long long)plant->configured_duration);
+        if (plant->last_capture) printf("%lld", (long long)plant->last_capture);
+        else printf("null");
+        printf(",\"metrics\":");
+        print_latest_metrics(i + 1);
+        putchar('}');
+    }
+    putchar(']');
+}
+
+// The timer is reported as start and duration only, so the representation (and its ETag) does not
+// change every second; clients compute the remaining time themselves.
+static void print_timer(const PlantState *state) {
+    printf("\"timer\":{\"loaded\":%s,\"start\":%lld,\"duration\":%lld}", state->processes_loaded ? "true" : "false",
+           (long long)state->global_timer_start, (long long)state->global_timer_duration);
+}
+
+int main(void) {
+    const char *method = getenv("REQUEST_METHOD");
+    int head = method && strcmp(method, "HEAD") == 0;
+    if (!method || (strcmp(method, "GET") != 0 && !head)) {
+        printf("Status: 405 Method Not Allowed\nAllow: GET, HEAD\nContent-Type: application/json\n\n{\"error\":\"method not allowed\"}\n");
+        return 0;
+    }
+    int resource = parse_resource(getenv("QUERY_STRING"));
+    if (!resource) {
+        printf("Status: 400 Bad Request\nContent-Type: application/json\n\n{\"error\":\"unknown resource\"}\n");
+        return 0;
+    }
+
+    PlantState *state = (PlantState*)malloc(sizeof(PlantState));
+    if (!state) {
+        log_cgi_message("ERR: Malloc state snapshot");
+        printf("Status: 500 Internal Server Error\nContent-Type: application/json\n\n{\"error\":\"out of memory\"}\n");
+        return 0;
+    }
+    int from_segment = plant_state_load(state, DEVICES_FILE, PLANTS_FILE, PROCESSES_FILE);
+
+    char etag[ETAG_MAX];
+    make_etag(etag, sizeof(etag), state, from_segment, resource);
+    if (etag_matches(getenv("HTTP_IF_NONE_MATCH"), etag)) {
+        printf("Status: 304 Not Modified\nETag: %s\nCache-Control: no-cache\n\n", etag);
+        free(state);
+        return 0;
+    }
+
+    printf("Content-Type: application/json\nETag: %s\nCache-Control: no-cache\n\n", etag);
+    if (!head) {
+        printf("{\"source\":\"%s\"", from_segment ? "application" : "files");
+        if (resource & RESOURCE_DEVICES) {
+            putchar(',');
+            print_devices(state);
+        }
+        if (resource & RESOURCE_PLANTS) {
+            putchar(',');
+            print_plants(state);
+        }
+        if (resource & RESOURCE_TIMER) {
+            putchar(',');
+            print_timer(state);
+        }
+        printf("}\n");
+    }
+    free(state);
+    return 0;
+}
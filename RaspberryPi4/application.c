@@ -1,20 +1,75 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
 #include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <spawn.h>
 
+#include "plant_state.h"
+
+static const char *DATA_DIR = "/var/www/html/data";
 static const char *PING_FILE = "/var/www/html/data/ping.txt";
 static const char *DEVICES_FILE = "/var/www/html/data/devices.txt";
 static const char *PLANTS_FILE = "/var/www/html/data/plants.txt";
 static const char *PROCESSES_FILE = "/var/www/html/data/processes.txt";
 static const char *IMAGE_DIR = "/var/www/html/data/images/";
+static const char *IMAGE_SERVICE_SOCKET = "/run/plant-monitor/generate_plant_images.sock";
+static const char *PRERENDER_COMMAND = "/usr/lib/cgi-bin/index.cgi";
+
+// Device registry. Devices live in slab-allocated slots that stay put for their lifetime, are
+// indexed by IP and by ID in chained hash tables and are kept in devices.txt order on a linked
+// list. It persists across reloads: read_devices_from_file updates it in place. IPs, plant names
+// and commands are interned (see intern_string), so an unchanged reload allocates nothing.
+#define DEVICE_SLAB_SIZE 64
+#define REGISTRY_MIN_BUCKETS 64
+
+typedef struct { uint64_t attempts, failures, last_ms, total_ms, max_ms; } FetchStats;
+
+typedef struct Device {
+    uint64_t id; const char *ip; uint8_t plant_id; const char *plant_name; uint8_t position; uint64_t ping_timestamp; const char *command; uint8_t pinged_this_cycle;
+    uint8_t seen;                      // listed in the devices.txt being reconciled
+    uint8_t has_heartbeat;             // last UDP heartbeat (see receive_heartbeats), if any
+    uint8_t heartbeat_flags;
+    int8_t rssi;
+    uint32_t heartbeat_sequence, uptime;
+    FetchStats fetch_stats;            // camera fetch latency, kept across reloads (see fetch_all_plant_images)
+    struct Device *next, *prev;        // registry order; `next` links the free list for unused slots
+    struct Device *ip_next, *id_next;  // hash chains
+} Device;
+typedef struct DeviceSlab { struct DeviceSlab *next; Device slots[DEVICE_SLAB_SIZE]; } DeviceSlab;
+typedef struct {
+    uint64_t count;
+    Device *head, *tail;
+    Device **by_ip, **by_id;
+    uint64_t bucket_count;
+    DeviceSlab *slabs;
+    Device *free_slots;
+    uint64_t slab_count;
+    uint64_t version, written_version; // bumped on every change / version devices.txt reflects
+} Devices;
+static Devices devices = {0};
 
-typedef struct { uint64_t id; char *ip; uint8_t plant_id; char *plant_name; uint8_t position; uint64_t ping_timestamp; char *command; uint8_t pinged_this_cycle; } Device;
-typedef struct { uint64_t count; Device *list; } Devices;
-static Devices devices = {0, NULL};
+// Reference-counted interned strings; equal strings share one copy.
+typedef struct InternedString { struct InternedString *next; uint32_t hash, refs; char text[]; } InternedString;
+typedef struct { InternedString **buckets; uint64_t bucket_count, count; } StringTable;
+static StringTable interned_strings = {NULL, 0, 0};
 
 typedef struct {
     char *name;
@@ -24,98 +79,279 @@ typedef struct {
 typedef struct { uint64_t count; Plant *list; } Plants;
 static Plants plants = {0, NULL};
 
+// Camera fetches run concurrently on one epoll instance (see fetch_run). The concurrency cap can
+// be overridden with PLANT_MONITOR_FETCH_CONCURRENCY.
+#define FETCH_DEFAULT_CONCURRENCY 8
+#define FETCH_CONNECT_TIMEOUT_MS 2000
+#define FETCH_READ_TIMEOUT_MS 5000
+#define FETCH_MAX_RESPONSE_BYTES (8 * 1024 * 1024)
+
+typedef enum { FETCH_PENDING, FETCH_CONNECTING, FETCH_RECEIVING, FETCH_DONE, FETCH_FAILED } FetchState;
+typedef struct {
+    Device *device;
+    uint8_t plant_id;
+    char position;
+    char host[64];
+    char path[512];
+    int fd;
+    FetchState state;
+    const char *error;
+    uint64_t start_ms, deadline_ms, latency_ms;
+    char *buffer;
+    size_t length, capacity;
+    size_t body_offset, body_length;   // JPEG payload inside buffer once state is FETCH_DONE
+    uint8_t handed_off;                // passed to the image service in memory, not yet on disk
+} FetchJob;
+
+// Fetched frames are handed to the image service as memfds (SCM_RIGHTS) so they are decoded from
+// RAM; the service writes the on-disk copy in the background. Must match generate_plant_images.
+#define MAX_HANDOFF_FRAMES 240
+
+// Plant captures are scheduled on a hierarchical timer wheel (see wheel_add) that advances once
+// per second, driven by a timerfd. Level l has WHEEL_SLOTS slots of WHEEL_SLOTS^l seconds each, so
+// four levels cover about 194 days; longer intervals are clamped. Timers are intrusive and one-shot.
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4
+#define WHEEL_MAX_DELAY ((1ULL << (WHEEL_BITS * WHEEL_LEVELS)) - 1)
+
+typedef struct WheelTimer {
+    struct WheelTimer *next;
+    struct WheelTimer **pprev;         // NULL while the timer is not armed
+    uint64_t expires;                  // wheel tick
+    void (*expired)(struct WheelTimer *timer);
+} WheelTimer;
+typedef struct { uint64_t now; WheelTimer *slots[WHEEL_LEVELS][WHEEL_SLOTS]; } TimerWheel;
+static TimerWheel capture_wheel;
+
+// Per-plant capture timer, indexed like plants.list. A plant is marked due when its timer expires
+// or the global timer fires; it is processed once however many times it was marked, and its timer
+// is re-armed a full configured_duration after that capture.
+#define MAX_SCHEDULED_PLANTS 255
+typedef struct {
+    WheelTimer timer;                  // first member: expired() casts the timer back to the schedule
+    char *name;
+    int64_t interval;
+    uint8_t due;
+    uint8_t in_flight;                 // in the image service batch awaiting its reply
+    uint64_t capture_version;          // captures_version after the plant's last capture; 0 if none yet
+    int64_t last_capture;
+} PlantSchedule;
+static PlantSchedule plant_schedules[MAX_SCHEDULED_PLANTS];
+
+// Bumped once per capture batch, so readers of the state segment can tell new metrics and images
+// apart without looking at the files.
+static uint64_t captures_version = 0;
+
+// Capture batch handed to the image service, kept until the service replies on `fd`.
+typedef struct {
+    int fd;                            // -1 when no batch is in flight
+    FetchJob *jobs;                    // fetched frames, written to disk here if the batch fails
+    uint64_t job_count, due_count;
+    int frame_count;
+    int64_t captured_at;
+    uint64_t start_us;
+    char *request;
+} ImageServiceBatch;
+static ImageServiceBatch service_batch = { .fd = -1 };
+
+// Devices that have not pinged for DEVICE_STALE_SECONDS are dropped by a wheel timer that runs
+// every DEVICE_EVICTION_INTERVAL seconds.
+#define DEVICE_STALE_SECONDS 60
+#define DEVICE_EVICTION_INTERVAL 10
+static WheelTimer device_eviction_timer;
+static uint8_t device_eviction_due = 0;
+
+// UDP heartbeats, a lighter alternative to the HTTP ping (see receive_heartbeats). A heartbeat is
+// HEARTBEAT_SIZE bytes, little-endian: magic "PMHB" (0), version (4), flags (5), RSSI in dBm (6),
+// reserved (7), device ID (8), sequence number (16) and uptime in seconds (20). The reply repeats
+// those bytes with HEARTBEAT_FLAG_REPLY set, followed by a length byte and the device's command.
+// Must match esp32cam.ino. The port can be overridden with PLANT_MONITOR_HEARTBEAT_PORT.
+#define HEARTBEAT_PORT 4210
+#define HEARTBEAT_MAGIC 0x42484d50u
+#define HEARTBEAT_VERSION 1
+#define HEARTBEAT_SIZE 24
+#define HEARTBEAT_COMMAND_MAX 63
+#define HEARTBEAT_REPLY_MAX (HEARTBEAT_SIZE + 1 + HEARTBEAT_COMMAND_MAX)
+#define HEARTBEAT_BATCH 64                 // datagrams per recvmmsg/sendmmsg call
+#define HEARTBEAT_MAX_BATCHES 16           // per wakeup, so a flood cannot starve the main loop
+#define HEARTBEAT_LOAD_TIMEOUT_MS 1000
+
+// The control files the CGIs write. The main loop watches DATA_DIR with inotify and re-reads a
+// file only after it was written. The application's own writes are recognised by the stat
+// signature recorded in write_file and skipped.
+enum { CONTROL_PINGS, CONTROL_DEVICES, CONTROL_PLANTS, CONTROL_PROCESSES, CONTROL_FILE_COUNT };
+typedef struct { const char *path; struct stat written; uint8_t has_written, changed; } ControlFile;
+static ControlFile control_files[CONTROL_FILE_COUNT];
+
+// devices.txt as last published by write_devices_to_file (length SIZE_MAX when unknown), and the
+// buffer the next version is serialised into.
+typedef struct { char *data; size_t length, capacity; } TextBuffer;
+static TextBuffer devices_text = {NULL, 0, 0}, devices_published = {NULL, SIZE_MAX, 0};
+
+// Global "Start All" timer as last read from processes.txt; loaded is 0 while the file is missing.
+typedef struct { long long start, duration; uint8_t loaded; uint64_t version; } GlobalTimer;
+static GlobalTimer global_timer = {0, 3600, 0, 0};
+
+// Bumped whenever plants.list is reloaded.
+static uint64_t plants_version = 0;
+
+// The shared-memory state segment (plant_state.h) and the versions it was last published at.
+typedef struct { uint64_t devices, plants, processes, captures; uint8_t valid; } PublishedVersions;
+static PlantState *plant_state = NULL;
+static PublishedVersions plant_state_published = {0, 0, 0, 0, 0};
+
+// Static dashboard pages, written by `index.cgi --prerender` in a child process. A changed plant
+// list, timer or capture re-renders them right away; device-only changes (pings, heartbeats) at
+// most every PLANT_MONITOR_PRERENDER_INTERVAL seconds, since open pages patch device rows live.
+#define PRERENDER_DEFAULT_DEVICE_INTERVAL 30
+static PublishedVersions prerendered = {0, 0, 0, 0, 0};
+static pid_t prerender_pid = 0;
+static time_t prerender_started = 0;
+
 typedef struct { uint64_t count; char **list; } Pings;
 static Pings pings = {0, NULL};
 
 static uint64_t id_generator = 0;
 
+// Opt-in Chrome trace output (see trace_init); NULL while tracing is disabled.
+static FILE *trace_file = NULL;
+
 static void log_message(const char *format, ...);
+static void trace_init(void);
+static uint64_t trace_begin(void);
+static void trace_end(const char *name, uint64_t start_us, const char *detail);
 static char *read_file(const char *file_name);
 static int write_file(const char *file_name, const char *string_buffer);
 static uint64_t generate_new_id(void);
 static void free_pings_data(void);
 static void free_devices_data(void);
+static Device *device_find_by_ip(const char *ip);
+static Device *device_find_by_id(uint64_t id);
+static Device *device_add(uint64_t id, const char *ip, uint8_t plant_id, const char *plant_name, uint8_t position, uint64_t ping_timestamp, const char *command);
+static void device_remove(Device *device);
+static int run_registry_benchmark(uint64_t device_count);
 static void free_plants_data(void);
-static void process(uint64_t plant_index);
+static FetchJob *fetch_all_plant_images(uint64_t *job_count_out);
+static int run_fetch_test(int argc, char **argv);
+static void wheel_add(TimerWheel *wheel, WheelTimer *timer, uint64_t expires);
+static void wheel_advance(TimerWheel *wheel, uint64_t ticks);
+static void device_eviction_expired(WheelTimer *timer);
+static void sync_plant_schedules(void);
+static int plant_is_due(uint64_t plant_id);
+static void process_due_plants(int epoll_fd);
+static void finish_plant_captures(int64_t captured_at);
+static void finish_image_service_batch(int epoll_fd);
+static uint64_t read_ticks(int timer_fd);
+static int request_image_processing(const char *request, const int *fds, int fd_count);
 
 static void read_pings_from_file(void);
 static void reset_ping_file(void);
+static void load_devices_from_text(char *content);
 static void read_devices_from_file(void);
 static void process_device_pings(void);
+static uint64_t evict_stale_devices(void);
+static int open_heartbeat_socket(void);
+static void receive_heartbeats(int heartbeat_fd);
+static int run_heartbeat_load(const char *host, int port, long device_count, long rounds);
 static void write_devices_to_file(void);
 static void read_plants_from_file(void);
+static void read_processes_from_file(void);
 static void manage_global_process_and_plants(void);
+static void watch_control_files(int inotify_fd);
+static void apply_control_changes(void);
 static void write_plants_to_file(void);
+static void open_plant_state(void);
+static void publish_plant_state(void);
+static void prerender_pages(void);
 static void cleanup_all_data(void);
 
-static char* get_first_plant_name() {
-    char* content = read_file(PLANTS_FILE);
-    if (!content) {
-        log_message("WARN: PLANTS_FILE not found or empty when trying to get first plant name.");
-        return NULL;
+int main(int argc, char **argv) {
+    if (argc >= 4 && strcmp(argv[1], "--fetch-test") == 0) {
+        return run_fetch_test(argc, argv);
     }
-
-    char* temp_content = strdup(content);
-    free(content);
-    if (!temp_content) {
-        log_message("ERR: strdup failed for temp_content in get_first_plant_name.");
-        return NULL;
+    if (argc == 3 && strcmp(argv[1], "--bench-registry") == 0) {
+        return run_registry_benchmark(strtoull(argv[2], NULL, 10));
+    }
+    if (argc == 6 && strcmp(argv[1], "--heartbeat-load") == 0) {
+        return run_heartbeat_load(argv[2], atoi(argv[3]), strtol(argv[4], NULL, 10), strtol(argv[5], NULL, 10));
     }
 
-    char* line;
-    char* rest_of_content = temp_content;
-    line = strtok_r(rest_of_content, "\n", &rest_of_content);
-
-    if (line) {
-        char* name_token;
-        char* line_copy_for_strtok = strdup(line);
-        if (!line_copy_for_strtok) {
-            log_message("ERR: strdup line_copy_for_strtok in get_first_plant_name.");
-            free(temp_content);
-            return NULL;
-        }
-        char* inner_rest = line_copy_for_strtok;
-        name_token = strtok_r(inner_rest, ",", &inner_rest);
-
-        if (name_token) {
-            char* plant_name = strdup(name_token);
-            if (!plant_name) {
-                log_message("ERR: strdup plant_name in get_first_plant_name.");
-            }
-            free(line_copy_for_strtok);
-            free(temp_content);
-            return plant_name;
-        }
-        free(line_copy_for_strtok);
+    log_message("Application started.");
+    trace_init();
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        log_message("ERR: epoll_create1: %s", strerror(errno));
+        return 1;
     }
-    
-    free(temp_content);
-    log_message("WARN: No plant name found in the first line of PLANTS_FILE.");
-    return NULL;
-}
+    int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    struct itimerspec tick = { {1, 0}, {1, 0} };
+    if (timer_fd < 0 || timerfd_settime(timer_fd, 0, &tick, NULL) < 0) {
+        log_message("WARN: timerfd unavailable (%s). Ticking on epoll_wait timeouts.", strerror(errno));
+        if (timer_fd >= 0) close(timer_fd);
+        timer_fd = -1;
+    }
+    int inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd >= 0 && inotify_add_watch(inotify_fd, DATA_DIR, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        log_message("WARN: Cannot watch %s (%s). Re-reading control files every second.", DATA_DIR, strerror(errno));
+        close(inotify_fd);
+        inotify_fd = -1;
+    }
+    struct epoll_event event = { .events = EPOLLIN };
+    event.data.fd = timer_fd;
+    if (timer_fd >= 0) epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &event);
+    event.data.fd = inotify_fd;
+    if (inotify_fd >= 0) epoll_ctl(epoll_fd, EPOLL_CTL_ADD, inotify_fd, &event);
+    int heartbeat_fd = open_heartbeat_socket();
+    event.data.fd = heartbeat_fd;
+    if (heartbeat_fd >= 0) epoll_ctl(epoll_fd, EPOLL_CTL_ADD, heartbeat_fd, &event);
 
+    const char *control_paths[CONTROL_FILE_COUNT] = { PING_FILE, DEVICES_FILE, PLANTS_FILE, PROCESSES_FILE };
+    for (int i = 0; i < CONTROL_FILE_COUNT; ++i) {
+        control_files[i].path = control_paths[i];
+        control_files[i].changed = 1;
+    }
+    device_eviction_timer.expired = device_eviction_expired;
+    wheel_add(&capture_wheel, &device_eviction_timer, capture_wheel.now + DEVICE_EVICTION_INTERVAL);
+    open_plant_state();
 
-int main(void) {
-    log_message("Application started.");
+    uint64_t ticks = 0;
     while (1) {
-        log_message("Loop start.");
-        read_pings_from_file();
-        reset_ping_file();
-        read_devices_from_file();
-        process_device_pings();
-        write_devices_to_file();
-        read_plants_from_file();
-        
-        if (plants.count > 0) {
-            log_message("Triggering immediate image fetching (or placeholder generation) and processing for all plants.");
-            for (uint64_t i = 0; i < plants.count; ++i) {
-                process(i);
-            }
+        uint64_t cycle_start = trace_begin();
+        apply_control_changes();
+        if (ticks) {
+            wheel_advance(&capture_wheel, ticks);
+            manage_global_process_and_plants();
+        }
+        if (device_eviction_due) {
+            device_eviction_due = 0;
+            evict_stale_devices();
+            write_devices_to_file();
+            wheel_add(&capture_wheel, &device_eviction_timer, capture_wheel.now + DEVICE_EVICTION_INTERVAL);
         }
+        process_due_plants(epoll_fd);
+        publish_plant_state();
+        prerender_pages();
+        trace_end("cycle", cycle_start, NULL);
+        if (trace_file) fflush(trace_file);
 
-        manage_global_process_and_plants();
-        log_message("Loop end. Sleeping for 1 second.");
-        sleep(1);
+        struct epoll_event ready[4];
+        int n = epoll_wait(epoll_fd, ready, 4, timer_fd < 0 ? 1000 : -1);
+        if (n < 0 && errno != EINTR) {
+            log_message("ERR: epoll_wait: %s", strerror(errno));
+            sleep(1);
+        }
+        ticks = timer_fd < 0 && n == 0 ? 1 : 0;
+        for (int i = 0; i < n; ++i) {
+            if (ready[i].data.fd == timer_fd) ticks += read_ticks(timer_fd);
+            else if (ready[i].data.fd == inotify_fd) watch_control_files(inotify_fd);
+            else if (ready[i].data.fd == heartbeat_fd) receive_heartbeats(heartbeat_fd);
+            else if (ready[i].data.fd == service_batch.fd) finish_image_service_batch(epoll_fd);
+        }
+        if (inotify_fd < 0 && ticks) {
+            for (int i = 0; i < CONTROL_FILE_COUNT; ++i) control_files[i].changed = 1;
+        }
     }
     cleanup_all_data();
     return 0;
@@ -134,6 +370,50 @@ static void log_message(const char *format, ...) {
     fprintf(stderr, "\n");
 }
 
+// When PLANT_MONITOR_TRACE_DIR is set, spans are written to <dir>/application-<pid>.json in
+// Chrome trace format (chrome://tracing, Perfetto). Timestamps are CLOCK_MONOTONIC microseconds,
+// the clock generate_plant_images uses too, so both traces line up. Disabled spans cost one branch.
+static void trace_init(void) {
+    const char *trace_dir = getenv("PLANT_MONITOR_TRACE_DIR");
+    if (!trace_dir || !*trace_dir) return;
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/application-%d.json", trace_dir, (int)getpid());
+    trace_file = fopen(path, "w");
+    if (!trace_file) {
+        log_message("WARN: Could not open trace file %s: %s", path, strerror(errno));
+        return;
+    }
+    // The JSON array is left open so a killed process still leaves a loadable trace.
+    fprintf(trace_file, "[{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"application\"}}", (int)getpid());
+    log_message("Tracing to %s", path);
+}
+
+static uint64_t trace_begin(void) {
+    if (!trace_file) return 0;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+// Writes a complete event for the span started at start_us. `detail`, if given, is stored as the
+// event's "detail" argument (e.g. the command line of an exec step).
+static void trace_end(const char *name, uint64_t start_us, const char *detail) {
+    if (!trace_file) return;
+    uint64_t end_us = trace_begin();
+    fprintf(trace_file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,\"pid\":%d,\"tid\":%d",
+            name, (unsigned long long)start_us, (unsigned long long)(end_us - start_us), (int)getpid(), (int)getpid());
+    if (detail) {
+        fputs(",\"args\":{\"detail\":\"", trace_file);
+        for (const char *c = detail; *c; ++c) {
+            if (*c == '"' || *c == '\\') fputc('\\', trace_file);
+            if ((unsigned char)*c >= 0x20) fputc(*c, trace_file);
+        }
+        fputs("\"}", trace_file);
+    }
+    fputc('}', trace_file);
+}
+
 static char *read_file(const char *file_name) {
     FILE *file = fopen(file_name, "r");
     if (!file) {
@@ -155,17 +435,100 @@ static char *read_file(const char *file_name) {
     return buffer;
 }
 
-static int write_file(const char *file_name, const char *string_buffer) {
-    FILE *file = fopen(file_name, "w");
-    if (!file) {
-        log_message("ERR: Write %s", file_name);
+// Replaces a file through a temporary file and rename(), so the CGIs reading it see either the old
+// or the new content, never a partial write.
+static int write_file_data(const char *file_name, const char *data, size_t length) {
+    char tmp_path[512];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", file_name);
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0664);
+    if (fd < 0) {
+        log_message("ERR: Write %s: %s", tmp_path, strerror(errno));
         return 1;
     }
-    fprintf(file, "%s", string_buffer);
-    fclose(file);
+    size_t written = 0;
+    while (written < length) {
+        ssize_t n = write(fd, data + written, length - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        written += (size_t)n;
+    }
+    if (close(fd) != 0 || written != length || rename(tmp_path, file_name) != 0) {
+        log_message("ERR: Write %s: %s", file_name, strerror(errno));
+        unlink(tmp_path);
+        return 1;
+    }
+    for (int i = 0; i < CONTROL_FILE_COUNT; ++i) {
+        if (control_files[i].path && strcmp(control_files[i].path, file_name) == 0) {
+            control_files[i].has_written = stat(file_name, &control_files[i].written) == 0;
+        }
+    }
     return 0;
 }
 
+static int write_file(const char *file_name, const char *string_buffer) {
+    return write_file_data(file_name, string_buffer, strlen(string_buffer));
+}
+
+// Drains the inotify queue and flags the control files that were written or moved into place.
+static void watch_control_files(int inotify_fd) {
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t length;
+    while ((length = read(inotify_fd, buffer, sizeof(buffer))) > 0) {
+        for (char *ptr = buffer; ptr < buffer + length; ptr += sizeof(struct inotify_event) + ((struct inotify_event*)ptr)->len) {
+            const struct inotify_event *event = (const struct inotify_event*)ptr;
+            for (int i = 0; i < CONTROL_FILE_COUNT; ++i) {
+                if (event->mask & IN_Q_OVERFLOW) control_files[i].changed = 1;
+                else if (event->len && strcmp(event->name, strrchr(control_files[i].path, '/') + 1) == 0) control_files[i].changed = 1;
+            }
+        }
+    }
+}
+
+// Clears the changed flag of a control file and reports whether it needs re-reading, i.e. whether
+// it is not exactly as the application itself last wrote it.
+static int take_control_change(int index) {
+    ControlFile *control = &control_files[index];
+    if (!control->changed) return 0;
+    control->changed = 0;
+    struct stat current;
+    if (control->has_written && stat(control->path, &current) == 0 &&
+        current.st_ino == control->written.st_ino && current.st_size == control->written.st_size &&
+        current.st_mtim.tv_sec == control->written.st_mtim.tv_sec && current.st_mtim.tv_nsec == control->written.st_mtim.tv_nsec) {
+        return 0;
+    }
+    return 1;
+}
+
+// Re-reads the control files the CGIs changed and applies them.
+static void apply_control_changes(void) {
+    uint64_t span_start;
+    if (take_control_change(CONTROL_PLANTS)) {
+        span_start = trace_begin();
+        read_plants_from_file();
+        sync_plant_schedules();
+        trace_end("read_plants", span_start, NULL);
+    }
+    if (take_control_change(CONTROL_DEVICES)) {
+        span_start = trace_begin();
+        read_devices_from_file();
+        trace_end("read_devices", span_start, NULL);
+    }
+    if (take_control_change(CONTROL_PINGS)) {
+        span_start = trace_begin();
+        read_pings_from_file();
+        if (pings.count > 0) {
+            reset_ping_file();
+            process_device_pings();
+            write_devices_to_file();
+        }
+        trace_end("read_pings", span_start, NULL);
+    }
+    if (take_control_change(CONTROL_PROCESSES)) {
+        read_processes_from_file();
+        manage_global_process_and_plants();
+    }
+}
+
 static uint64_t generate_new_id(void) { return id_generator++; }
 
 static void free_pings_data(void) {
@@ -179,17 +542,213 @@ static void free_pings_data(void) {
     pings.count = 0;
 }
 
-static void free_devices_data(void) {
-    if (devices.list) {
-        for (uint64_t i = 0; i < devices.count; ++i) {
-            free(devices.list[i].ip);
-            if (devices.list[i].plant_name) free(devices.list[i].plant_name);
-            free(devices.list[i].command);
+static uint32_t hash_string(const char *text) {
+    uint32_t hash = 2166136261u;
+    while (*text) hash = (hash ^ (uint8_t)*text++) * 16777619u;
+    return hash;
+}
+
+static uint64_t hash_device_id(uint64_t id) { return id * 11400714819323198485ULL; }
+
+// Returns the interned copy of `text` with one more reference, or NULL if out of memory.
+static const char *intern_string(const char *text) {
+    StringTable *table = &interned_strings;
+    if (table->count >= table->bucket_count) {
+        uint64_t bucket_count = table->bucket_count ? table->bucket_count * 2 : REGISTRY_MIN_BUCKETS;
+        InternedString **buckets = (InternedString**)calloc(bucket_count, sizeof(InternedString*));
+        if (!buckets) return NULL;
+        for (uint64_t b = 0; b < table->bucket_count; ++b) {
+            InternedString *entry = table->buckets[b];
+            while (entry) {
+                InternedString *next = entry->next;
+                entry->next = buckets[entry->hash & (bucket_count - 1)];
+                buckets[entry->hash & (bucket_count - 1)] = entry;
+                entry = next;
+            }
+        }
+        free(table->buckets);
+        table->buckets = buckets;
+        table->bucket_count = bucket_count;
+    }
+
+    uint32_t hash = hash_string(text);
+    InternedString **bucket = &table->buckets[hash & (table->bucket_count - 1)];
+    for (InternedString *entry = *bucket; entry; entry = entry->next) {
+        if (entry->hash == hash && strcmp(entry->text, text) == 0) {
+            entry->refs++;
+            return entry->text;
+        }
+    }
+    size_t length = strlen(text);
+    InternedString *entry = (InternedString*)malloc(sizeof(InternedString) + length + 1);
+    if (!entry) return NULL;
+    entry->hash = hash;
+    entry->refs = 1;
+    memcpy(entry->text, text, length + 1);
+    entry->next = *bucket;
+    *bucket = entry;
+    table->count++;
+    return entry->text;
+}
+
+static void release_string(const char *text) {
+    if (!text) return;
+    InternedString *entry = (InternedString*)(text - offsetof(InternedString, text));
+    if (--entry->refs > 0) return;
+    InternedString **link = &interned_strings.buckets[entry->hash & (interned_strings.bucket_count - 1)];
+    while (*link != entry) link = &(*link)->next;
+    *link = entry->next;
+    interned_strings.count--;
+    free(entry);
+}
+
+// Points *slot at the interned `text`, leaving it untouched when it already matches.
+static void assign_string(const char **slot, const char *text) {
+    if (*slot && strcmp(*slot, text) == 0) return;
+    const char *interned = intern_string(text);
+    if (!interned) {
+        log_message("ERR: Malloc interned string");
+        return;
+    }
+    release_string(*slot);
+    *slot = interned;
+}
+
+static Device **device_ip_bucket(const char *ip) { return &devices.by_ip[hash_string(ip) & (devices.bucket_count - 1)]; }
+static Device **device_id_bucket(uint64_t id) { return &devices.by_id[hash_device_id(id) >> 32 & (devices.bucket_count - 1)]; }
+
+static void device_index(Device *device) {
+    Device **bucket = device_ip_bucket(device->ip);
+    device->ip_next = *bucket;
+    *bucket = device;
+    bucket = device_id_bucket(device->id);
+    device->id_next = *bucket;
+    *bucket = device;
+}
+
+static void device_unindex(Device *device) {
+    Device **link = device_ip_bucket(device->ip);
+    while (*link != device) link = &(*link)->ip_next;
+    *link = device->ip_next;
+    link = device_id_bucket(device->id);
+    while (*link != device) link = &(*link)->id_next;
+    *link = device->id_next;
+}
+
+static int device_grow_index(void) {
+    uint64_t bucket_count = devices.bucket_count ? devices.bucket_count * 2 : REGISTRY_MIN_BUCKETS;
+    Device **by_ip = (Device**)calloc(bucket_count, sizeof(Device*));
+    Device **by_id = (Device**)calloc(bucket_count, sizeof(Device*));
+    if (!by_ip || !by_id) {
+        free(by_ip);
+        free(by_id);
+        return -1;
+    }
+    free(devices.by_ip);
+    free(devices.by_id);
+    devices.by_ip = by_ip;
+    devices.by_id = by_id;
+    devices.bucket_count = bucket_count;
+    for (Device *device = devices.head; device; device = device->next) device_index(device);
+    return 0;
+}
+
+static Device *device_find_by_ip(const char *ip) {
+    if (!devices.bucket_count) return NULL;
+    for (Device *device = *device_ip_bucket(ip); device; device = device->ip_next) {
+        if (strcmp(device->ip, ip) == 0) return device;
+    }
+    return NULL;
+}
+
+static Device *device_find_by_id(uint64_t id) {
+    if (!devices.bucket_count) return NULL;
+    for (Device *device = *device_id_bucket(id); device; device = device->id_next) {
+        if (device->id == id) return device;
+    }
+    return NULL;
+}
+
+// Appends a device to the registry. Returns NULL if out of memory.
+static Device *device_add(uint64_t id, const char *ip, uint8_t plant_id, const char *plant_name, uint8_t position, uint64_t ping_timestamp, const char *command) {
+    if (devices.count >= devices.bucket_count && device_grow_index() != 0) {
+        log_message("ERR: Malloc device index");
+        return NULL;
+    }
+    if (!devices.free_slots) {
+        DeviceSlab *slab = (DeviceSlab*)malloc(sizeof(DeviceSlab));
+        if (!slab) {
+            log_message("ERR: Malloc device slab");
+            return NULL;
         }
-        free(devices.list);
+        slab->next = devices.slabs;
+        devices.slabs = slab;
+        devices.slab_count++;
+        for (int i = DEVICE_SLAB_SIZE - 1; i >= 0; --i) {
+            slab->slots[i].next = devices.free_slots;
+            devices.free_slots = &slab->slots[i];
+        }
+    }
+
+    Device *device = devices.free_slots;
+    Device *next_free = device->next;
+    memset(device, 0, sizeof(Device));
+    device->id = id;
+    device->plant_id = plant_id;
+    device->position = position;
+    device->ping_timestamp = ping_timestamp;
+    assign_string(&device->ip, ip);
+    assign_string(&device->plant_name, plant_name);
+    assign_string(&device->command, command);
+    if (!device->ip || !device->plant_name || !device->command) {
+        release_string(device->ip);
+        release_string(device->plant_name);
+        release_string(device->command);
+        device->next = next_free;
+        return NULL;
     }
-    devices.list = NULL;
-    devices.count = 0;
+    devices.free_slots = next_free;
+
+    device->prev = devices.tail;
+    if (devices.tail) devices.tail->next = device;
+    else devices.head = device;
+    devices.tail = device;
+    device_index(device);
+    devices.count++;
+    devices.version++;
+    if (id >= id_generator) id_generator = id + 1;
+    return device;
+}
+
+static void device_remove(Device *device) {
+    device_unindex(device);
+    if (device->prev) device->prev->next = device->next;
+    else devices.head = device->next;
+    if (device->next) device->next->prev = device->prev;
+    else devices.tail = device->prev;
+    release_string(device->ip);
+    release_string(device->plant_name);
+    release_string(device->command);
+    device->next = devices.free_slots;
+    devices.free_slots = device;
+    devices.count--;
+    devices.version++;
+}
+
+static void free_devices_data(void) {
+    while (devices.head) device_remove(devices.head);
+    while (devices.slabs) {
+        DeviceSlab *next = devices.slabs->next;
+        free(devices.slabs);
+        devices.slabs = next;
+    }
+    free(devices.by_ip);
+    free(devices.by_id);
+    memset(&devices, 0, sizeof(devices));
+    free(devices_text.data);
+    free(devices_published.data);
+    devices_text = (TextBuffer){NULL, 0, 0};
+    devices_published = (TextBuffer){NULL, SIZE_MAX, 0};
 }
 
 static void free_plants_data(void) {
@@ -203,63 +762,817 @@ static void free_plants_data(void) {
     plants.count = 0;
 }
 
-static void process(uint64_t plant_index) {
-    log_message("Executing processing for plant index: %llu", plant_index);
-
-    for (uint64_t i = 0; i < devices.count; ++i) {
-        if (devices.list[i].plant_id == (plant_index + 1)) {
-            char position_char = (char)devices.list[i].position;
-            char image_filename[256];
-            char full_image_path[512];
-            char fetch_command[512];
-
-            snprintf(image_filename, sizeof(image_filename), "plant_%llu_initial_%c.jpg", plant_index + 1, position_char);
-            snprintf(full_image_path, sizeof(full_image_path), "%s%s", IMAGE_DIR, image_filename);
-
-            int image_fetched_successfully = 0;
-
-            snprintf(fetch_command, sizeof(fetch_command),
-                     "wget -q -O %s http://%s/ --timeout=5 --tries=1",
-                     full_image_path, devices.list[i].ip);
-            
-            log_message("Attempting to fetch image for device %llu (IP: %s, Pos: %c). Command: %s",
-                        devices.list[i].id, devices.list[i].ip, position_char, fetch_command);
-            
-            int ret_fetch = system(fetch_command);
-            if (ret_fetch == 0) {
-                log_message("Successfully fetched image for device %llu to %s", devices.list[i].id, full_image_path);
-                image_fetched_successfully = 1;
-            } else {
-                log_message("WARN: Failed to fetch image for device %llu. wget exited with status %d. Generating placeholder.", devices.list[i].id, ret_fetch);
+static uint64_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL;
+}
+
+static int fetch_concurrency(void) {
+    const char *value = getenv("PLANT_MONITOR_FETCH_CONCURRENCY");
+    int concurrency = value ? atoi(value) : 0;
+    return concurrency > 0 ? concurrency : FETCH_DEFAULT_CONCURRENCY;
+}
+
+static void fetch_fail(FetchJob *job, const char *error) {
+    if (job->fd >= 0) close(job->fd);
+    job->fd = -1;
+    job->state = FETCH_FAILED;
+    job->error = error;
+    job->latency_ms = monotonic_ms() - job->start_ms;
+}
+
+// Opens a non-blocking connection to job->host ("a.b.c.d" or "a.b.c.d:port").
+static void fetch_start(FetchJob *job, int epoll_fd, uint64_t now_ms) {
+    job->start_ms = now_ms;
+    job->deadline_ms = now_ms + FETCH_CONNECT_TIMEOUT_MS;
+
+    char host[64];
+    snprintf(host, sizeof(host), "%s", job->host);
+    uint16_t port = 80;
+    char *colon = strchr(host, ':');
+    if (colon) {
+        *colon = '\0';
+        port = (uint16_t)atoi(colon + 1);
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+        fetch_fail(job, "invalid address");
+        return;
+    }
+
+    job->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (job->fd < 0) {
+        fetch_fail(job, "socket failed");
+        return;
+    }
+    if (connect(job->fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS) {
+        fetch_fail(job, "connect failed");
+        return;
+    }
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLOUT;
+    event.data.ptr = job;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, job->fd, &event) < 0) {
+        fetch_fail(job, "epoll_ctl failed");
+        return;
+    }
+    job->state = FETCH_CONNECTING;
+}
+
+// Checks the HTTP status line and locates the JPEG body in the receive buffer.
+static void fetch_finish(FetchJob *job) {
+    close(job->fd);
+    job->fd = -1;
+    job->latency_ms = monotonic_ms() - job->start_ms;
+
+    int status = 0;
+    char *body = job->buffer ? strstr(job->buffer, "\r\n\r\n") : NULL;
+    if (!job->buffer || sscanf(job->buffer, "HTTP/%*d.%*d %d", &status) != 1 || !body) {
+        job->state = FETCH_FAILED;
+        job->error = "malformed response";
+        return;
+    }
+    if (status != 200) {
+        job->state = FETCH_FAILED;
+        job->error = "HTTP error status";
+        return;
+    }
+    body += 4;
+    size_t body_len = job->length - (size_t)(body - job->buffer);
+    if (body_len == 0) {
+        job->state = FETCH_FAILED;
+        job->error = "empty body";
+        return;
+    }
+    job->body_offset = (size_t)(body - job->buffer);
+    job->body_length = body_len;
+    job->state = FETCH_DONE;
+}
+
+// Writes a fetched frame to job->path via a temporary file, so the image generator never sees a
+// partially written JPEG.
+static int write_fetched_image(FetchJob *job) {
+    char tmp_path[sizeof(job->path) + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", job->path);
+    FILE *file = fopen(tmp_path, "wb");
+    if (!file || fwrite(job->buffer + job->body_offset, 1, job->body_length, file) != job->body_length ||
+        fclose(file) != 0 || rename(tmp_path, job->path) != 0) {
+        log_message("ERR: Could not write image %s: %s", job->path, strerror(errno));
+        if (file) unlink(tmp_path);
+        return 1;
+    }
+    return 0;
+}
+
+static int create_frame_memfd(const FetchJob *job) {
+    int fd = memfd_create("plant_frame", MFD_CLOEXEC);
+    if (fd < 0) return -1;
+    const char *data = job->buffer + job->body_offset;
+    size_t remaining = job->body_length;
+    while (remaining > 0) {
+        ssize_t n = write(fd, data, remaining);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            close(fd);
+            return -1;
+        }
+        data += n;
+        remaining -= (size_t)n;
+    }
+    return fd;
+}
+
+static void fetch_on_event(FetchJob *job, int epoll_fd, uint32_t events, uint64_t now_ms) {
+    if (job->state == FETCH_CONNECTING) {
+        int error = 0;
+        socklen_t error_len = sizeof(error);
+        if (getsockopt(job->fd, SOL_SOCKET, SO_ERROR, &error, &error_len) < 0 || error != 0) {
+            fetch_fail(job, "connect failed");
+            return;
+        }
+        char request[128];
+        int request_len = snprintf(request, sizeof(request), "GET / HTTP/1.0\r\nHost: %s\r\nConnection: close\r\n\r\n", job->host);
+        if (send(job->fd, request, request_len, MSG_NOSIGNAL) != request_len) {
+            fetch_fail(job, "send failed");
+            return;
+        }
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.ptr = job;
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, job->fd, &event);
+        job->state = FETCH_RECEIVING;
+        job->deadline_ms = now_ms + FETCH_READ_TIMEOUT_MS;
+        return;
+    }
+
+    if (!(events & (EPOLLIN | EPOLLHUP | EPOLLERR))) return;
+    while (1) {
+        if (job->capacity - job->length < 16384) {
+            size_t capacity = job->capacity ? job->capacity * 2 : 65536;
+            if (capacity > FETCH_MAX_RESPONSE_BYTES) {
+                fetch_fail(job, "response too large");
+                return;
             }
+            char *buffer = (char*)realloc(job->buffer, capacity + 1);
+            if (!buffer) {
+                fetch_fail(job, "out of memory");
+                return;
+            }
+            job->buffer = buffer;
+            job->capacity = capacity;
+        }
+        ssize_t n = recv(job->fd, job->buffer + job->length, job->capacity - job->length, 0);
+        if (n > 0) {
+            job->length += (size_t)n;
+            job->buffer[job->length] = '\0';
+            job->deadline_ms = now_ms + FETCH_READ_TIMEOUT_MS;
+            continue;
+        }
+        if (n == 0) {
+            fetch_finish(job);
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            fetch_fail(job, "read failed");
+        }
+        return;
+    }
+}
+
+// Fetches all jobs concurrently over one epoll instance, with at most `concurrency` connections
+// open at a time. Each request has a connect deadline, and a read deadline that is extended
+// whenever data arrives.
+static void fetch_run(FetchJob *jobs, uint64_t job_count, int concurrency) {
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        log_message("ERR: epoll_create1 for camera fetch: %s", strerror(errno));
+        for (uint64_t i = 0; i < job_count; ++i) fetch_fail(&jobs[i], "epoll unavailable");
+        return;
+    }
+
+    uint64_t next_job = 0;
+    int active = 0;
+    while (1) {
+        uint64_t now_ms = monotonic_ms();
+        while (active < concurrency && next_job < job_count) {
+            FetchJob *job = &jobs[next_job++];
+            fetch_start(job, epoll_fd, now_ms);
+            if (job->state == FETCH_CONNECTING) active++;
+        }
+
+        uint64_t next_deadline = UINT64_MAX;
+        active = 0;
+        for (uint64_t i = 0; i < next_job; ++i) {
+            FetchJob *job = &jobs[i];
+            if (job->state != FETCH_CONNECTING && job->state != FETCH_RECEIVING) continue;
+            if (now_ms >= job->deadline_ms) {
+                fetch_fail(job, job->state == FETCH_CONNECTING ? "connect timeout" : "read timeout");
+                continue;
+            }
+            active++;
+            if (job->deadline_ms < next_deadline) next_deadline = job->deadline_ms;
+        }
+        if (active == 0) {
+            if (next_job >= job_count) break;
+            continue;
+        }
+
+        struct epoll_event events[32];
+        int n = epoll_wait(epoll_fd, events, 32, (int)(next_deadline - now_ms));
+        if (n < 0 && errno != EINTR) {
+            log_message("ERR: epoll_wait for camera fetch: %s", strerror(errno));
+            break;
+        }
+        now_ms = monotonic_ms();
+        for (int i = 0; i < n; ++i) {
+            fetch_on_event((FetchJob*)events[i].data.ptr, epoll_fd, events[i].events, now_ms);
+        }
+    }
+
+    for (uint64_t i = 0; i < job_count; ++i) {
+        if (jobs[i].state == FETCH_CONNECTING || jobs[i].state == FETCH_RECEIVING || jobs[i].state == FETCH_PENDING) {
+            fetch_fail(&jobs[i], "aborted");
+        }
+    }
+    close(epoll_fd);
+}
+
+static void free_fetch_jobs(FetchJob *jobs, uint64_t job_count) {
+    for (uint64_t i = 0; i < job_count; ++i) free(jobs[i].buffer);
+    free(jobs);
+}
+
+// Fetches the current image of every camera assigned to a due plant, all at once. Fetched
+// frames stay in memory in the returned jobs; the caller hands them on, reports cameras that did
+// not deliver as missing views, and frees the jobs.
+static FetchJob *fetch_all_plant_images(uint64_t *job_count_out) {
+    uint64_t job_count = 0;
+    *job_count_out = 0;
+    for (Device *device = devices.head; device; device = device->next) {
+        if (device->plant_id <= plants.count && plant_is_due(device->plant_id)) job_count++;
+    }
+    if (job_count == 0) return NULL;
+
+    FetchJob *jobs = (FetchJob*)calloc(job_count, sizeof(FetchJob));
+    if (!jobs) {
+        log_message("ERR: Calloc fetch jobs");
+        return NULL;
+    }
+    uint64_t j = 0;
+    for (Device *device = devices.head; device; device = device->next) {
+        if (device->plant_id > plants.count || !plant_is_due(device->plant_id)) continue;
+        FetchJob *job = &jobs[j++];
+        job->device = device;
+        job->plant_id = device->plant_id;
+        job->position = (char)device->position;
+        job->fd = -1;
+        snprintf(job->host, sizeof(job->host), "%s", device->ip);
+        snprintf(job->path, sizeof(job->path), "%splant_%u_initial_%c.jpg", IMAGE_DIR, device->plant_id, (char)device->position);
+    }
+
+    int concurrency = fetch_concurrency();
+    log_message("Fetching %llu camera images (up to %d at a time).", job_count, concurrency);
+    uint64_t fetch_start_us = trace_begin();
+    fetch_run(jobs, job_count, concurrency);
+    trace_end("fetch_cameras", fetch_start_us, NULL);
+
+    for (uint64_t k = 0; k < job_count; ++k) {
+        FetchJob *job = &jobs[k];
+        Device *device = job->device;
+        FetchStats *stats = &device->fetch_stats;
+        stats->attempts++;
+        stats->last_ms = job->latency_ms;
+        stats->total_ms += job->latency_ms;
+        if (job->latency_ms > stats->max_ms) stats->max_ms = job->latency_ms;
+        if (job->state != FETCH_DONE) stats->failures++;
+
+        if (job->state == FETCH_DONE) {
+            log_message("Fetched image for device %llu (IP: %s, Pos: %c) in %llu ms (avg %llu ms, max %llu ms over %llu fetches), %zu bytes",
+                        device->id, device->ip, (char)device->position, job->latency_ms,
+                        stats->total_ms / stats->attempts, stats->max_ms, stats->attempts, job->body_length);
+        } else {
+            log_message("WARN: Failed to fetch image for device %llu (IP: %s, Pos: %c) after %llu ms: %s (%llu of %llu fetches failed). Using placeholder.",
+                        device->id, device->ip, (char)device->position, job->latency_ms, job->error,
+                        stats->failures, stats->attempts);
+        }
+    }
+    *job_count_out = job_count;
+    return jobs;
+}
 
-            if (!image_fetched_successfully) {
-                char placeholder_command[512];
-                const char* color = "gray";
-                const char* text_color = "black";
-                if (position_char == 'X') { color = "lightblue"; text_color = "darkblue"; }
-                else if (position_char == 'Y') { color = "lightgreen"; text_color = "darkgreen"; }
-                else if (position_char == 'Z') { color = "lightcoral"; text_color = "darkred"; }
-
-                snprintf(placeholder_command, sizeof(placeholder_command),
-                         "convert -size 150x100 xc:%s -pointsize 14 -fill %s -gravity Center -annotate 0 'Plant %llu\\nInitial %c' %s",
-                         color, text_color, plant_index + 1, position_char, full_image_path);
-                
-                log_message("Generating placeholder image: %s", placeholder_command);
-                int ret_placeholder = system(placeholder_command);
-                if (ret_placeholder == 0) {
-                    log_message("Successfully generated placeholder image: %s", full_image_path);
-                } else {
-                    log_message("ERR: Failed to generate placeholder image for %s. convert exited with status %d. Please ensure ImageMagick is installed and in PATH.", full_image_path, ret_placeholder);
+// Stand-alone fetcher for testing against a local stand-in camera server:
+// application --fetch-test <output_dir> <host[:port]>...
+static int run_fetch_test(int argc, char **argv) {
+    uint64_t job_count = (uint64_t)(argc - 3);
+    FetchJob *jobs = (FetchJob*)calloc(job_count, sizeof(FetchJob));
+    if (!jobs) return 1;
+    for (uint64_t i = 0; i < job_count; ++i) {
+        jobs[i].fd = -1;
+        snprintf(jobs[i].host, sizeof(jobs[i].host), "%s", argv[3 + i]);
+        snprintf(jobs[i].path, sizeof(jobs[i].path), "%s/fetch_%llu.jpg", argv[2], (unsigned long long)i);
+    }
+
+    uint64_t start_ms = monotonic_ms();
+    fetch_run(jobs, job_count, fetch_concurrency());
+    int failures = 0;
+    for (uint64_t i = 0; i < job_count; ++i) {
+        if (jobs[i].state == FETCH_DONE && write_fetched_image(&jobs[i]) != 0) {
+            jobs[i].state = FETCH_FAILED;
+            jobs[i].error = "could not write image";
+        }
+        printf("%s: %s in %llu ms%s%s\n", jobs[i].host, jobs[i].state == FETCH_DONE ? "OK" : "FAILED",
+               (unsigned long long)jobs[i].latency_ms, jobs[i].error ? ": " : "", jobs[i].error ? jobs[i].error : "");
+        if (jobs[i].state != FETCH_DONE) failures++;
+    }
+    printf("%llu fetches, %d failed, %llu ms total\n", (unsigned long long)job_count, failures,
+           (unsigned long long)(monotonic_ms() - start_ms));
+    free_fetch_jobs(jobs, job_count);
+    return failures ? 1 : 0;
+}
+
+// Links a timer into the slot for its tick, which must not be in the past.
+static void wheel_insert(TimerWheel *wheel, WheelTimer *timer, uint64_t expires) {
+    timer->expires = expires;
+    uint64_t delay = expires - wheel->now;
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && delay >= (1ULL << (WHEEL_BITS * (level + 1)))) level++;
+    WheelTimer **slot = &wheel->slots[level][(expires >> (WHEEL_BITS * level)) & WHEEL_MASK];
+    timer->next = *slot;
+    if (timer->next) timer->next->pprev = &timer->next;
+    timer->pprev = slot;
+    *slot = timer;
+}
+
+static void wheel_add(TimerWheel *wheel, WheelTimer *timer, uint64_t expires) {
+    if (expires <= wheel->now) expires = wheel->now + 1;
+    if (expires - wheel->now > WHEEL_MAX_DELAY) expires = wheel->now + WHEEL_MAX_DELAY;
+    wheel_insert(wheel, timer, expires);
+}
+
+static void wheel_cancel(WheelTimer *timer) {
+    if (!timer->pprev) return;
+    *timer->pprev = timer->next;
+    if (timer->next) timer->next->pprev = timer->pprev;
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+// Moves the timers of one upper-level slot down now that the wheel has reached it.
+static int wheel_cascade(TimerWheel *wheel, int level) {
+    int index = (int)((wheel->now >> (WHEEL_BITS * level)) & WHEEL_MASK);
+    WheelTimer *timer;
+    while ((timer = wheel->slots[level][index])) {
+        wheel_cancel(timer);
+        wheel_insert(wheel, timer, timer->expires);
+    }
+    return index;
+}
+
+// Runs `ticks` seconds of the wheel, expiring every timer whose tick is reached on the way. A timer
+// armed for the current or an earlier tick fires on the next one.
+static void wheel_advance(TimerWheel *wheel, uint64_t ticks) {
+    while (ticks--) {
+        wheel->now++;
+        int index = (int)(wheel->now & WHEEL_MASK);
+        for (int level = 1; index == 0 && level < WHEEL_LEVELS; ++level) index = wheel_cascade(wheel, level);
+        index = (int)(wheel->now & WHEEL_MASK);
+        WheelTimer *timer;
+        while ((timer = wheel->slots[0][index])) {
+            wheel_cancel(timer);
+            timer->expired(timer);
+        }
+    }
+}
+
+static void plant_capture_expired(WheelTimer *timer) {
+    ((PlantSchedule*)timer)->due = 1;
+}
+
+// Reconciles the per-plant timers with plants.txt after it is re-read. A new plant, or one whose
+// name or configured_duration changed, gets its first capture after remaining_duration seconds
+// (0 = on the next tick); unchanged plants keep their running timer.
+static void sync_plant_schedules(void) {
+    if (plants.count > MAX_SCHEDULED_PLANTS) {
+        log_message("WARN: %llu plants configured; only the first %d have their own capture timer.", plants.count, MAX_SCHEDULED_PLANTS);
+    }
+    for (uint64_t i = 0; i < MAX_SCHEDULED_PLANTS; ++i) {
+        PlantSchedule *schedule = &plant_schedules[i];
+        if (i >= plants.count) {
+            if (!schedule->name) continue;
+            wheel_cancel(&schedule->timer);
+            free(schedule->name);
+            schedule->name = NULL;
+            schedule->due = 0;
+            schedule->in_flight = 0;
+            schedule->capture_version = 0;
+            schedule->last_capture = 0;
+            continue;
+        }
+
+        Plant *plant = &plants.list[i];
+        if (schedule->name && strcmp(schedule->name, plant->name) == 0 && schedule->interval == plant->configured_duration) continue;
+        wheel_cancel(&schedule->timer);
+        free(schedule->name);
+        schedule->name = strdup(plant->name);
+        schedule->interval = plant->configured_duration;
+        schedule->timer.expired = plant_capture_expired;
+        if (schedule->interval <= 0) {
+            log_message("Plant %llu (%s) has no capture interval; it is only captured by the global timer.", i + 1, plant->name);
+            continue;
+        }
+        int64_t first = plant->remaining_duration;
+        if (first < 1) first = 1;
+        if (first > schedule->interval) first = schedule->interval;
+        wheel_add(&capture_wheel, &schedule->timer, capture_wheel.now + (uint64_t)first);
+        log_message("Plant %llu (%s) scheduled every %lld seconds, first capture in %lld seconds.", i + 1, plant->name, (long long)schedule->interval, (long long)first);
+    }
+}
+
+static int plant_is_due(uint64_t plant_id) {
+    return plant_id >= 1 && plant_id <= MAX_SCHEDULED_PLANTS && plant_schedules[plant_id - 1].due;
+}
+
+// Marks every configured plant due, for the global "Start All" timer.
+static void mark_all_plants_due(void) {
+    for (uint64_t i = 0; i < plants.count && i < MAX_SCHEDULED_PLANTS; ++i) plant_schedules[i].due = 1;
+}
+
+// Formats the due plants as a plant list for generate_plant_images ("1-3,7"). Returns the number
+// of due plants.
+static uint64_t format_due_plants(char *buffer, size_t capacity) {
+    uint64_t due_count = 0;
+    size_t length = 0;
+    buffer[0] = '\0';
+    for (uint64_t id = 1; id <= plants.count; ++id) {
+        if (!plant_is_due(id)) continue;
+        uint64_t last = id;
+        while (last + 1 <= plants.count && plant_is_due(last + 1)) last++;
+        if (length < capacity) {
+            if (last > id) length += (size_t)snprintf(buffer + length, capacity - length, "%s%llu-%llu", length ? "," : "",
+                                                 (unsigned long long)id, (unsigned long long)last);
+            else length += (size_t)snprintf(buffer + length, capacity - length, "%s%llu", length ? "," : "", (unsigned long long)id);
+        }
+        due_count += last - id + 1;
+        id = last;
+    }
+    return due_count;
+}
+
+static void device_eviction_expired(WheelTimer *timer) {
+    (void)timer;
+    device_eviction_due = 1;
+}
+
+// Returns how many one-second ticks have passed since the last read. After a cycle that overran,
+// the missed ticks are returned together so the wheel catches up in one go and each plant that fell
+// due in between is captured once.
+static uint64_t read_ticks(int timer_fd) {
+    uint64_t expirations = 0;
+    if (read(timer_fd, &expirations, sizeof(expirations)) != (ssize_t)sizeof(expirations)) return 0;
+    if (expirations > 1) log_message("WARN: Cycle overran by %llu seconds; coalescing missed captures.", expirations - 1);
+    return expirations;
+}
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void report_registry_step(const char *step, uint64_t start_ns, uint64_t operations) {
+    uint64_t elapsed_ns = monotonic_ns() - start_ns;
+    printf("%-28s %10.3f ms %10.1f ns/op\n", step, elapsed_ns / 1e6, operations ? (double)elapsed_ns / operations : 0.0);
+}
+
+// Times the device registry against simulated cameras: application --bench-registry <devices>.
+// Runs the control-plane work of a busy farm (first pings, repeat pings, an unchanged devices.txt
+// reload, an assignment reload, ID lookups and eviction) without touching the data files.
+static int run_registry_benchmark(uint64_t device_count) {
+    if (device_count == 0 || device_count > 16000000) {
+        fprintf(stderr, "Usage: application --bench-registry <devices (1-16000000)>\n");
+        return 1;
+    }
+    free_pings_data();
+    pings.list = (char**)calloc(device_count, sizeof(char*));
+    if (!pings.list) return 1;
+    for (uint64_t i = 0; i < device_count; ++i) {
+        char ip[32];
+        snprintf(ip, sizeof(ip), "10.%u.%u.%u", (unsigned)((i >> 16) & 255), (unsigned)((i >> 8) & 255), (unsigned)(i & 255));
+        pings.list[i] = strdup(ip);
+        if (!pings.list[i]) return 1;
+        pings.count++;
+    }
+    printf("%llu simulated cameras\n", (unsigned long long)device_count);
+    char *text = NULL, *scratch = NULL;
+
+    uint64_t start = monotonic_ns();
+    process_device_pings();
+    report_registry_step("first ping (insert)", start, device_count);
+
+    start = monotonic_ns();
+    process_device_pings();
+    report_registry_step("repeat ping (IP lookup)", start, device_count);
+
+    // The same registry with every fourth camera assigned to a plant, as index.cgi would write it.
+    size_t text_size = 0;
+    for (int pass = 0; pass < 2; ++pass) {
+        size_t length = 0;
+        for (Device *device = devices.head; device; device = device->next) {
+            int assigned = device->id % 4 == 0;
+            length += (size_t)snprintf(pass ? text + length : NULL, pass ? text_size + 1 - length : 0, "%llu,%s,%u,%s,%c,%llu,%s\n",
+                                       (unsigned long long)device->id, device->ip, assigned ? (unsigned)(1 + device->id % 200) : 0u,
+                                       device->plant_name, assigned ? 'X' : 'U', (unsigned long long)device->ping_timestamp,
+                                       device->command);
+        }
+        if (pass == 0) {
+            text_size = length;
+            text = (char*)malloc(text_size + 1);
+            scratch = (char*)malloc(text_size + 1);
+            if (!text || !scratch) return 1;
+        }
+    }
+
+    memcpy(scratch, text, text_size + 1);
+    start = monotonic_ns();
+    load_devices_from_text(scratch);
+    report_registry_step("reload with assignments", start, device_count);
+
+    memcpy(scratch, text, text_size + 1);
+    start = monotonic_ns();
+    load_devices_from_text(scratch);
+    report_registry_step("unchanged reload", start, device_count);
+
+    start = monotonic_ns();
+    uint64_t found = 0;
+    for (uint64_t i = 0; i < device_count; ++i) found += device_find_by_id(i) != NULL;
+    report_registry_step("ID lookup", start, device_count);
+
+    uint64_t stale = 0;
+    for (Device *device = devices.head; device; device = device->next) {
+        if (device->id % 2 == 0) {
+            device->ping_timestamp = 0;
+            stale++;
+        }
+    }
+    // Eviction logs every removed device; keep that out of the timing.
+    fflush(stderr);
+    int stderr_copy = dup(STDERR_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if (null_fd >= 0) dup2(null_fd, STDERR_FILENO);
+    start = monotonic_ns();
+    uint64_t evicted = evict_stale_devices();
+    report_registry_step("evict half", start, stale);
+    if (stderr_copy >= 0) {
+        dup2(stderr_copy, STDERR_FILENO);
+        close(stderr_copy);
+    }
+    if (null_fd >= 0) close(null_fd);
+
+    printf("%llu devices found by ID, %llu evicted, %llu left; %llu slabs, %llu interned strings\n",
+           (unsigned long long)found, (unsigned long long)evicted, (unsigned long long)devices.count,
+           (unsigned long long)devices.slab_count, (unsigned long long)interned_strings.count);
+    free(text);
+    free(scratch);
+    cleanup_all_data();
+    return found == device_count && evicted == stale ? 0 : 1;
+}
+
+static uint32_t get_le32(const uint8_t *p) { return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24; }
+static uint64_t get_le64(const uint8_t *p) { return (uint64_t)get_le32(p) | (uint64_t)get_le32(p + 4) << 32; }
+static void put_le32(uint8_t *p, uint32_t v) { for (int i = 0; i < 4; ++i) p[i] = (uint8_t)(v >> (8 * i)); }
+static void put_le64(uint8_t *p, uint64_t v) { put_le32(p, (uint32_t)v); put_le32(p + 4, (uint32_t)(v >> 32)); }
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+typedef struct { int fd; uint64_t id; uint32_t sequence; uint64_t sent_ns; uint8_t waiting; } SimulatedCamera;
+
+// Heartbeat simulator: application --heartbeat-load <ip> <port> <devices> <rounds>. Each simulated
+// camera has its own socket, bound to 127.0.x.y when the target is on loopback so every camera
+// gets its own registry entry. A round sends one heartbeat per camera and ends when every reply
+// arrived or after HEARTBEAT_LOAD_TIMEOUT_MS. Reports throughput, lost replies and round-trip
+// percentiles.
+static int run_heartbeat_load(const char *host, int port, long device_count, long rounds) {
+    struct sockaddr_in target;
+    memset(&target, 0, sizeof(target));
+    target.sin_family = AF_INET;
+    target.sin_port = htons((uint16_t)port);
+    if (device_count <= 0 || rounds <= 0 || port <= 0 || port > 65535 || inet_pton(AF_INET, host, &target.sin_addr) != 1) {
+        fprintf(stderr, "Usage: application --heartbeat-load <ip> <port> <devices> <rounds>\n");
+        return 1;
+    }
+    int loopback = ntohl(target.sin_addr.s_addr) >> 24 == 127;
+    if (loopback && device_count > 62500) device_count = 62500;
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < (rlim_t)device_count + 16) {
+        limit.rlim_cur = limit.rlim_max < (rlim_t)device_count + 16 ? limit.rlim_max : (rlim_t)device_count + 16;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    SimulatedCamera *cameras = (SimulatedCamera*)calloc((size_t)device_count, sizeof(SimulatedCamera));
+    uint64_t *latencies = (uint64_t*)malloc((size_t)device_count * (size_t)rounds * sizeof(uint64_t));
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (!cameras || !latencies || epoll_fd < 0) return 1;
+    for (long i = 0; i < device_count; ++i) {
+        SimulatedCamera *camera = &cameras[i];
+        camera->id = 0x3C71BF000000ULL + (uint64_t)i;
+        camera->fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        struct sockaddr_in source;
+        memset(&source, 0, sizeof(source));
+        source.sin_family = AF_INET;
+        source.sin_addr.s_addr = htonl(loopback ? 0x7F000000u | (uint32_t)((i / 250) % 250) << 8 | (uint32_t)(1 + i % 250) : INADDR_ANY);
+        if (camera->fd < 0 || bind(camera->fd, (struct sockaddr*)&source, sizeof(source)) < 0 ||
+            connect(camera->fd, (struct sockaddr*)&target, sizeof(target)) < 0) {
+            fprintf(stderr, "Could not set up simulated camera %ld: %s\n", i, strerror(errno));
+            return 1;
+        }
+        struct epoll_event event = { .events = EPOLLIN };
+        event.data.ptr = camera;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, camera->fd, &event);
+    }
+
+    uint64_t completed = 0, lost = 0, bad = 0;
+    uint64_t start_ns = monotonic_ns();
+    for (long round = 0; round < rounds; ++round) {
+        long outstanding = 0;
+        for (long i = 0; i < device_count; ++i) {
+            SimulatedCamera *camera = &cameras[i];
+            uint8_t heartbeat[HEARTBEAT_SIZE] = {0};
+            put_le32(heartbeat, HEARTBEAT_MAGIC);
+            heartbeat[4] = HEARTBEAT_VERSION;
+            heartbeat[5] = HEARTBEAT_FLAG_CAPTURE_READY;
+            heartbeat[6] = (uint8_t)(int8_t)(-40 - i % 40);
+            put_le64(heartbeat + 8, camera->id);
+            put_le32(heartbeat + 16, ++camera->sequence);
+            put_le32(heartbeat + 20, (uint32_t)(round * 10));
+            camera->sent_ns = monotonic_ns();
+            camera->waiting = send(camera->fd, heartbeat, sizeof(heartbeat), 0) == (ssize_t)sizeof(heartbeat);
+            if (camera->waiting) outstanding++;
+            else lost++;
+        }
+        uint64_t deadline_ms = monotonic_ms() + HEARTBEAT_LOAD_TIMEOUT_MS;
+        while (outstanding > 0) {
+            uint64_t now_ms = monotonic_ms();
+            if (now_ms >= deadline_ms) break;
+            struct epoll_event ready[64];
+            int n = epoll_wait(epoll_fd, ready, 64, (int)(deadline_ms - now_ms));
+            for (int i = 0; i < n; ++i) {
+                SimulatedCamera *camera = (SimulatedCamera*)ready[i].data.ptr;
+                uint8_t reply[HEARTBEAT_REPLY_MAX];
+                ssize_t length;
+                while ((length = recv(camera->fd, reply, sizeof(reply), 0)) >= 0) {
+                    if (length < HEARTBEAT_SIZE + 1 || get_le32(reply) != HEARTBEAT_MAGIC || !(reply[5] & HEARTBEAT_FLAG_REPLY) ||
+                        get_le64(reply + 8) != camera->id || reply[HEARTBEAT_SIZE] > length - HEARTBEAT_SIZE - 1) {
+                        bad++;
+                        continue;
+                    }
+                    if (!camera->waiting || get_le32(reply + 16) != camera->sequence) continue;
+                    latencies[completed++] = monotonic_ns() - camera->sent_ns;
+                    camera->waiting = 0;
+                    outstanding--;
                 }
             }
         }
+        lost += (uint64_t)outstanding;
+    }
+    double elapsed_s = (monotonic_ns() - start_ns) / 1e9;
+
+    printf("%ld devices x %ld rounds: %.0f heartbeats/s", device_count, rounds, completed / elapsed_s);
+    if (completed > 0) {
+        qsort(latencies, completed, sizeof(uint64_t), compare_u64);
+        printf(", round trip p50 %.1f us, p99 %.1f us, max %.1f us", latencies[completed / 2] / 1e3,
+               latencies[completed * 99 / 100] / 1e3, latencies[completed - 1] / 1e3);
     }
+    printf(", %llu lost, %llu bad replies\n", (unsigned long long)lost, (unsigned long long)bad);
+    for (long i = 0; i < device_count; ++i) close(cameras[i].fd);
+    close(epoll_fd);
+    free(cameras);
+    free(latencies);
+    return lost || bad ? 1 : 0;
+}
 
-    char generate_command[256];
-    snprintf(generate_command, sizeof(generate_command), "/usr/local/bin/generate_plant_images %llu", plant_index + 1);
-    log_message("Executing generate_plant_images command: %s", generate_command);
+// Fetches the views of every due plant first, then hands them to the image service as one batch
+// so it can spread the plants across all cores. Each processed plant's timer is re-armed. The
+// service's reply is awaited on the main epoll loop (see finish_image_service_batch); while a
+// batch is in flight newly due plants stay due and go out with the next one.
+static void process_due_plants(int epoll_fd) {
+    if (service_batch.fd >= 0) return;
+    char plant_list[1024];
+    uint64_t due_count = format_due_plants(plant_list, sizeof(plant_list));
+    if (due_count == 0) return;
+    log_message("Capturing %llu due plants (%s).", due_count, plant_list);
+    uint64_t job_count = 0;
+    FetchJob *jobs = fetch_all_plant_images(&job_count);
+    int64_t captured_at = (int64_t)time(NULL);
+    for (uint64_t i = 0; i < plants.count && i < MAX_SCHEDULED_PLANTS; ++i) {
+        PlantSchedule *schedule = &plant_schedules[i];
+        if (!schedule->due) continue;
+        schedule->due = 0;
+        schedule->in_flight = 1;
+        wheel_cancel(&schedule->timer);
+        if (schedule->interval > 0) wheel_add(&capture_wheel, &schedule->timer, capture_wheel.now + (uint64_t)schedule->interval);
+    }
+
+    size_t request_capacity = 64 + strlen(plant_list) + job_count * 16;
+    char *request = (char*)malloc(request_capacity);
+    if (!request) {
+        log_message("ERR: Malloc image service request");
+        free_fetch_jobs(jobs, job_count);
+        finish_plant_captures(captured_at);
+        return;
+    }
+    int fds[MAX_HANDOFF_FRAMES];
+    int fd_count = 0;
+    size_t request_len = (size_t)snprintf(request, request_capacity, "BATCH %s", plant_list);
+    for (uint64_t i = 0; i < job_count; ++i) {
+        FetchJob *job = &jobs[i];
+        if (job->state != FETCH_DONE) continue;
+        int fd = fd_count < MAX_HANDOFF_FRAMES ? create_frame_memfd(job) : -1;
+        if (fd < 0) {
+            write_fetched_image(job);
+            continue;
+        }
+        if (fd_count == 0) request_len += (size_t)snprintf(request + request_len, request_capacity - request_len, " FRAMES");
+        request_len += (size_t)snprintf(request + request_len, request_capacity - request_len, " %u%c", job->plant_id, job->position);
+        fds[fd_count++] = fd;
+        job->handed_off = 1;
+    }
+    // Cameras that did not deliver are reported as missing views; the image service substitutes
+    // its cached placeholder for them.
+    char *missing = (char*)malloc(job_count * 8 + 1);
+    size_t missing_len = 0;
+    if (missing) {
+        missing[0] = '\0';
+        for (uint64_t i = 0; i < job_count; ++i) {
+            if (jobs[i].state == FETCH_DONE) continue;
+            missing_len += (size_t)sprintf(missing + missing_len, "%s%u%c", missing_len ? "," : "", jobs[i].plant_id, jobs[i].position);
+        }
+    }
+    if (missing_len) {
+        request_len += (size_t)snprintf(request + request_len, request_capacity - request_len, " MISSING ");
+        for (size_t i = 0; i < missing_len && request_len + 1 < request_capacity; ++i) {
+            request[request_len++] = missing[i] == ',' ? ' ' : missing[i];
+        }
+        request[request_len] = '\0';
+    }
+    snprintf(request + request_len, request_capacity - request_len, "\n");
+
+    uint64_t service_start = trace_begin();
+    int service_fd = request_image_processing(request, fds, fd_count);
+    // The socket holds its own references to the frames once they are sent.
+    for (int i = 0; i < fd_count; ++i) close(fds[i]);
+
+    if (service_fd >= 0) {
+        struct epoll_event event = { .events = EPOLLIN };
+        event.data.fd = service_fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, service_fd, &event) == 0) {
+            service_batch.fd = service_fd;
+            service_batch.jobs = jobs;
+            service_batch.job_count = job_count;
+            service_batch.due_count = due_count;
+            service_batch.frame_count = fd_count;
+            service_batch.captured_at = captured_at;
+            service_batch.start_us = service_start;
+            service_batch.request = request;
+            free(missing);
+            return;
+        }
+        log_message("ERR: epoll_ctl for image service reply: %s", strerror(errno));
+        close(service_fd);
+    }
+    trace_end("image_service_request", service_start, request);
+    free(request);
+
+    // The service writes the disk copies of handed-over frames itself; it did not take the batch,
+    // so write them here for the dashboard and the fallback below.
+    for (uint64_t i = 0; i < job_count; ++i) {
+        if (jobs[i].handed_off) write_fetched_image(&jobs[i]);
+    }
+    free_fetch_jobs(jobs, job_count);
+
+    size_t command_capacity = 128 + strlen(plant_list) + missing_len;
+    char *generate_command = (char*)malloc(command_capacity);
+    if (!generate_command) {
+        log_message("ERR: Malloc generate_plant_images command");
+        free(missing);
+        finish_plant_captures(captured_at);
+        return;
+    }
+    int command_len = snprintf(generate_command, command_capacity, "/usr/local/bin/generate_plant_images --local --batch %s", plant_list);
+    if (missing_len) snprintf(generate_command + command_len, command_capacity - (size_t)command_len, " --missing %s", missing);
+    free(missing);
+    log_message("Image service unavailable. Executing generate_plant_images command: %s", generate_command);
+    uint64_t gen_start = trace_begin();
     int ret_gen = system(generate_command);
+    trace_end("exec generate_plant_images", gen_start, generate_command);
     if (ret_gen == -1) {
         log_message("ERR: Failed to execute generate_plant_images command.");
     } else if (ret_gen != 0) {
@@ -267,6 +1580,112 @@ static void process(uint64_t plant_index) {
     } else {
         log_message("generate_plant_images command executed successfully.");
     }
+    free(generate_command);
+    finish_plant_captures(captured_at);
+}
+
+// Stamps the plants of the batch that just finished with a new captures_version. This runs only
+// once the batch is processed, so the state segment never announces a capture ahead of the
+// metrics it stands for.
+static void finish_plant_captures(int64_t captured_at) {
+    ++captures_version;
+    for (uint64_t i = 0; i < MAX_SCHEDULED_PLANTS; ++i) {
+        PlantSchedule *schedule = &plant_schedules[i];
+        if (!schedule->in_flight) continue;
+        schedule->in_flight = 0;
+        schedule->capture_version = captures_version;
+        schedule->last_capture = captured_at;
+    }
+}
+
+// Reads the image service's reply to the batch in flight, once epoll reports it readable.
+static void finish_image_service_batch(int epoll_fd) {
+    char reply[128];
+    ssize_t n = read(service_batch.fd, reply, sizeof(reply) - 1);
+    if (n < 0 && (errno == EINTR || errno == EAGAIN)) return;
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, service_batch.fd, NULL);
+    close(service_batch.fd);
+    service_batch.fd = -1;
+    trace_end("image_service_request", service_batch.start_us, service_batch.request);
+
+    const char *request = service_batch.request;
+    int request_line = (int)strcspn(request, "\n");
+    int ok = 0;
+    if (n <= 0) {
+        log_message("ERR: No reply from image service for request '%.*s'.", request_line, request);
+    } else {
+        reply[n] = '\0';
+        reply[strcspn(reply, "\n")] = '\0';
+        ok = strcmp(reply, "OK") == 0;
+        if (!ok) log_message("WARN: Image service replied '%s' for request '%.*s'.", reply, request_line, request);
+    }
+
+    if (ok) {
+        log_message("Image service processed %llu plants successfully (%d frames handed over in memory).",
+                    service_batch.due_count, service_batch.frame_count);
+    } else {
+        log_message("WARN: Image service reported a failure for the batch of %llu plants.", service_batch.due_count);
+        // Handed-over frames are written by the service; without its OK, write them here so the
+        // dashboard still shows this cycle's images.
+        for (uint64_t i = 0; i < service_batch.job_count; ++i) {
+            if (service_batch.jobs[i].handed_off) write_fetched_image(&service_batch.jobs[i]);
+        }
+    }
+    free_fetch_jobs(service_batch.jobs, service_batch.job_count);
+    free(service_batch.request);
+    service_batch.jobs = NULL;
+    service_batch.request = NULL;
+    finish_plant_captures(service_batch.captured_at);
+}
+
+// Sends one request line to the resident generate_plant_images service, with `fds` attached as
+// SCM_RIGHTS ancillary data when fd_count > 0.
+// Returns the connected socket, on which the service writes "OK\n" or "ERR <reason>\n" once the
+// request is done, or -1 if the service could not be reached.
+static int request_image_processing(const char *request, const int *fds, int fd_count) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        log_message("ERR: socket for image service: %s", strerror(errno));
+        return -1;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, IMAGE_SERVICE_SOCKET, sizeof(addr.sun_path) - 1);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        log_message("WARN: Could not connect to image service at %s: %s", IMAGE_SERVICE_SOCKET, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    size_t request_len = strlen(request);
+    struct iovec iov = { (void*)request, request_len };
+    union {
+        char buffer[CMSG_SPACE(sizeof(int) * MAX_HANDOFF_FRAMES)];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (fd_count > 0) {
+        memset(&control, 0, sizeof(control));
+        msg.msg_control = control.buffer;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * fd_count);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fd_count);
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * fd_count);
+    }
+    if (sendmsg(fd, &msg, MSG_NOSIGNAL) != (ssize_t)request_len) {
+        log_message("ERR: Sending job to image service: %s", strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
 }
 
 static void read_pings_from_file(void) {
@@ -274,213 +1693,292 @@ static void read_pings_from_file(void) {
     char *content = read_file(PING_FILE);
     if (!content) return;
     char *token, *rest = content;
+    // Repeated IPs are kept: process_device_pings looks each one up and a repeat is a no-op.
     while ((token = strtok_r(rest, ",\n", &rest))) {
-        int is_unique = 1;
-        for (uint64_t i = 0; i < pings.count; ++i) {
-            if (strcmp(pings.list[i], token) == 0) {
-                is_unique = 0;
-                break;
-            }
-        }
-        if (is_unique) {
-            pings.list = (char**)realloc(pings.list, (pings.count + 1) * sizeof(char*));
-            if (!pings.list) {
-                log_message("ERR: Realloc pings");
-                free(content);
-                return;
-            }
-            pings.list[pings.count++] = strdup(token);
+        pings.list = (char**)realloc(pings.list, (pings.count + 1) * sizeof(char*));
+        if (!pings.list) {
+            log_message("ERR: Realloc pings");
+            pings.count = 0;
+            free(content);
+            return;
         }
+        pings.list[pings.count++] = strdup(token);
     }
     free(content);
 }
 
-static void reset_ping_file(void) { write_file(PING_FILE, ""); }
+// Truncated in place rather than replaced: the ping endpoint appends to the file by name and a rename
+// could swallow an append to the old inode.
+static void reset_ping_file(void) {
+    if (truncate(PING_FILE, 0) != 0 && errno != ENOENT) log_message("ERR: Truncate %s: %s", PING_FILE, strerror(errno));
+}
 
-static void read_devices_from_file(void) {
-    free_devices_data();
-    char *content = read_file(DEVICES_FILE);
-    if (!content) return;
+// Reconciles the registry with a devices.txt image (modified in place): listed devices are
+// updated or added, unlisted ones removed.
+static void load_devices_from_text(char *content) {
+    for (Device *device = devices.head; device; device = device->next) device->seen = 0;
+    // Z-position devices follow the first plant, taken from the plant list already in memory.
+    const char *first_plant_name = plants.count > 0 ? plants.list[0].name : NULL;
 
     char *line, *rest_lines = content;
     while ((line = strtok_r(rest_lines, "\n", &rest_lines))) {
-        Device new_dev = {0};
-        new_dev.pinged_this_cycle = 0;
-        new_dev.plant_name = NULL;
-
-        char *field, *line_copy_for_strtok = strdup(line);
-        if (!line_copy_for_strtok) {
-            log_message("ERR: strdup line for parsing devices. Skipping line.");
-            continue;
-        }
-        char *current_pos = line_copy_for_strtok;
-        char *endptr;
+        char *current_pos = line;
+        char *field;
 
         field = strtok_r(current_pos, ",", &current_pos);
-        if (!field) { log_message("ERR: Missing ID in DEVICES_FILE line: %s", line); free(line_copy_for_strtok); continue; }
-        new_dev.id = strtoull(field, &endptr, 10);
+        if (!field) { log_message("ERR: Missing ID in DEVICES_FILE line: %s", line); continue; }
+        uint64_t id = strtoull(field, NULL, 10);
 
-        field = strtok_r(current_pos, ",", &current_pos);
-        if (!field) { log_message("ERR: Missing IP in DEVICES_FILE line: %s", line); free(line_copy_for_strtok); continue; }
-        new_dev.ip = strdup(field);
-        if (!new_dev.ip) { log_message("ERR: strdup new_dev.ip"); free(line_copy_for_strtok); continue; }
+        char *ip = strtok_r(current_pos, ",", &current_pos);
+        if (!ip) { log_message("ERR: Missing IP in DEVICES_FILE line: %s", line); continue; }
 
         field = strtok_r(current_pos, ",", &current_pos);
-        if (!field) { log_message("ERR: Missing plant_id in DEVICES_FILE line: %s", line); free(new_dev.ip); free(line_copy_for_strtok); continue; }
-        new_dev.plant_id = (uint8_t)strtoul(field, &endptr, 10);
+        if (!field) { log_message("ERR: Missing plant_id in DEVICES_FILE line: %s", line); continue; }
+        uint8_t plant_id = (uint8_t)strtoul(field, NULL, 10);
 
-        field = strtok_r(current_pos, ",", &current_pos);
-        if (!field) {
+        const char *plant_name = strtok_r(current_pos, ",", &current_pos);
+        if (!plant_name) {
             log_message("WARN: Missing plant_name in DEVICES_FILE line: %s. Using 'Unassigned'.", line);
-            new_dev.plant_name = strdup("Unassigned");
-        } else {
-            new_dev.plant_name = strdup(field);
+            plant_name = "Unassigned";
         }
-        if (!new_dev.plant_name) { log_message("ERR: strdup new_dev.plant_name"); free(new_dev.ip); free(line_copy_for_strtok); continue; }
 
         field = strtok_r(current_pos, ",", &current_pos);
-        if (!field || strlen(field) != 1) { log_message("ERR: Missing or malformed position in DEVICES_FILE line: %s", line); free(new_dev.ip); free(new_dev.plant_name); free(line_copy_for_strtok); continue; }
-        new_dev.position = (uint8_t)field[0];
+        if (!field || strlen(field) != 1) { log_message("ERR: Missing or malformed position in DEVICES_FILE line: %s", line); continue; }
+        uint8_t position = (uint8_t)field[0];
 
-        if (new_dev.position == 'Z') {
-            char* first_plant_name = get_first_plant_name();
-            if (new_dev.plant_name) {
-                free(new_dev.plant_name);
-            }
+        if (position == 'Z') {
             if (first_plant_name) {
-                new_dev.plant_name = first_plant_name;
-                log_message("DEBUG: Device %llu at Z position, assigned plant_name to '%s' from PLANTS_FILE.", new_dev.id, new_dev.plant_name);
+                plant_name = first_plant_name;
             } else {
-                new_dev.plant_name = strdup("Unassigned");
-                log_message("WARN: Device %llu at Z position, could not find first plant name. Assigned 'Unassigned'.", new_dev.id);
-            }
-            if (!new_dev.plant_name) {
-                log_message("CRITICAL ERR: Failed to strdup plant name for Z position.");
-                free(new_dev.ip); free(line_copy_for_strtok); continue;
+                plant_name = "Unassigned";
+                log_message("WARN: Device %llu at Z position, could not find first plant name. Assigned 'Unassigned'.", id);
             }
         }
 
-
         field = strtok_r(current_pos, ",", &current_pos);
-        if (!field) { log_message("ERR: Missing ping_timestamp in DEVICES_FILE line: %s", line); free(new_dev.ip); free(new_dev.plant_name); free(line_copy_for_strtok); continue; }
-        new_dev.ping_timestamp = strtoull(field, &endptr, 10);
+        if (!field) { log_message("ERR: Missing ping_timestamp in DEVICES_FILE line: %s", line); continue; }
+        uint64_t ping_timestamp = strtoull(field, NULL, 10);
 
-        if (current_pos && strlen(current_pos) > 0) {
-            size_t cmd_len = strlen(current_pos);
-            if (cmd_len > 0 && current_pos[cmd_len - 1] == '\n') {
-                current_pos[cmd_len - 1] = '\0';
-            }
-            new_dev.command = strdup(current_pos);
+        char *command = "NO_COMMAND";
+        if (current_pos && strlen(current_pos) > 0) command = current_pos;
+
+        Device *device = device_find_by_id(id);
+        if (!device) {
+            device = device_add(id, ip, plant_id, plant_name, position, ping_timestamp, command);
+            if (!device) continue;
         } else {
-            new_dev.command = strdup("NO_COMMAND");
-        }
-        if (!new_dev.command) { log_message("ERR: strdup new_dev.command"); free(new_dev.ip); free(new_dev.plant_name); free(line_copy_for_strtok); continue; }
-        
-        devices.list = (Device*)realloc(devices.list, (devices.count + 1) * sizeof(Device));
-        if (!devices.list) {
-            log_message("ERR: Realloc devices list");
-            free(new_dev.ip); free(new_dev.plant_name); free(new_dev.command); free(line_copy_for_strtok);
-            free(content);
-            devices.count = 0;
-            return;
+            if (strcmp(device->ip, ip) != 0) {
+                device_unindex(device);
+                assign_string(&device->ip, ip);
+                device_index(device);
+            }
+            device->plant_id = plant_id;
+            assign_string(&device->plant_name, plant_name);
+            device->position = position;
+            device->ping_timestamp = ping_timestamp;
+            assign_string(&device->command, command);
         }
-        devices.list[devices.count++] = new_dev;
-        if (new_dev.id >= id_generator) id_generator = new_dev.id + 1;
-        
-        free(line_copy_for_strtok);
+        device->seen = 1;
+    }
+
+    Device *device = devices.head;
+    while (device) {
+        Device *next = device->next;
+        if (!device->seen) device_remove(device);
+        device = next;
     }
+    // The registry now mirrors the file, which is no longer what the application last published.
+    devices.version++;
+    devices.written_version = devices.version;
+    devices_published.length = SIZE_MAX;
+}
+
+static void read_devices_from_file(void) {
+    char *content = read_file(DEVICES_FILE);
+    if (!content) return;
+    load_devices_from_text(content);
     free(content);
 }
 
 static void process_device_pings(void) {
     time_t current_time = time(NULL);
-    for (uint64_t i = 0; i < devices.count; ++i) devices.list[i].pinged_this_cycle = 0;
+    for (Device *device = devices.head; device; device = device->next) device->pinged_this_cycle = 0;
 
     for (uint64_t j = 0; j < pings.count; ++j) {
-        char *ping_ip = pings.list[j];
-        int found = 0;
-        for (uint64_t i = 0; i < devices.count; ++i) {
-            if (strcmp(devices.list[i].ip, ping_ip) == 0) {
-                devices.list[i].ping_timestamp = (uint64_t)current_time;
-                devices.list[i].pinged_this_cycle = 1;
-                found = 1;
-                break;
-            }
+        Device *device = device_find_by_ip(pings.list[j]);
+        if (!device) {
+            device = device_add(generate_new_id(), pings.list[j], 0, "Unassigned", 'U', (uint64_t)current_time, "NO_COMMAND");
+            if (!device) continue;
         }
-        if (!found) {
-            Device new_dev;
-            new_dev.id = generate_new_id();
-            new_dev.ip = strdup(ping_ip);
-            if (!new_dev.ip) {
-                log_message("ERR: strdup new dev IP");
+        device->ping_timestamp = (uint64_t)current_time;
+        device->pinged_this_cycle = 1;
+    }
+    if (pings.count > 0) devices.version++;
+}
+
+// Drops devices that have not pinged for DEVICE_STALE_SECONDS. Returns how many were dropped.
+static uint64_t evict_stale_devices(void) {
+    time_t current_time = time(NULL);
+    uint64_t evicted = 0;
+    Device *device = devices.head;
+    while (device) {
+        Device *next = device->next;
+        if ((int64_t)(current_time - device->ping_timestamp) > DEVICE_STALE_SECONDS) {
+            log_message("Device %llu (IP: %s) has not pinged for %d seconds. Removing it.", device->id, device->ip, DEVICE_STALE_SECONDS);
+            device_remove(device);
+            evicted++;
+        }
+        device = next;
+    }
+    return evicted;
+}
+
+static int heartbeat_port(void) {
+    const char *value = getenv("PLANT_MONITOR_HEARTBEAT_PORT");
+    int port = value ? atoi(value) : 0;
+    return port > 0 && port < 65536 ? port : HEARTBEAT_PORT;
+}
+
+// Binds the heartbeat listener. Returns -1 (cameras keep using the HTTP ping) if that fails.
+static int open_heartbeat_socket(void) {
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons((uint16_t)heartbeat_port());
+    int buffer_size = 1 << 20;
+    if (fd >= 0) setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+    if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        log_message("WARN: Cannot listen for UDP heartbeats on port %d (%s). Only HTTP pings will be seen.", heartbeat_port(), strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Drains the heartbeat socket in batches of HEARTBEAT_BATCH with recvmmsg. Each valid heartbeat
+// counts as a ping from its source address and is answered, in one sendmmsg per batch, with the
+// command of the device registered at that address.
+static void receive_heartbeats(int heartbeat_fd) {
+    static uint8_t requests[HEARTBEAT_BATCH][HEARTBEAT_SIZE];
+    static uint8_t replies[HEARTBEAT_BATCH][HEARTBEAT_REPLY_MAX];
+    struct sockaddr_in senders[HEARTBEAT_BATCH];
+    struct iovec request_iov[HEARTBEAT_BATCH], reply_iov[HEARTBEAT_BATCH];
+    struct mmsghdr request_msgs[HEARTBEAT_BATCH], reply_msgs[HEARTBEAT_BATCH];
+    time_t current_time = time(NULL);
+    uint64_t received = 0, rejected = 0;
+
+    for (int batch = 0; batch < HEARTBEAT_MAX_BATCHES; ++batch) {
+        memset(request_msgs, 0, sizeof(request_msgs));
+        for (int i = 0; i < HEARTBEAT_BATCH; ++i) {
+            request_iov[i].iov_base = requests[i];
+            request_iov[i].iov_len = HEARTBEAT_SIZE;
+            request_msgs[i].msg_hdr.msg_iov = &request_iov[i];
+            request_msgs[i].msg_hdr.msg_iovlen = 1;
+            request_msgs[i].msg_hdr.msg_name = &senders[i];
+            request_msgs[i].msg_hdr.msg_namelen = sizeof(senders[i]);
+        }
+        int n = recvmmsg(heartbeat_fd, request_msgs, HEARTBEAT_BATCH, MSG_DONTWAIT, NULL);
+        if (n <= 0) {
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) log_message("ERR: recvmmsg: %s", strerror(errno));
+            break;
+        }
+
+        int reply_count = 0;
+        for (int i = 0; i < n; ++i) {
+            const uint8_t *request = requests[i];
+            if (request_msgs[i].msg_len != HEARTBEAT_SIZE || (request_msgs[i].msg_hdr.msg_flags & MSG_TRUNC) ||
+                get_le32(request) != HEARTBEAT_MAGIC || request[4] != HEARTBEAT_VERSION) {
+                rejected++;
                 continue;
             }
-            new_dev.plant_id = 0;
-            new_dev.plant_name = strdup("Unassigned");
-            if (!new_dev.plant_name) {
-                log_message("ERR: strdup new dev plant_name");
-                free(new_dev.ip);
-                continue;
+            char ip[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &senders[i].sin_addr, ip, sizeof(ip));
+            Device *device = device_find_by_ip(ip);
+            if (!device) {
+                device = device_add(generate_new_id(), ip, 0, "Unassigned", 'U', (uint64_t)current_time, "NO_COMMAND");
+                if (!device) continue;
+                log_message("New device %llu (IP: %s) announced by UDP heartbeat.", device->id, ip);
             }
-            new_dev.position = 'U';
-            new_dev.ping_timestamp = (uint64_t)current_time;
-            new_dev.command = strdup("NO_COMMAND");
-            if (!new_dev.command) {
-                free(new_dev.ip);
-                free(new_dev.plant_name);
-                continue;
+            uint32_t sequence = get_le32(request + 16), uptime = get_le32(request + 20);
+            // Late duplicates do not move the device backwards; a lower uptime means it rebooted.
+            if (!device->has_heartbeat || sequence > device->heartbeat_sequence || uptime < device->uptime) {
+                device->has_heartbeat = 1;
+                device->heartbeat_flags = request[5];
+                device->rssi = (int8_t)request[6];
+                device->heartbeat_sequence = sequence;
+                device->uptime = uptime;
             }
-            new_dev.pinged_this_cycle = 1;
-            devices.list = (Device*)realloc(devices.list, (devices.count + 1) * sizeof(Device));
-            if (!devices.list) {
-                log_message("ERR: Realloc new dev");
-                free(new_dev.ip);
-                free(new_dev.plant_name);
-                free(new_dev.command);
-                return;
+            device->ping_timestamp = (uint64_t)current_time;
+            received++;
+
+            uint8_t *reply = replies[reply_count];
+            const char *command = device->command ? device->command : "NO_COMMAND";
+            size_t command_length = strlen(command);
+            if (command_length > HEARTBEAT_COMMAND_MAX) command_length = HEARTBEAT_COMMAND_MAX;
+            memcpy(reply, request, HEARTBEAT_SIZE);
+            reply[5] |= HEARTBEAT_FLAG_REPLY;
+            reply[HEARTBEAT_SIZE] = (uint8_t)command_length;
+            memcpy(reply + HEARTBEAT_SIZE + 1, command, command_length);
+            reply_iov[reply_count].iov_base = reply;
+            reply_iov[reply_count].iov_len = HEARTBEAT_SIZE + 1 + command_length;
+            memset(&reply_msgs[reply_count], 0, sizeof(reply_msgs[reply_count]));
+            reply_msgs[reply_count].msg_hdr.msg_iov = &reply_iov[reply_count];
+            reply_msgs[reply_count].msg_hdr.msg_iovlen = 1;
+            reply_msgs[reply_count].msg_hdr.msg_name = &senders[i];
+            reply_msgs[reply_count].msg_hdr.msg_namelen = sizeof(senders[i]);
+            reply_count++;
+        }
+        for (int sent = 0; sent < reply_count;) {
+            int m = sendmmsg(heartbeat_fd, reply_msgs + sent, (unsigned int)(reply_count - sent), MSG_DONTWAIT);
+            if (m <= 0) {
+                log_message("WARN: Dropped %d heartbeat replies: %s", reply_count - sent, m < 0 ? strerror(errno) : "nothing sent");
+                break;
             }
-            devices.list[devices.count++] = new_dev;
+            sent += m;
         }
+        if (n < HEARTBEAT_BATCH) break;
     }
-
-    uint64_t i = 0;
-    while (i < devices.count) {
-        if (devices.list[i].pinged_this_cycle == 0 && (current_time - devices.list[i].ping_timestamp > 60)) {
-            free(devices.list[i].ip);
-            if (devices.list[i].plant_name) free(devices.list[i].plant_name);
-            free(devices.list[i].command);
-            for (uint64_t k = i; k < devices.count - 1; ++k) devices.list[k] = devices.list[k + 1];
-            devices.count--;
-            if (devices.count > 0) devices.list = (Device*)realloc(devices.list, devices.count * sizeof(Device));
-            else { free(devices.list); devices.list = NULL; }
-        } else { i++; }
-    }
+    if (received > 0) devices.version++;
+    if (rejected > 0) log_message("WARN: Ignored %llu malformed heartbeat datagrams.", rejected);
 }
 
+// Serialises the registry in one pass into a buffer reused across writes, and publishes it only if
+// the registry changed since the last write and the text differs from what was last published.
 static void write_devices_to_file(void) {
-    if (devices.count == 0) { write_file(DEVICES_FILE, ""); return; }
-    size_t buf_sz = 0;
-    for (uint64_t i = 0; i < devices.count; ++i) {
-        buf_sz += snprintf(NULL, 0, "%llu,%s,%hhu,%s,%c,%llu,%s\n",
-                           devices.list[i].id, devices.list[i].ip, devices.list[i].plant_id,
-                           devices.list[i].plant_name ? devices.list[i].plant_name : "Unassigned",
-                           devices.list[i].position, devices.list[i].ping_timestamp,
-                           devices.list[i].command ? devices.list[i].command : "NO_COMMAND");
-    }
-    char *buffer = (char*)malloc(buf_sz + 1);
-    if (!buffer) { log_message("ERR: Malloc dev write"); return; }
-    buffer[0] = '\0';
-    for (uint64_t i = 0; i < devices.count; ++i) {
-        char line[512];
-        snprintf(line, sizeof(line), "%llu,%s,%hhu,%s,%c,%llu,%s\n",
-                 devices.list[i].id, devices.list[i].ip, devices.list[i].plant_id,
-                 devices.list[i].plant_name ? devices.list[i].plant_name : "Unassigned",
-                 devices.list[i].position, devices.list[i].ping_timestamp,
-                 devices.list[i].command ? devices.list[i].command : "NO_COMMAND");
-        strcat(buffer, line);
+    if (devices.version == devices.written_version) return;
+
+    TextBuffer *text = &devices_text;
+    text->length = 0;
+    for (Device *device = devices.head; device;) {
+        int n = snprintf(text->data + text->length, text->capacity - text->length, "%llu,%s,%hhu,%s,%c,%llu,%s\n",
+                         (unsigned long long)device->id, device->ip, device->plant_id,
+                         device->plant_name ? device->plant_name : "Unassigned",
+                         device->position, (unsigned long long)device->ping_timestamp,
+                         device->command ? device->command : "NO_COMMAND");
+        if (text->length + (size_t)n < text->capacity) {
+            text->length += (size_t)n;
+            device = device->next;
+            continue;
+        }
+        size_t capacity = text->capacity ? text->capacity * 2 : 4096;
+        while (capacity <= text->length + (size_t)n) capacity *= 2;
+        char *grown = (char*)realloc(text->data, capacity);
+        if (!grown) { log_message("ERR: Malloc dev write"); return; }
+        text->data = grown;
+        text->capacity = capacity;
     }
-    write_file(DEVICES_FILE, buffer);
-    free(buffer);
+
+    if (text->length == devices_published.length && (text->length == 0 || memcmp(text->data, devices_published.data, text->length) == 0)) {
+        devices.written_version = devices.version;
+        return;
+    }
+    if (write_file_data(DEVICES_FILE, text->data ? text->data : "", text->length) != 0) return;
+    devices.written_version = devices.version;
+    TextBuffer published = devices_published;
+    devices_published = devices_text;
+    devices_text = published;
 }
 
 static void read_plants_from_file(void) {
@@ -514,75 +2012,82 @@ static void read_plants_from_file(void) {
         plants.list[plants.count++] = new_plant;
     }
     free(content);
+    plants_version++;
 }
 
+static void read_processes_from_file(void) {
+    char *processes_content = read_file(PROCESSES_FILE);
+    global_timer.loaded = processes_content != NULL;
+    global_timer.version++;
+    if (!processes_content) return;
+    global_timer.start = 0;
+    global_timer.duration = 3600;
+    char *ts_curr_str = strtok(processes_content, ",");
+    char *ts_set_str = strtok(NULL, "\n");
+    if (ts_curr_str) global_timer.start = strtoll(ts_curr_str, NULL, 10);
+    if (ts_set_str) global_timer.duration = strtoll(ts_set_str, NULL, 10);
+    free(processes_content);
+
+    long long global_time_remaining = global_timer.start + global_timer.duration - (long long)time(NULL);
+    if (global_timer.start != 0 && global_time_remaining > 0) {
+        log_message("Global process timer is active (%lld seconds remaining). Waiting for expiration.", global_time_remaining);
+    }
+}
+
+static void write_processes_to_file(void) {
+    char new_processes_content[128];
+    snprintf(new_processes_content, sizeof(new_processes_content), "%lld,%lld\n", global_timer.start, global_timer.duration);
+    write_file(PROCESSES_FILE, new_processes_content);
+    global_timer.version++;
+}
+
+// The global "Start All" timer, checked every tick against the values last read from
+// processes.txt. When it starts or expires every plant is marked due; the capture itself happens in
+// process_due_plants, together with any per-plant timers.
 static void manage_global_process_and_plants(void) {
-    log_message("Managing global process and plant processing.");
+    // Start time of the global cycle already acted on, so a fresh start is only handled once.
+    static long long global_handled_timestamp = 0;
     time_t current_time = time(NULL);
 
-    char *processes_content = read_file(PROCESSES_FILE);
-    long long global_current_timestamp = 0;
-    long long global_set_duration = 3600;
-
-    if (processes_content) {
-        char *temp_content = strdup(processes_content);
-        if (temp_content) {
-            char *ts_curr_str = strtok(temp_content, ",");
-            char *ts_set_str = strtok(NULL, "\n");
-            if (ts_curr_str) global_current_timestamp = strtoll(ts_curr_str, NULL, 10);
-            if (ts_set_str) global_set_duration = strtoll(ts_set_str, NULL, 10);
-            free(temp_content);
-        } else {
-            log_message("ERR: strdup failed for processes_content in manage_global_process_and_plants.");
-        }
-        free(processes_content);
-    } else {
+    if (!global_timer.loaded) {
         log_message("WARN: processes.txt not found or unreadable. Initializing default timer.");
-        char initial_content[128];
-        snprintf(initial_content, sizeof(initial_content), "%lld,%lld\n", (long long)current_time, global_set_duration);
-        write_file(PROCESSES_FILE, initial_content);
+        global_timer.start = (long long)current_time;
+        global_timer.loaded = 1;
+        write_processes_to_file();
         log_message("processes.txt initialized with current time. Triggering initial processing.");
-        if (plants.count > 0) {
-            for (uint64_t i = 0; i < plants.count; ++i) {
-                process(i);
-            }
-        }
+        global_handled_timestamp = global_timer.start;
+        mark_all_plants_due();
         return;
     }
 
-    long long global_time_elapsed = (long long)(current_time - global_current_timestamp);
-    long long global_time_remaining = global_set_duration - global_time_elapsed;
+    long long global_time_elapsed = (long long)current_time - global_timer.start;
+    long long global_time_remaining = global_timer.duration - global_time_elapsed;
 
     int should_process_plants = 0;
 
-    if (global_current_timestamp == 0) {
+    if (global_timer.start == 0) {
         should_process_plants = 1;
         log_message("Global timer is 0. Will start and process plants.");
     } else if (global_time_remaining <= 0) {
         should_process_plants = 1;
         log_message("Global timer expired. Will reset and process plants.");
-    } else if (global_time_elapsed >= 0 && global_time_elapsed < 5) {
+    } else if (global_timer.start != global_handled_timestamp && global_time_elapsed >= 0 && global_time_elapsed < 5) {
         should_process_plants = 1;
         log_message("Global timer just started/reset. Will process plants immediately.");
     }
 
     if (should_process_plants) {
-        char new_processes_content[128];
-        snprintf(new_processes_content, sizeof(new_processes_content), "%lld,%lld\n", (long long)current_time, global_set_duration);
-        write_file(PROCESSES_FILE, new_processes_content);
+        global_timer.start = (long long)current_time;
+        write_processes_to_file();
+        global_handled_timestamp = global_timer.start;
         log_message("Global timestamp updated to current time for processing cycle.");
 
         if (plants.count == 0) {
             log_message("No plants defined to process.");
         } else {
-            log_message("Iterating through all plants for processing.");
-            for (uint64_t i = 0; i < plants.count; ++i) {
-                process(i);
-            }
-            log_message("Finished processing for this cycle.");
+            log_message("Marking all plants due for processing.");
+            mark_all_plants_due();
         }
-    } else {
-        log_message("Global process timer is active (%lld seconds remaining). Waiting for expiration.", global_time_remaining);
     }
 }
 
@@ -590,6 +2095,124 @@ static void write_plants_to_file(void) {
     // This function is now a no-op as application.c should not write to PLANTS_FILE
 }
 
+// Creates (or takes over) the shared-memory state segment. Without it the CGIs keep reading the
+// text files, so failures are only logged.
+static void open_plant_state(void) {
+    int fd = open(PLANT_STATE_PATH, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0 || ftruncate(fd, sizeof(PlantState)) != 0) {
+        log_message("WARN: Cannot create %s (%s). CGIs will read the data files.", PLANT_STATE_PATH, strerror(errno));
+        if (fd >= 0) close(fd);
+        return;
+    }
+    void *map = mmap(NULL, sizeof(PlantState), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        log_message("WARN: Cannot map %s (%s). CGIs will read the data files.", PLANT_STATE_PATH, strerror(errno));
+        return;
+    }
+    plant_state = (PlantState*)map;
+    // Readers ignore the segment until the first publish sets the magic again.
+    plant_state_write_begin(plant_state);
+    __atomic_store_n(&plant_state->magic, 0, __ATOMIC_RELAXED);
+    plant_state->layout = PLANT_STATE_LAYOUT;
+    plant_state->writer_pid = (int64_t)getpid();
+    plant_state_write_end(plant_state);
+}
+
+// Copies the registry, the plant list, the global timer and the capture versions into the state
+// segment if any of them changed since the last publish.
+static void publish_plant_state(void) {
+    if (!plant_state) return;
+    if (plant_state_published.valid && plant_state_published.devices == devices.version &&
+        plant_state_published.plants == plants_version && plant_state_published.processes == global_timer.version &&
+        plant_state_published.captures == captures_version) return;
+
+    PlantState *state = plant_state;
+    plant_state_write_begin(state);
+    state->devices_version = devices.version;
+    state->plants_version = plants_version;
+    state->processes_version = global_timer.version;
+    state->captures_version = captures_version;
+    state->global_timer_start = global_timer.start;
+    state->global_timer_duration = global_timer.duration;
+    state->processes_loaded = global_timer.loaded;
+
+    uint32_t count = 0;
+    for (Device *device = devices.head; device && count < PLANT_STATE_MAX_DEVICES; device = device->next) {
+        PlantStateDevice *record = &state->devices[count++];
+        record->id = device->id;
+        record->ping_timestamp = device->ping_timestamp;
+        snprintf(record->ip, sizeof(record->ip), "%s", device->ip);
+        snprintf(record->plant_name, sizeof(record->plant_name), "%s", device->plant_name ? device->plant_name : "Unassigned");
+        snprintf(record->command, sizeof(record->command), "%s", device->command ? device->command : "NO_COMMAND");
+        record->plant_id = device->plant_id;
+        record->position = device->position;
+        record->rssi = device->rssi;
+        record->heartbeat_flags = device->heartbeat_flags;
+    }
+    state->device_count = count;
+    state->device_total = devices.count;
+
+    count = 0;
+    for (uint64_t i = 0; i < plants.count && count < PLANT_STATE_MAX_PLANTS; ++i) {
+        PlantStatePlant *record = &state->plants[count++];
+        snprintf(record->name, sizeof(record->name), "%s", plants.list[i].name);
+        record->remaining_duration = plants.list[i].remaining_duration;
+        record->configured_duration = plants.list[i].configured_duration;
+        record->capture_version = i < MAX_SCHEDULED_PLANTS ? plant_schedules[i].capture_version : 0;
+        record->last_capture = i < MAX_SCHEDULED_PLANTS ? plant_schedules[i].last_capture : 0;
+    }
+    state->plant_count = count;
+    __atomic_store_n(&state->magic, PLANT_STATE_MAGIC, __ATOMIC_RELAXED);
+    plant_state_write_end(state);
+
+    plant_state_published.devices = devices.version;
+    plant_state_published.plants = plants_version;
+    plant_state_published.processes = global_timer.version;
+    plant_state_published.captures = captures_version;
+    plant_state_published.valid = 1;
+}
+
+static int prerender_device_interval(void) {
+    const char *value = getenv("PLANT_MONITOR_PRERENDER_INTERVAL");
+    int interval = value ? atoi(value) : -1;
+    return interval >= 0 ? interval : PRERENDER_DEFAULT_DEVICE_INTERVAL;
+}
+
+// Reaps the last pre-render and starts the next one if the state changed since (see prerendered).
+// Runs after publish_plant_state, so the child renders from the segment just published.
+static void prerender_pages(void) {
+    if (prerender_pid > 0) {
+        int status = 0;
+        pid_t done = waitpid(prerender_pid, &status, WNOHANG);
+        if (done == 0) return;
+        if (done == prerender_pid && !(WIFEXITED(status) && WEXITSTATUS(status) == 0)) {
+            log_message("WARN: %s --prerender failed (status %d).", PRERENDER_COMMAND, status);
+        }
+        prerender_pid = 0;
+    }
+
+    int state_changed = !prerendered.valid || prerendered.plants != plants_version ||
+                        prerendered.processes != global_timer.version || prerendered.captures != captures_version;
+    if (!state_changed && prerendered.devices == devices.version) return;
+    time_t now = time(NULL);
+    if (!state_changed && now - prerender_started < prerender_device_interval()) return;
+
+    char *argv[] = { "index.cgi", "--prerender", NULL };
+    int error = posix_spawn(&prerender_pid, PRERENDER_COMMAND, NULL, NULL, argv, environ);
+    if (error != 0) {
+        // Not retried until the state changes again; lighttpd keeps serving the previous pages.
+        log_message("WARN: Cannot run %s --prerender (%s).", PRERENDER_COMMAND, strerror(error));
+        prerender_pid = 0;
+    }
+    prerendered.devices = devices.version;
+    prerendered.plants = plants_version;
+    prerendered.processes = global_timer.version;
+    prerendered.captures = captures_version;
+    prerendered.valid = 1;
+    prerender_started = now;
+}
+
 static void cleanup_all_data(void) {
     free_pings_data();
     free_devices_data();
@@ -0,0 +1,282 @@
+// Micro-benchmarks for the stages of the generate_plant_images pipeline.
+//
+// Runs each stage on synthetic plant images at QVGA, VGA, SVGA (the ESP32 default) and UXGA with
+// sparse, medium and dense canopies, and reports time per call, throughput in megapixels/s and
+// allocations per call (heap allocations through operator new, and cv::Mat buffers). Before
+// timing anything it checks that the fused and ROI-tracked segmentation match the full-frame
+// reference functions.
+//
+// Usage: benchmark_plant_images [--filter <substring>] [--min-time <seconds>]
+
+#define PLANT_IMAGES_NO_MAIN
+#define PLANT_IMAGES_BASE_DIR "/tmp/plant_bench/images/"
+#include "generate_plant_images.cpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+std::atomic<uint64_t> heap_allocations{0};
+
+void* operator new(std::size_t size) {
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+// Counts cv::Mat buffer allocations, which go through OpenCV's allocator rather than operator new.
+class CountingMatAllocator : public cv::MatAllocator {
+public:
+    explicit CountingMatAllocator(cv::MatAllocator* base) : base_(base) {}
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usage_flags) const override {
+        if (!data) allocations.fetch_add(1, std::memory_order_relaxed);
+        return base_->allocate(dims, sizes, type, data, step, flags, usage_flags);
+    }
+
+    bool allocate(cv::UMatData* data, cv::AccessFlag access_flags, cv::UMatUsageFlags usage_flags) const override {
+        return base_->allocate(data, access_flags, usage_flags);
+    }
+
+    void deallocate(cv::UMatData* data) const override { base_->deallocate(data); }
+
+    mutable std::atomic<uint64_t> allocations{0};
+
+private:
+    cv::MatAllocator* base_;
+};
+
+struct Resolution {
+    const char* name;
+    int width;
+    int height;
+};
+
+const Resolution RESOLUTIONS[] = {
+    {"QVGA", 320, 240},
+    {"VGA", 640, 480},
+    {"SVGA", 800, 600},
+    {"UXGA", 1600, 1200},
+};
+
+const double CANOPY_COVERAGES[] = {0.05, 0.25, 0.60};
+
+struct BenchmarkOptions {
+    std::string filter;
+    double min_time_s = 0.5;
+};
+
+// Soil-coloured background with a leafy ellipse covering roughly `coverage` of the frame, plus
+// sensor noise so the thresholds and edge detector see realistic texture.
+cv::Mat makeSyntheticPlant(const Resolution& resolution, double coverage) {
+    cv::Mat img(resolution.height, resolution.width, CV_8UC3, cv::Scalar(45, 75, 110));
+    cv::Point center(resolution.width / 2, resolution.height / 2);
+    double scale = std::sqrt(coverage / CV_PI);
+    cv::Size axes(static_cast<int>(resolution.width * scale), static_cast<int>(resolution.height * scale));
+    cv::ellipse(img, center, axes, 0, 0, 360, cv::Scalar(40, 150, 60), cv::FILLED);
+    for (int i = 1; i <= 4; ++i) {
+        cv::Size vein(axes.width * i / 5, axes.height * i / 5);
+        cv::ellipse(img, center, vein, 30.0 * i, 0, 360, cv::Scalar(30, 110, 45), 2);
+    }
+
+    cv::Mat noise(img.rows, img.cols, CV_8UC3);
+    cv::randu(noise, cv::Scalar(0, 0, 0), cv::Scalar(20, 20, 20));
+    cv::add(img, noise, img);
+    return img;
+}
+
+cv::Mat shiftImage(const cv::Mat& img, int dx, int dy) {
+    cv::Mat shifted(img.rows, img.cols, CV_8UC3, cv::Scalar(45, 75, 110));
+    cv::Mat target = shifted(cv::Rect(dx, dy, img.cols - dx, img.rows - dy));
+    img(cv::Rect(0, 0, img.cols - dx, img.rows - dy)).copyTo(target);
+    return shifted;
+}
+
+// Regression check for ROI tracking: after a full-frame run, a slightly moved plant must be
+// measured from the ROI alone and give the same bounding box as full-frame processing.
+bool crossCheckRoiTracking(const cv::Mat& img, const std::string& label, double& processed_fraction) {
+    ViewRoi roi;
+    ViewAnalysis first, second;
+    analyzeSideView(img, roi, first);
+    cv::Mat moved = shiftImage(img, 5, 3);
+    analyzeSideView(moved, roi, second);
+    processed_fraction = second.processed_fraction;
+
+    double full_height = 0.0, full_width = 0.0;
+    getBoundingBoxDimensions(processGreenThreshold(moved), full_height, full_width);
+    bool ok = second.bbox_height == full_height && second.bbox_width == full_width;
+    if (!ok) {
+        std::fprintf(stderr, "MISMATCH %s ROI bbox %.0fx%.0f vs full-frame %.0fx%.0f\n", label.c_str(),
+                     second.bbox_width, second.bbox_height, full_width, full_height);
+    }
+    return ok;
+}
+
+// Times `body` until at least min_time_s has elapsed (and at least three calls), with stdout and
+// stderr silenced so the functions' own logging does not dominate.
+template <typename Body>
+void runBenchmark(const BenchmarkOptions& options, CountingMatAllocator& mat_allocator, const std::string& name,
+                  const std::string& input, double megapixels, Body&& body) {
+    std::string label = name + "/" + input;
+    if (!options.filter.empty() && label.find(options.filter) == std::string::npos) return;
+
+    std::streambuf* cout_buf = std::cout.rdbuf(nullptr);
+    std::streambuf* cerr_buf = std::cerr.rdbuf(nullptr);
+
+    body();
+
+    uint64_t heap_before = heap_allocations.load();
+    uint64_t mats_before = mat_allocator.allocations.load();
+    uint64_t iterations = 0;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed_s = 0.0;
+    while (iterations < 3 || elapsed_s < options.min_time_s) {
+        body();
+        ++iterations;
+        elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    uint64_t heap_calls = heap_allocations.load() - heap_before;
+    uint64_t mat_calls = mat_allocator.allocations.load() - mats_before;
+
+    std::cout.rdbuf(cout_buf);
+    std::cerr.rdbuf(cerr_buf);
+    std::cout.clear();
+    std::cerr.clear();
+
+    double ms_per_call = elapsed_s * 1e3 / iterations;
+    char throughput[32] = "-";
+    if (megapixels > 0.0) std::snprintf(throughput, sizeof(throughput), "%.1f", megapixels * iterations / elapsed_s);
+    std::printf("%-34s %-14s %12.3f %10s %12.1f %10.1f\n", name.c_str(), input.c_str(), ms_per_call, throughput,
+                static_cast<double>(heap_calls) / iterations, static_cast<double>(mat_calls) / iterations);
+}
+
+void writeSampleMetricsFile(const std::string& path) {
+    std::ofstream out(path);
+    out << "Timestamp: 20250101_120000\n"
+        << "Canopy Area (Ac): 1234.56 cm^2\n"
+        << "Color Index (Ihue): 52.25\n"
+        << "Height (Hp): 18.70 cm\n"
+        << "Width 1 (W1): 22.10 cm\n"
+        << "Width 2 (W2): 21.40 cm\n"
+        << "Volumetric Proxy (Vp): 11543.21 cm^3\n";
+}
+
+std::vector<MetricData> makeSyntheticHistory(size_t count) {
+    std::vector<MetricData> history(count);
+    std::time_t start = 1735732800;
+    for (size_t i = 0; i < count; ++i) {
+        MetricData& data = history[i];
+        double t = static_cast<double>(i);
+        data.timestamp_t = start + static_cast<std::time_t>(i) * 3600;
+        data.timestamp_str = std::to_string(data.timestamp_t);
+        data.canopy_area = 800.0 + 4.0 * t + 30.0 * std::sin(t / 12.0);
+        data.color_index = 50.0 + 3.0 * std::sin(t / 24.0);
+        data.height_hp = 10.0 + 0.05 * t;
+        data.width1 = 15.0 + 0.04 * t;
+        data.width2 = 14.0 + 0.045 * t;
+        data.volumetric_proxy = data.canopy_area * data.height_hp * 0.5;
+    }
+    return history;
+}
+
+int main(int argc, char* argv[]) {
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (arg == "--min-time" && i + 1 < argc) {
+            options.min_time_s = std::atof(argv[++i]);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--filter <substring>] [--min-time <seconds>]" << std::endl;
+            return 1;
+        }
+    }
+
+    fs::create_directories(IMAGE_BASE_DIR);
+    CountingMatAllocator mat_allocator(cv::Mat::getDefaultAllocator());
+    cv::Mat::setDefaultAllocator(&mat_allocator);
+
+    struct Input {
+        std::string label;
+        double megapixels;
+        cv::Mat img;
+        cv::Mat mask;
+    };
+    std::vector<Input> inputs;
+    bool segmentation_ok = true;
+    for (const Resolution& resolution : RESOLUTIONS) {
+        for (double coverage : CANOPY_COVERAGES) {
+            Input input;
+            input.label = std::string(resolution.name) + "@" + std::to_string(static_cast<int>(coverage * 100)) + "%";
+            input.megapixels = resolution.width * resolution.height / 1e6;
+            input.img = makeSyntheticPlant(resolution, coverage);
+            input.mask = processGreenThreshold(input.img);
+            segmentation_ok = crossCheckSegmentation(input.img, input.label) && segmentation_ok;
+            double roi_fraction = 1.0;
+            segmentation_ok = crossCheckRoiTracking(input.img, input.label, roi_fraction) && segmentation_ok;
+            std::printf("ROI tracking %-14s processes %5.1f%% of the frame\n", input.label.c_str(), roi_fraction * 100.0);
+            inputs.push_back(input);
+        }
+    }
+    if (!segmentation_ok) {
+        std::cerr << "Error: Segmentation does not match the full-frame reference; not benchmarking." << std::endl;
+        return 1;
+    }
+    std::cout << "Fused and ROI segmentation match the reference on all " << inputs.size() << " inputs." << std::endl;
+
+    std::printf("%-34s %-14s %12s %10s %12s %10s\n", "stage", "input", "ms/call", "MP/s", "allocs/call", "Mats/call");
+    for (const Input& input : inputs) {
+        const cv::Mat& img = input.img;
+        const cv::Mat& mask = input.mask;
+        double mp = input.megapixels;
+        runBenchmark(options, mat_allocator, "processImageToMask", input.label, mp, [&] { processImageToMask(img); });
+        runBenchmark(options, mat_allocator, "processToEdges", input.label, mp, [&] { processToEdges(img); });
+        runBenchmark(options, mat_allocator, "processGreenThreshold", input.label, mp, [&] { processGreenThreshold(img); });
+        runBenchmark(options, mat_allocator, "calculateMeanHueInMask", input.label, mp, [&] { calculateMeanHueInMask(img, mask); });
+        cv::Mat green_mask;
+        runBenchmark(options, mat_allocator, "segmentGreenCanopy", input.label, mp, [&] { segmentGreenCanopy(img, green_mask); });
+        runBenchmark(options, mat_allocator, "segmentGreenCanopyScalar", input.label, mp, [&] { segmentGreenCanopyScalar(img, green_mask); });
+        runBenchmark(options, mat_allocator, "getBoundingBoxDimensions", input.label, mp, [&] {
+            double height = 0.0, width = 0.0;
+            getBoundingBoxDimensions(mask, height, width);
+        });
+        ViewRoi tracked_roi;
+        ViewAnalysis side_analysis;
+        analyzeSideView(img, tracked_roi, side_analysis);
+        runBenchmark(options, mat_allocator, "analyzeSideView (full frame)", input.label, mp, [&] {
+            ViewRoi roi;
+            analyzeSideView(img, roi, side_analysis);
+        });
+        runBenchmark(options, mat_allocator, "analyzeSideView (tracked ROI)", input.label, mp, [&] {
+            ViewRoi roi = tracked_roi;
+            analyzeSideView(img, roi, side_analysis);
+        });
+        runBenchmark(options, mat_allocator, "saveImage", input.label, mp, [&] { saveImage(img, "bench_save.jpg", "Bench"); });
+    }
+
+    std::string metrics_path = IMAGE_BASE_DIR + "bench_metrics.txt";
+    writeSampleMetricsFile(metrics_path);
+    runBenchmark(options, mat_allocator, "parseMetricsFile", "7 fields", 0.0, [&] {
+        MetricData data;
+        parseMetricsFile(metrics_path, data);
+    });
+
+    const int bench_plant_id = 999999;
+    const double graph_mp = GRAPH_WIDTH * GRAPH_HEIGHT / 1e6;
+    for (size_t samples : {24, 720, 8760}) {
+        std::vector<MetricData> history = makeSyntheticHistory(samples);
+        std::string input = std::to_string(samples) + " samples";
+        runBenchmark(options, mat_allocator, "plotMetricGraph", input, graph_mp, [&] {
+            plotMetricGraph(bench_plant_id, history, "Canopy Area (Ac)", "Canopy Area Over Time", "Canopy Area (cm^2)");
+        });
+    }
+
+    cv::Mat::setDefaultAllocator(nullptr);
+    return 0;
+}
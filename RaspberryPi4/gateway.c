@@ -0,0 +1,941 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include "plant_state.h"
+
+// Live dashboard updates as server-sent events. lighttpd hands /cgi-bin/events to this resident
+// SCGI daemon (gateway.service, lighttpd.conf), which keeps every stream open in one epoll loop.
+// Every GATEWAY_POLL_INTERVAL_MS it compares the versions in the state segment (plant_state.h) with
+// the last snapshot it took and, only if one moved, takes a new snapshot and broadcasts the
+// difference as small events:
+//
+//   device          a device was added or pinged, or its assignment, command or heartbeat changed
+//   device-removed  a device was evicted from the registry
+//   timer           the global timer was started, reset or given a new duration
+//   metrics         plant N was captured; carries its newest metrics sample
+//   plants          the plant list changed (the page reloads, its layout depends on the list)
+//   artifacts       the image service re-rendered plant N's diagnostic images
+//
+// A new stream first receives the current devices, timer and metrics, so a reconnecting page
+// catches up without replaying history. Idle streams cost one descriptor and one Client; output
+// that a slow reader cannot take is queued up to GATEWAY_BACKLOG_MAX and the stream is dropped
+// beyond that (EventSource reconnects and resynchronises).
+//
+// While the application is not running there is nothing to follow; streams stay open with
+// keep-alive comments until the segment is published again.
+//
+// The gateway also proxies the dashboard's live camera previews, /cgi-bin/preview?device=<id>
+// (see preview_request), so browsers never talk to the cameras directly.
+#ifndef PLANT_MONITOR_DATA_DIR
+#define PLANT_MONITOR_DATA_DIR "/var/www/html/data"
+#endif
+#define IMAGE_BASE_DIR PLANT_MONITOR_DATA_DIR "/images/"
+#define GATEWAY_MAX_CLIENTS 1024
+#define GATEWAY_REQUEST_MAX 4096
+#define GATEWAY_POLL_INTERVAL_MS 500
+#define GATEWAY_KEEPALIVE_SECONDS 15
+#define GATEWAY_BACKLOG_MAX (1024 * 1024)
+#define SSE_RETRY_MS 5000
+
+// Each camera's last preview frame is cached. It is refetched only when a viewer asks for it after
+// the frame is PREVIEW_REFRESH_MS old (PLANT_MONITOR_PREVIEW_INTERVAL_MS overrides), and a camera
+// that failed is not retried sooner either, so a camera sees at most one preview request per
+// interval however many pages show it.
+#define PREVIEW_REFRESH_MS 2000
+#define PREVIEW_CONNECT_TIMEOUT_MS 2000
+#define PREVIEW_READ_TIMEOUT_MS 5000
+#define PREVIEW_MAX_RESPONSE_BYTES (4 * 1024 * 1024)
+
+typedef struct { char *data; size_t length, capacity; } TextBuffer;
+
+// Clients and previews are registered with epoll by pointer; the first member tells them apart.
+enum { HANDLE_CLIENT, HANDLE_PREVIEW };
+enum { CLIENT_REQUEST, CLIENT_STREAM, CLIENT_RESPONSE };
+enum { PREVIEW_IDLE, PREVIEW_CONNECTING, PREVIEW_RECEIVING };
+
+struct Preview;
+typedef struct Client {
+    int handle;                        // HANDLE_CLIENT
+    int fd;
+    uint8_t phase;                     // CLIENT_*
+    size_t request_length;
+    char *request;                     // freed once the request is complete
+    TextBuffer pending;                // queued output, sent from pending_sent on
+    size_t pending_sent;
+    struct Client *next, **pprev;      // in the streaming list
+    struct Preview *waiting_on;        // preview fetch this client waits for
+    struct Client *next_waiter;
+} Client;
+
+typedef struct Preview {
+    int handle;                        // HANDLE_PREVIEW
+    int fd;
+    uint8_t state;                     // PREVIEW_*
+    uint64_t device_id;
+    char host[48];
+    uint64_t deadline_ms, attempt_ms;
+    TextBuffer response;               // HTTP response of the running fetch
+    TextBuffer frame;                  // last JPEG the camera delivered
+    uint64_t frame_ms;                 // when it arrived; 0 if never
+    Client *waiters;
+    struct Preview *next;
+} Preview;
+
+typedef struct { uint64_t capture_version; uint8_t found; MetricRecord record; } PlantMetrics;
+
+static Client *streams = NULL;
+static Client *closed_clients = NULL;  // freed after the epoll batch that may still name them
+static int client_count = 0;
+static int epoll_fd = -1;
+static const PlantState *shared_state = NULL;
+static PlantState *current_state = NULL, *next_state = NULL;
+static uint8_t have_state = 0;
+static PlantMetrics plant_metrics[PLANT_STATE_MAX_PLANTS];
+static uint64_t *device_order = NULL;  // current_state's device IDs, sorted, each followed by its index
+static Preview *previews = NULL;
+static uint64_t preview_interval_ms = PREVIEW_REFRESH_MS;
+static uint8_t preview_sweep_due = 0;  // run after the epoll batch, which may still name a preview
+
+static long find_current_device(uint64_t id);
+static void preview_request(Client *client, uint64_t device_id);
+
+static void log_message(const char *format, ...) {
+    time_t now = time(NULL);
+    struct tm *t = localtime(&now);
+    char ts[32];
+    strftime(ts, sizeof(ts), "%Y-%m-%d %H:%M:%S", t);
+    fprintf(stderr, "[%s] ", ts);
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fprintf(stderr, "\n");
+}
+
+static int text_reserve(TextBuffer *buffer, size_t extra) {
+    if (buffer->length + extra <= buffer->capacity) return 1;
+    size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+    while (capacity < buffer->length + extra) capacity *= 2;
+    char *data = (char*)realloc(buffer->data, capacity);
+    if (!data) return 0;
+    buffer->data = data;
+    buffer->capacity = capacity;
+    return 1;
+}
+
+static void text_append(TextBuffer *buffer, const char *data, size_t length) {
+    if (!text_reserve(buffer, length + 1)) return;
+    memcpy(buffer->data + buffer->length, data, length);
+    buffer->length += length;
+    buffer->data[buffer->length] = '\0';
+}
+
+static void text_printf(TextBuffer *buffer, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    char small[256];
+    int length = vsnprintf(small, sizeof(small), format, args);
+    va_end(args);
+    if (length < 0) return;
+    if ((size_t)length < sizeof(small)) {
+        text_append(buffer, small, (size_t)length);
+        return;
+    }
+    if (!text_reserve(buffer, (size_t)length + 1)) return;
+    va_start(args, format);
+    vsnprintf(buffer->data + buffer->length, (size_t)length + 1, format, args);
+    va_end(args);
+    buffer->length += (size_t)length;
+}
+
+static void text_json_string(TextBuffer *buffer, const char *s) {
+    text_append(buffer, "\"", 1);
+    for (const unsigned char *c = (const unsigned char*)s; *c; ++c) {
+        if (*c == '"' || *c == '\\') text_printf(buffer, "\\%c", *c);
+        else if (*c < 0x20) text_printf(buffer, "\\u%04x", *c);
+        else text_append(buffer, (const char*)c, 1);
+    }
+    text_append(buffer, "\"", 1);
+}
+
+static void text_json_number(TextBuffer *buffer, const char *key, double value) {
+    if (isfinite(value)) text_printf(buffer, "\"%s\":%.6g", key, value);
+    else text_printf(buffer, "\"%s\":null", key);
+}
+
+static void append_device_event(TextBuffer *events, const PlantStateDevice *device) {
+    char position = device->position >= 0x20 && device->position < 0x7f && device->position != '"' && device->position != '\\' ? (char)device->position : '?';
+    text_printf(events, "event: device\ndata: {\"id\":%llu,\"ip\":", (unsigned long long)device->id);
+    text_json_string(events, device->ip);
+    text_printf(events, ",\"plant_id\":%u,\"plant_name\":", device->plant_id);
+    text_json_string(events, device->plant_name);
+    text_printf(events, ",\"position\":\"%c\",\"last_ping\":%llu,\"command\":", position, (unsigned long long)device->ping_timestamp);
+    text_json_string(events, device->command);
+    if (device->rssi) text_printf(events, ",\"rssi\":%d", device->rssi);
+    else text_printf(events, ",\"rssi\":null");
+    text_printf(events, ",\"capture_ready\":%s}\n\n", device->heartbeat_flags & HEARTBEAT_FLAG_CAPTURE_READY ? "true" : "false");
+}
+
+// The timer event carries the gateway's clock so pages can compute the remaining time without
+// trusting the browser's.
+static void append_timer_event(TextBuffer *events, const PlantState *state) {
+    text_printf(events, "event: timer\ndata: {\"loaded\":%s,\"start\":%lld,\"duration\":%lld,\"now\":%lld}\n\n",
+                state->processes_loaded ? "true" : "false", (long long)state->global_timer_start,
+                (long long)state->global_timer_duration, (long long)time(NULL));
+}
+
+static void append_metrics_event(TextBuffer *events, const PlantState *state, uint32_t index) {
+    const PlantStatePlant *plant = &state->plants[index];
+    const PlantMetrics *metrics = &plant_metrics[index];
+    text_printf(events, "event: metrics\ndata: {\"plant\":%u,\"capture_version\":%llu,\"last_capture\":%lld,\"metrics\":",
+                index + 1, (unsigned long long)plant->capture_version, (long long)plant->last_capture);
+    if (!metrics->found) {
+        text_printf(events, "null}\n\n");
+        return;
+    }
+    text_printf(events, "{\"timestamp\":%lld,", (long long)metrics->record.timestamp);
+    text_json_number(events, "canopy_area", metrics->record.canopy_area);
+    text_append(events, ",", 1);
+    text_json_number(events, "color_index", metrics->record.color_index);
+    text_append(events, ",", 1);
+    text_json_number(events, "height_hp", metrics->record.height_hp);
+    text_append(events, ",", 1);
+    text_json_number(events, "width1", metrics->record.width1);
+    text_append(events, ",", 1);
+    text_json_number(events, "width2", metrics->record.width2);
+    text_append(events, ",", 1);
+    text_json_number(events, "volumetric_proxy", metrics->record.volumetric_proxy);
+    text_printf(events, "}}\n\n");
+}
+
+// Events that bring a new stream up to date with current_state.
+static void append_full_state(TextBuffer *events) {
+    text_printf(events, "retry: %d\n\n", SSE_RETRY_MS);
+    if (!have_state) return;
+    for (uint32_t i = 0; i < current_state->device_count; ++i) append_device_event(events, &current_state->devices[i]);
+    append_timer_event(events, current_state);
+    for (uint32_t i = 0; i < current_state->plant_count; ++i) {
+        if (current_state->plants[i].capture_version) append_metrics_event(events, current_state, i);
+    }
+}
+
+static void client_close(Client *client) {
+    if (client->fd < 0) return;
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+    close(client->fd);
+    client->fd = -1;
+    if (client->waiting_on) {
+        Client **waiter = &client->waiting_on->waiters;
+        while (*waiter && *waiter != client) waiter = &(*waiter)->next_waiter;
+        if (*waiter) *waiter = client->next_waiter;
+        client->waiting_on = NULL;
+    }
+    if (client->pprev) {
+        *client->pprev = client->next;
+        if (client->next) client->next->pprev = client->pprev;
+        client->pprev = NULL;
+    }
+    client->next = closed_clients;
+    closed_clients = client;
+    client_count--;
+}
+
+static void free_closed_clients(void) {
+    while (closed_clients) {
+        Client *client = closed_clients;
+        closed_clients = client->next;
+        free(client->request);
+        free(client->pending.data);
+        free(client);
+    }
+}
+
+// Writes what the socket takes and queues the rest. Returns 0 if the client was closed.
+static int client_send(Client *client, const char *data, size_t length) {
+    if (client->pending_sent == client->pending.length) {
+        ssize_t sent = write(client->fd, data, length);
+        if (sent < 0 && errno != EAGAIN && errno != EINTR) {
+            client_close(client);
+            return 0;
+        }
+        if (sent > 0) {
+            data += sent;
+            length -= (size_t)sent;
+        }
+        if (length == 0) {
+            if (client->phase == CLIENT_RESPONSE) client_close(client);
+            return 1;
+        }
+        client->pending.length = client->pending_sent = 0;
+        struct epoll_event event = { .events = EPOLLIN | EPOLLOUT | EPOLLRDHUP };
+        event.data.ptr = client;
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, client->fd, &event);
+    }
+    if (client->phase == CLIENT_STREAM && client->pending.length - client->pending_sent + length > GATEWAY_BACKLOG_MAX) {
+        log_message("WARN: Dropping event stream %d; it fell %zu bytes behind.", client->fd, client->pending.length - client->pending_sent + length);
+        client_close(client);
+        return 0;
+    }
+    text_append(&client->pending, data, length);
+    return 1;
+}
+
+// Sends queued output once the socket is writable again.
+static void client_flush(Client *client) {
+    while (client->pending_sent < client->pending.length) {
+        ssize_t sent = write(client->fd, client->pending.data + client->pending_sent, client->pending.length - client->pending_sent);
+        if (sent < 0 && (errno == EAGAIN || errno == EINTR)) return;
+        if (sent <= 0) {
+            client_close(client);
+            return;
+        }
+        client->pending_sent += (size_t)sent;
+    }
+    client->pending.length = client->pending_sent = 0;
+    if (client->phase == CLIENT_RESPONSE) {
+        client_close(client);
+        return;
+    }
+    struct epoll_event event = { .events = EPOLLIN | EPOLLRDHUP };
+    event.data.ptr = client;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, client->fd, &event);
+}
+
+static void broadcast(const TextBuffer *events) {
+    if (!events->length) return;
+    Client *client = streams;
+    while (client) {
+        Client *next = client->next;
+        client_send(client, events->data, events->length);
+        client = next;
+    }
+}
+
+static uint64_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL;
+}
+
+// Sends a complete response and closes the connection once it is out.
+static void client_respond(Client *client, const char *status, const char *content_type, const char *body, size_t length) {
+    char header[256];
+    int header_length = snprintf(header, sizeof(header), "Status: %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nCache-Control: no-store\r\n\r\n",
+                                 status, content_type, length);
+    client->phase = CLIENT_STREAM;     // keep the connection open until the body is queued as well
+    if (!client_send(client, header, (size_t)header_length)) return;
+    client->phase = CLIENT_RESPONSE;
+    if (length) {
+        client_send(client, body, length);
+    } else if (client->pending_sent == client->pending.length) {
+        client_close(client);
+    }
+}
+
+static void start_stream(Client *client) {
+    client->phase = CLIENT_STREAM;
+    client->next = streams;
+    client->pprev = &streams;
+    if (streams) streams->pprev = &client->next;
+    streams = client;
+
+    TextBuffer response = {NULL, 0, 0};
+    text_printf(&response, "Status: 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\nX-Accel-Buffering: no\r\n\r\n");
+    append_full_state(&response);
+    if (response.data) client_send(client, response.data, response.length);
+    free(response.data);
+}
+
+// Reads the SCGI request; once its header netstring is complete, starts an event stream or, for
+// /cgi-bin/preview, answers with a camera preview.
+static void client_read(Client *client) {
+    if (client->phase != CLIENT_REQUEST) {
+        // Nothing more is expected; a read of 0 means lighttpd closed the connection.
+        char discard[256];
+        ssize_t received = read(client->fd, discard, sizeof(discard));
+        if (received == 0 || (received < 0 && errno != EAGAIN && errno != EINTR)) client_close(client);
+        return;
+    }
+    ssize_t received = read(client->fd, client->request + client->request_length, GATEWAY_REQUEST_MAX - 1 - client->request_length);
+    if (received < 0 && (errno == EAGAIN || errno == EINTR)) return;
+    if (received <= 0) {
+        client_close(client);
+        return;
+    }
+    client->request_length += (size_t)received;
+    char *colon = memchr(client->request, ':', client->request_length);
+    size_t header_end = colon ? (size_t)(colon + 1 - client->request) + strtoul(client->request, NULL, 10) : 0;
+    if (!colon || client->request_length < header_end + 1) {
+        if (client->request_length >= GATEWAY_REQUEST_MAX - 1 || (!colon && client->request_length > 10)) client_close(client);
+        return;
+    }
+    const char *headers = colon + 1;
+    size_t header_length = header_end - (size_t)(headers - client->request);
+    client->request[header_end] = '\0';
+    const char *uri = scgi_header(headers, header_length, "REQUEST_URI");
+    const char *query = scgi_header(headers, header_length, "QUERY_STRING");
+    int preview = uri && strncmp(uri, "/cgi-bin/preview", 16) == 0;
+    uint64_t device_id = 0;
+    int has_device = 0;
+    for (const char *param = query; preview && param && *param; param = strchr(param, '&') ? strchr(param, '&') + 1 : NULL) {
+        char *end;
+        if (strncmp(param, "device=", 7) != 0) continue;
+        device_id = strtoull(param + 7, &end, 10);
+        has_device = end != param + 7 && (*end == '\0' || *end == '&');
+        break;
+    }
+    free(client->request);
+    client->request = NULL;
+
+    if (!preview) {
+        start_stream(client);
+    } else if (!has_device) {
+        static const char message[] = "Missing or invalid device parameter.\n";
+        client_respond(client, "400 Bad Request", "text/plain", message, sizeof(message) - 1);
+    } else {
+        preview_request(client, device_id);
+    }
+}
+
+// Answers one viewer from the cached frame, or with 502 if the camera never delivered one.
+static void preview_serve(Preview *preview, Client *client) {
+    if (preview->frame_ms) {
+        client_respond(client, "200 OK", "image/jpeg", preview->frame.data, preview->frame.length);
+    } else {
+        static const char message[] = "Camera did not deliver a frame.\n";
+        client_respond(client, "502 Bad Gateway", "text/plain", message, sizeof(message) - 1);
+    }
+}
+
+// Ends the running fetch, keeps the frame if the camera delivered one and answers every viewer
+// that waited for it.
+static void preview_complete(Preview *preview, const char *error) {
+    if (preview->fd >= 0) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, preview->fd, NULL);
+        close(preview->fd);
+        preview->fd = -1;
+    }
+    preview->state = PREVIEW_IDLE;
+    int status = 0;
+    char *body = !error && preview->response.data ? strstr(preview->response.data, "\r\n\r\n") : NULL;
+    if (!error && (!body || sscanf(preview->response.data, "HTTP/%*d.%*d %d", &status) != 1)) error = "malformed response";
+    if (!error && status != 200) error = "HTTP error status";
+    if (!error && (size_t)(body + 4 - preview->response.data) == preview->response.length) error = "empty body";
+    if (error) {
+        log_message("WARN: Preview of device %llu (%s) failed: %s.", (unsigned long long)preview->device_id, preview->host, error);
+    } else {
+        body += 4;
+        size_t length = preview->response.length - (size_t)(body - preview->response.data);
+        preview->frame.length = 0;
+        text_append(&preview->frame, body, length);
+        if (preview->frame.length == length) preview->frame_ms = monotonic_ms();
+    }
+    preview->response.length = 0;
+
+    Client *waiter = preview->waiters;
+    preview->waiters = NULL;
+    while (waiter) {
+        Client *next = waiter->next_waiter;
+        waiter->waiting_on = NULL;
+        waiter->next_waiter = NULL;
+        preview_serve(preview, waiter);
+        waiter = next;
+    }
+}
+
+// Opens a non-blocking connection to the camera (as application.c's fetch_start does).
+static void preview_start(Preview *preview, uint64_t now_ms) {
+    preview->attempt_ms = now_ms;
+    preview->deadline_ms = now_ms + PREVIEW_CONNECT_TIMEOUT_MS;
+    char host[sizeof(preview->host)];
+    snprintf(host, sizeof(host), "%s", preview->host);
+    uint16_t port = 80;
+    char *colon = strchr(host, ':');
+    if (colon) {
+        *colon = '\0';
+        port = (uint16_t)atoi(colon + 1);
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+        preview_complete(preview, "invalid address");
+        return;
+    }
+    preview->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (preview->fd < 0) {
+        preview_complete(preview, "socket failed");
+        return;
+    }
+    if (connect(preview->fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS) {
+        preview_complete(preview, "connect failed");
+        return;
+    }
+    struct epoll_event event = { .events = EPOLLOUT };
+    event.data.ptr = preview;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, preview->fd, &event) < 0) {
+        preview_complete(preview, "epoll_ctl failed");
+        return;
+    }
+    preview->state = PREVIEW_CONNECTING;
+}
+
+static void preview_on_event(Preview *preview, uint32_t events, uint64_t now_ms) {
+    if (preview->state == PREVIEW_CONNECTING) {
+        int error = 0;
+        socklen_t error_len = sizeof(error);
+        if (getsockopt(preview->fd, SOL_SOCKET, SO_ERROR, &error, &error_len) < 0 || error != 0) {
+            preview_complete(preview, "connect failed");
+            return;
+        }
+        char request[128];
+        int request_len = snprintf(request, sizeof(request), "GET / HTTP/1.0\r\nHost: %s\r\nConnection: close\r\n\r\n", preview->host);
+        if (send(preview->fd, request, request_len, MSG_NOSIGNAL) != request_len) {
+            preview_complete(preview, "send failed");
+            return;
+        }
+        struct epoll_event event = { .events = EPOLLIN };
+        event.data.ptr = preview;
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, preview->fd, &event);
+        preview->state = PREVIEW_RECEIVING;
+        preview->deadline_ms = now_ms + PREVIEW_READ_TIMEOUT_MS;
+        return;
+    }
+    if (preview->state != PREVIEW_RECEIVING || !(events & (EPOLLIN | EPOLLHUP | EPOLLERR))) return;
+    while (1) {
+        if (!text_reserve(&preview->response, 16384 + 1)) {
+            preview_complete(preview, "out of memory");
+            return;
+        }
+        ssize_t n = recv(preview->fd, preview->response.data + preview->response.length, preview->response.capacity - 1 - preview->response.length, 0);
+        if (n > 0) {
+            preview->response.length += (size_t)n;
+            preview->response.data[preview->response.length] = '\0';
+            preview->deadline_ms = now_ms + PREVIEW_READ_TIMEOUT_MS;
+            if (preview->response.length > PREVIEW_MAX_RESPONSE_BYTES) {
+                preview_complete(preview, "response too large");
+                return;
+            }
+            continue;
+        }
+        if (n == 0) preview_complete(preview, NULL);
+        else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) preview_complete(preview, "read failed");
+        return;
+    }
+}
+
+// Serves GET /cgi-bin/preview?device=<id>: the cached frame while it is fresh, otherwise the
+// result of one fetch shared by every viewer that asks meanwhile. Only registered devices are
+// served; a cached frame of a device that left the registry waits for preview_sweep.
+static void preview_request(Client *client, uint64_t device_id) {
+    long index = have_state ? find_current_device(device_id) : -1;
+    if (index < 0) {
+        static const char message[] = "Unknown device.\n";
+        client_respond(client, "404 Not Found", "text/plain", message, sizeof(message) - 1);
+        return;
+    }
+    Preview *preview = previews;
+    while (preview && preview->device_id != device_id) preview = preview->next;
+    if (!preview) {
+        preview = (Preview*)calloc(1, sizeof(Preview));
+        if (!preview) {
+            static const char message[] = "Out of memory.\n";
+            client_respond(client, "503 Service Unavailable", "text/plain", message, sizeof(message) - 1);
+            return;
+        }
+        preview->handle = HANDLE_PREVIEW;
+        preview->fd = -1;
+        preview->device_id = device_id;
+        preview->next = previews;
+        previews = preview;
+    }
+    snprintf(preview->host, sizeof(preview->host), "%s", current_state->devices[index].ip);
+
+    uint64_t now_ms = monotonic_ms();
+    if (preview->state == PREVIEW_IDLE &&
+        ((preview->frame_ms && now_ms - preview->frame_ms < preview_interval_ms) ||
+         (preview->attempt_ms && now_ms - preview->attempt_ms < preview_interval_ms))) {
+        preview_serve(preview, client);
+        return;
+    }
+    client->phase = CLIENT_RESPONSE;
+    client->waiting_on = preview;
+    client->next_waiter = preview->waiters;
+    preview->waiters = client;
+    if (preview->state == PREVIEW_IDLE) preview_start(preview, now_ms);
+}
+
+static void preview_check_deadlines(uint64_t now_ms) {
+    for (Preview *preview = previews; preview; preview = preview->next) {
+        if (preview->state != PREVIEW_IDLE && now_ms >= preview->deadline_ms) {
+            preview_complete(preview, preview->state == PREVIEW_CONNECTING ? "connect timeout" : "read timeout");
+        }
+    }
+}
+
+// Drops the cached frames of devices that left the registry.
+static void preview_sweep(void) {
+    Preview **link = &previews;
+    while (*link) {
+        Preview *preview = *link;
+        if (preview->state != PREVIEW_IDLE || preview->waiters || find_current_device(preview->device_id) >= 0) {
+            link = &preview->next;
+            continue;
+        }
+        *link = preview->next;
+        free(preview->response.data);
+        free(preview->frame.data);
+        free(preview);
+    }
+}
+
+static int compare_device_order(const void *a, const void *b) {
+    uint64_t x = ((const uint64_t*)a)[0], y = ((const uint64_t*)b)[0];
+    return x < y ? -1 : x > y;
+}
+
+// Index of device `id` in current_state, or -1.
+static long find_current_device(uint64_t id) {
+    long low = 0, high = (long)current_state->device_count - 1;
+    while (low <= high) {
+        long middle = (low + high) / 2;
+        uint64_t middle_id = device_order[middle * 2];
+        if (middle_id == id) return (long)device_order[middle * 2 + 1];
+        if (middle_id < id) low = middle + 1;
+        else high = middle - 1;
+    }
+    return -1;
+}
+
+static void index_current_devices(void) {
+    for (uint32_t i = 0; i < current_state->device_count; ++i) {
+        device_order[i * 2] = current_state->devices[i].id;
+        device_order[i * 2 + 1] = i;
+    }
+    qsort(device_order, current_state->device_count, 2 * sizeof(uint64_t), compare_device_order);
+}
+
+static int device_changed(const PlantStateDevice *a, const PlantStateDevice *b) {
+    return a->ping_timestamp != b->ping_timestamp || a->plant_id != b->plant_id || a->position != b->position ||
+           a->rssi != b->rssi || a->heartbeat_flags != b->heartbeat_flags || strcmp(a->ip, b->ip) != 0 ||
+           strcmp(a->plant_name, b->plant_name) != 0 || strcmp(a->command, b->command) != 0;
+}
+
+// Appends the events that turn current_state into next_state.
+static void append_state_changes(TextBuffer *events) {
+    const PlantState *next = next_state;
+    if (!have_state || next->devices_version != current_state->devices_version || next->writer_pid != current_state->writer_pid) {
+        uint8_t *seen = (uint8_t*)calloc(PLANT_STATE_MAX_DEVICES, 1);
+        for (uint32_t i = 0; i < next->device_count; ++i) {
+            long previous = have_state ? find_current_device(next->devices[i].id) : -1;
+            if (previous >= 0 && seen) seen[previous] = 1;
+            if (previous < 0 || device_changed(&next->devices[i], &current_state->devices[previous])) {
+                append_device_event(events, &next->devices[i]);
+            }
+        }
+        for (uint32_t i = 0; have_state && seen && i < current_state->device_count; ++i) {
+            if (!seen[i]) text_printf(events, "event: device-removed\ndata: {\"id\":%llu}\n\n", (unsigned long long)current_state->devices[i].id);
+        }
+        free(seen);
+    }
+    if (!have_state || next->global_timer_start != current_state->global_timer_start ||
+        next->global_timer_duration != current_state->global_timer_duration || next->processes_loaded != current_state->processes_loaded) {
+        append_timer_event(events, next);
+    }
+    if (have_state && next->plants_version != current_state->plants_version && next->writer_pid == current_state->writer_pid) {
+        text_printf(events, "event: plants\ndata: {\"count\":%u}\n\n", next->plant_count);
+    }
+    for (uint32_t i = 0; i < next->plant_count; ++i) {
+        const PlantStatePlant *plant = &next->plants[i];
+        if (plant->capture_version == plant_metrics[i].capture_version && (have_state || !plant->capture_version)) continue;
+        plant_metrics[i].capture_version = plant->capture_version;
+        plant_metrics[i].found = (uint8_t)plant_series_read_latest(IMAGE_BASE_DIR, i + 1, &plant_metrics[i].record);
+        if (have_state && plant->capture_version) append_metrics_event(events, next, i);
+    }
+}
+
+// Follows the state segment. Cheap when nothing changed: only the header versions are compared.
+static void poll_state(void) {
+    if (shared_state && !plant_state_live(shared_state)) {
+        plant_state_unmap(shared_state);
+        shared_state = NULL;
+    }
+    if (!shared_state) {
+        shared_state = plant_state_map();
+        if (!shared_state) return;
+        if (!plant_state_live(shared_state)) {
+            plant_state_unmap(shared_state);
+            shared_state = NULL;
+            return;
+        }
+    }
+    if (have_state &&
+        __atomic_load_n(&shared_state->devices_version, __ATOMIC_RELAXED) == current_state->devices_version &&
+        __atomic_load_n(&shared_state->plants_version, __ATOMIC_RELAXED) == current_state->plants_version &&
+        __atomic_load_n(&shared_state->processes_version, __ATOMIC_RELAXED) == current_state->processes_version &&
+        __atomic_load_n(&shared_state->captures_version, __ATOMIC_RELAXED) == current_state->captures_version &&
+        __atomic_load_n(&shared_state->writer_pid, __ATOMIC_RELAXED) == current_state->writer_pid) return;
+    if (!plant_state_snapshot(shared_state, next_state) || next_state->magic != PLANT_STATE_MAGIC) return;
+
+    TextBuffer events = {NULL, 0, 0};
+    append_state_changes(&events);
+    PlantState *swap = current_state;
+    current_state = next_state;
+    next_state = swap;
+    have_state = 1;
+    index_current_devices();
+    if (current_state->devices_version != next_state->devices_version) preview_sweep_due = 1;
+    broadcast(&events);
+    free(events.data);
+}
+
+// Announces re-rendered diagnostic images, seen as a new plant_N_artifacts.stamp.
+static void read_artifact_changes(int inotify_fd) {
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t length;
+    TextBuffer events = {NULL, 0, 0};
+    while ((length = read(inotify_fd, buffer, sizeof(buffer))) > 0) {
+        for (char *ptr = buffer; ptr < buffer + length; ptr += sizeof(struct inotify_event) + ((struct inotify_event*)ptr)->len) {
+            const struct inotify_event *changed = (const struct inotify_event*)ptr;
+            unsigned plant_id;
+            int consumed = 0;
+            if (!changed->len || sscanf(changed->name, "plant_%u_artifacts.stamp%n", &plant_id, &consumed) != 1 || changed->name[consumed] != '\0') continue;
+            char path[512];
+            struct stat st;
+            snprintf(path, sizeof(path), "%s%s", IMAGE_BASE_DIR, changed->name);
+            if (stat(path, &st) != 0) continue;
+            text_printf(&events, "event: artifacts\ndata: {\"plant\":%u,\"version\":%lld}\n\n", plant_id,
+                        (long long)st.st_mtim.tv_sec * 1000 + st.st_mtim.tv_nsec / 1000000);
+        }
+    }
+    broadcast(&events);
+    free(events.data);
+}
+
+static void raise_descriptor_limit(rlim_t wanted) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < wanted) {
+        limit.rlim_cur = limit.rlim_max < wanted ? limit.rlim_max : wanted;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+static int run_gateway(const char *socket_path) {
+    current_state = (PlantState*)malloc(sizeof(PlantState));
+    next_state = (PlantState*)malloc(sizeof(PlantState));
+    device_order = (uint64_t*)malloc(PLANT_STATE_MAX_DEVICES * 2 * sizeof(uint64_t));
+    if (!current_state || !next_state || !device_order) {
+        log_message("ERROR: Malloc state snapshots");
+        return 1;
+    }
+    raise_descriptor_limit(GATEWAY_MAX_CLIENTS + PLANT_STATE_MAX_DEVICES + 16);
+    const char *interval_env = getenv("PLANT_MONITOR_PREVIEW_INTERVAL_MS");
+    if (interval_env && atol(interval_env) > 0) preview_interval_ms = (uint64_t)atol(interval_env);
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+    unlink(socket_path);
+    if (listen_fd < 0 || bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(listen_fd, 128) < 0) {
+        log_message("ERROR: Could not listen on %s: %s", socket_path, strerror(errno));
+        return 1;
+    }
+    chmod(socket_path, 0660);
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    int poll_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    int inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (epoll_fd < 0 || poll_fd < 0 || inotify_fd < 0) {
+        log_message("ERROR: Could not set up the event loop: %s", strerror(errno));
+        return 1;
+    }
+    if (inotify_add_watch(inotify_fd, IMAGE_BASE_DIR, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        log_message("WARN: Could not watch %s (%s); artifact events are disabled.", IMAGE_BASE_DIR, strerror(errno));
+    }
+    struct itimerspec interval = { {GATEWAY_POLL_INTERVAL_MS / 1000, (GATEWAY_POLL_INTERVAL_MS % 1000) * 1000000L},
+                                   {GATEWAY_POLL_INTERVAL_MS / 1000, (GATEWAY_POLL_INTERVAL_MS % 1000) * 1000000L} };
+    timerfd_settime(poll_fd, 0, &interval, NULL);
+    struct epoll_event event = { .events = EPOLLIN };
+    event.data.ptr = &listen_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event);
+    event.data.ptr = &poll_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, poll_fd, &event);
+    event.data.ptr = &inotify_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, inotify_fd, &event);
+
+    poll_state();
+    log_message("Event gateway listening on %s.", socket_path);
+    time_t last_keepalive = time(NULL);
+    while (1) {
+        struct epoll_event ready[64];
+        int n = epoll_wait(epoll_fd, ready, 64, -1);
+        if (n < 0 && errno != EINTR) {
+            log_message("ERROR: epoll_wait: %s", strerror(errno));
+            return 1;
+        }
+        for (int i = 0; i < n; ++i) {
+            if (ready[i].data.ptr == &listen_fd) {
+                int fd;
+                while ((fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                    Client *client = client_count < GATEWAY_MAX_CLIENTS ? (Client*)calloc(1, sizeof(Client)) : NULL;
+                    if (client) client->request = (char*)malloc(GATEWAY_REQUEST_MAX);
+                    if (!client || !client->request) {
+                        if (client) free(client);
+                        else log_message("WARN: %d event streams open; refusing another.", client_count);
+                        close(fd);
+                        continue;
+                    }
+                    client->handle = HANDLE_CLIENT;
+                    client->fd = fd;
+                    struct epoll_event client_event = { .events = EPOLLIN | EPOLLRDHUP };
+                    client_event.data.ptr = client;
+                    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &client_event);
+                    client_count++;
+                }
+            } else if (ready[i].data.ptr == &poll_fd) {
+                uint64_t expirations;
+                if (read(poll_fd, &expirations, sizeof(expirations)) <= 0) continue;
+                poll_state();
+                preview_check_deadlines(monotonic_ms());
+                time_t now = time(NULL);
+                if (now - last_keepalive >= GATEWAY_KEEPALIVE_SECONDS) {
+                    static const TextBuffer keepalive = { (char*)": keepalive\n\n", 13, 0 };
+                    broadcast(&keepalive);
+                    last_keepalive = now;
+                }
+            } else if (ready[i].data.ptr == &inotify_fd) {
+                read_artifact_changes(inotify_fd);
+            } else if (*(int*)ready[i].data.ptr == HANDLE_PREVIEW) {
+                preview_on_event((Preview*)ready[i].data.ptr, ready[i].events, monotonic_ms());
+            } else {
+                Client *client = (Client*)ready[i].data.ptr;
+                if (client->fd < 0) continue;
+                if (ready[i].events & EPOLLOUT) {
+                    client_flush(client);
+                    continue;
+                }
+                client_read(client);
+            }
+        }
+        free_closed_clients();
+        if (preview_sweep_due) {
+            preview_sweep();
+            preview_sweep_due = 0;
+        }
+    }
+}
+
+// Opens `connections` event streams against a running gateway, holds them for `seconds` and
+// reports how many stayed open and what they received: gateway --sse-load <socket> <connections> <seconds>.
+static int run_sse_load(const char *socket_path, long connections, long seconds) {
+    if (connections <= 0 || seconds <= 0) {
+        fprintf(stderr, "Usage: gateway --sse-load <socket> <connections> <seconds>\n");
+        return 1;
+    }
+    raise_descriptor_limit((rlim_t)connections + 16);
+    int load_epoll = epoll_create1(EPOLL_CLOEXEC);
+    uint64_t *received = (uint64_t*)calloc((size_t)connections, sizeof(uint64_t));
+    uint64_t *event_counts = (uint64_t*)calloc((size_t)connections, sizeof(uint64_t));
+    if (load_epoll < 0 || !received || !event_counts) return 1;
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+    const char *pairs[] = { "CONTENT_LENGTH", "0", "SCGI", "1", "REQUEST_METHOD", "GET", "REQUEST_URI", "/cgi-bin/events" };
+    char headers[256], request[300];
+    size_t header_length = 0;
+    for (size_t i = 0; i < sizeof(pairs) / sizeof(pairs[0]); ++i) {
+        size_t length = strlen(pairs[i]) + 1;
+        memcpy(headers + header_length, pairs[i], length);
+        header_length += length;
+    }
+    int request_length = snprintf(request, sizeof(request), "%zu:", header_length);
+    memcpy(request + request_length, headers, header_length);
+    request_length += (int)header_length;
+    request[request_length++] = ',';
+    long opened = 0;
+    for (long i = 0; i < connections; ++i) {
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || write(fd, request, (size_t)request_length) != request_length) {
+            fprintf(stderr, "Connection %ld failed: %s\n", i, strerror(errno));
+            if (fd >= 0) close(fd);
+            continue;
+        }
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        struct epoll_event event = { .events = EPOLLIN | EPOLLRDHUP };
+        event.data.u64 = ((uint64_t)i << 32) | (uint32_t)fd;
+        epoll_ctl(load_epoll, EPOLL_CTL_ADD, fd, &event);
+        opened++;
+    }
+
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    long open_streams = opened;
+    do {
+        struct epoll_event ready[64];
+        int n = epoll_wait(load_epoll, ready, 64, 100);
+        for (int i = 0; i < n; ++i) {
+            long index = (long)(ready[i].data.u64 >> 32);
+            int fd = (int)(uint32_t)ready[i].data.u64;
+            char buffer[8192];
+            ssize_t length;
+            while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+                received[index] += (uint64_t)length;
+                for (ssize_t j = 0; j + 6 < length; ++j) event_counts[index] += memcmp(buffer + j, "event:", 6) == 0;
+            }
+            if (length == 0 || (length < 0 && errno != EAGAIN)) {
+                epoll_ctl(load_epoll, EPOLL_CTL_DEL, fd, NULL);
+                close(fd);
+                open_streams--;
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    } while (now.tv_sec - start.tv_sec < seconds);
+
+    uint64_t total_bytes = 0, total_events = 0, min_events = UINT64_MAX;
+    for (long i = 0; i < connections; ++i) {
+        total_bytes += received[i];
+        total_events += event_counts[i];
+        if (event_counts[i] < min_events) min_events = event_counts[i];
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    printf("SSE load: %ld/%ld streams opened, %ld still open after %ld s.\n", opened, connections, open_streams, seconds);
+    printf("Received %llu bytes, %llu events (min %llu per stream).\n", (unsigned long long)total_bytes,
+           (unsigned long long)total_events, (unsigned long long)(min_events == UINT64_MAX ? 0 : min_events));
+    free(received);
+    free(event_counts);
+    return open_streams == connections ? 0 : 1;
+}
+
+// gateway <socket> runs the event gateway; --sse-load drives a running one for benchmarking.
+int main(int argc, char **argv) {
+    if (argc == 5 && strcmp(argv[1], "--sse-load") == 0) return run_sse_load(argv[2], strtol(argv[3], NULL, 10), strtol(argv[4], NULL, 10));
+    if (argc != 2) {
+        fprintf(stderr, "Usage: gateway <socket> | gateway --sse-load <socket> <connections> <seconds>\n");
+        return 1;
+    }
+    return run_gateway(argv[1]);
+}
@@ -5,17 +5,128 @@
 #include <fstream>
 #include <opencv2/opencv.hpp>
 #include <opencv2/imgproc.hpp>
+#include <opencv2/core/hal/intrin.hpp>
 #include <iomanip>
 #include <sstream>
 #include <algorithm>
+#include <map>
+#include <set>
+#include <array>
+#include <memory>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cmath>
+#include <cerrno>
+#include <cstdio>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "plant_state.h"
 
 namespace fs = std::filesystem;
 
-const std::string IMAGE_BASE_DIR = "/var/www/html/data/images/";
+// Overridable at build time so benchmark_plant_images.cpp can write into a scratch directory.
+#ifndef PLANT_IMAGES_BASE_DIR
+#define PLANT_IMAGES_BASE_DIR "/var/www/html/data/images/"
+#endif
+
+const std::string IMAGE_BASE_DIR = PLANT_IMAGES_BASE_DIR;
+const std::string SERVICE_SOCKET_PATH = "/run/plant-monitor/generate_plant_images.sock";
+const std::string PLANTS_FILE = "/var/www/html/data/plants.txt";
+// Upper bound on in-memory frames per service request; application.c uses the same limit.
+const int MAX_HANDOFF_FRAMES = 240;
+// Longest accepted service request line. A BATCH for every plant with a token per view is a few
+// kilobytes; anything past this is answered with "ERR request too long".
+const size_t SERVICE_MAX_REQUEST_BYTES = 64 * 1024;
+// Time a client gets to deliver its whole request line before it is answered "ERR timeout", so
+// a stalled or killed sender cannot hold up the accept loop and every BATCH behind it.
+const int SERVICE_REQUEST_TIMEOUT_MS = 2000;
 
 const double PIXEL_TO_CM_RATIO = 0.1;
 const double PIXEL_AREA_TO_CM2_RATIO = 0.01;
 
+// Opt-in tracing. When PLANT_MONITOR_TRACE_DIR is set, every TRACE_SPAN writes a complete event
+// to <dir>/generate_plant_images-<pid>.json in Chrome trace format (chrome://tracing, Perfetto).
+// Timestamps are CLOCK_MONOTONIC microseconds, the same clock application.c uses, so traces from
+// both processes line up. When disabled a span costs one branch on trace_enabled.
+bool trace_enabled = false;
+std::FILE* trace_file = nullptr;
+std::mutex trace_mutex;
+
+int64_t traceNowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+long traceThreadId() {
+    thread_local long tid = syscall(SYS_gettid);
+    return tid;
+}
+
+void initTracing(const char* process_name) {
+    const char* trace_dir = std::getenv("PLANT_MONITOR_TRACE_DIR");
+    if (!trace_dir || !*trace_dir) return;
+
+    std::string path = std::string(trace_dir) + "/" + process_name + "-" + std::to_string(getpid()) + ".json";
+    trace_file = std::fopen(path.c_str(), "w");
+    if (!trace_file) {
+        std::cerr << "Warning: Could not open trace file " << path << ": " << std::strerror(errno) << std::endl;
+        return;
+    }
+    // The JSON array is left open so a service killed mid-run still leaves a loadable trace.
+    std::fprintf(trace_file, "[{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"%s\"}}",
+                 static_cast<int>(getpid()), process_name);
+    trace_enabled = true;
+    std::cout << "Tracing to " << path << std::endl;
+}
+
+void flushTrace() {
+    if (!trace_enabled) return;
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    std::fflush(trace_file);
+}
+
+// Records the enclosing scope as one span. `name` must be a string literal; `plant_id` is added to
+// the event args when non-negative.
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name, int plant_id = -1) : name_(trace_enabled ? name : nullptr), plant_id_(plant_id) {
+        if (name_) start_us_ = traceNowMicros();
+    }
+    ~TraceSpan() {
+        if (!name_) return;
+        int64_t duration_us = traceNowMicros() - start_us_;
+        std::lock_guard<std::mutex> lock(trace_mutex);
+        std::fprintf(trace_file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":%d,\"tid\":%ld",
+                     name_, static_cast<long long>(start_us_), static_cast<long long>(duration_us),
+                     static_cast<int>(getpid()), traceThreadId());
+        if (plant_id_ >= 0) std::fprintf(trace_file, ",\"args\":{\"plant\":%d}", plant_id_);
+        std::fputc('}', trace_file);
+    }
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* name_;
+    int plant_id_;
+    int64_t start_us_ = 0;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SPAN(...) TraceSpan TRACE_CONCAT(trace_span_, __LINE__)(__VA_ARGS__)
+
 struct MetricData {
     std::string timestamp_str;
     std::time_t timestamp_t;
@@ -27,7 +138,59 @@ struct MetricData {
     double volumetric_proxy;
 };
 
+// Downscaled copies of every image the detail page shows, which displays them at 150x150: browsers
+// pick one through srcset by pixel density instead of scaling the full SVGA frame. They are made
+// from the Mat that is being saved anyway, so they cost a resize and a small encode, no decode.
+// Must match print_detail_image in index.c.
+struct ImageVariant {
+    const char* suffix;
+    int width;
+};
+const ImageVariant IMAGE_VARIANTS[] = {{"_thumb", 160}, {"_mid", 480}};
+const int IMAGE_VARIANT_JPEG_QUALITY = 80;
+
+// plant_1_top_mask.jpg -> plant_1_top_mask_thumb.jpg
+std::string imageVariantFilename(const std::string& filename, const ImageVariant& variant) {
+    size_t dot = filename.rfind('.');
+    if (dot == std::string::npos) return filename + variant.suffix;
+    return filename.substr(0, dot) + variant.suffix + filename.substr(dot);
+}
+
+void saveImageVariants(const cv::Mat& img, const std::string& filename) {
+    TRACE_SPAN("saveImageVariants");
+    if (img.empty()) return;
+    const std::vector<int> jpeg_params = {cv::IMWRITE_JPEG_QUALITY, IMAGE_VARIANT_JPEG_QUALITY};
+    bool jpeg = filename.size() > 4 && filename.compare(filename.size() - 4, 4, ".jpg") == 0;
+    for (const ImageVariant& variant : IMAGE_VARIANTS) {
+        cv::Mat scaled;
+        if (img.cols > variant.width) {
+            int height = std::max(1, static_cast<int>(std::lround(static_cast<double>(img.rows) * variant.width / img.cols)));
+            cv::resize(img, scaled, cv::Size(variant.width, height), 0, 0, cv::INTER_AREA);
+        } else {
+            scaled = img;
+        }
+        std::string path = IMAGE_BASE_DIR + imageVariantFilename(filename, variant);
+        if (!cv::imwrite(path, scaled, jpeg ? jpeg_params : std::vector<int>())) {
+            std::cerr << "Error: Could not save " << path << std::endl;
+        }
+    }
+}
+
+// Whether every variant of IMAGE_BASE_DIR/filename is newer than the file itself. Also true when the
+// file does not exist, since there is nothing on disk for variants to stand in for.
+bool imageVariantsCurrent(const std::string& filename) {
+    std::error_code ec;
+    fs::file_time_type source_time = fs::last_write_time(IMAGE_BASE_DIR + filename, ec);
+    if (ec) return true;
+    for (const ImageVariant& variant : IMAGE_VARIANTS) {
+        fs::file_time_type variant_time = fs::last_write_time(IMAGE_BASE_DIR + imageVariantFilename(filename, variant), ec);
+        if (ec || variant_time <= source_time) return false;
+    }
+    return true;
+}
+
 void saveImage(const cv::Mat& img, const std::string& filename, const std::string& text_overlay = "") {
+    TRACE_SPAN("saveImage");
     std::string full_path = IMAGE_BASE_DIR + filename;
     cv::Mat img_to_save = img.clone();
 
@@ -57,9 +220,11 @@ void saveImage(const cv::Mat& img, const std::string& filename, const std::strin
     } else {
         std::cerr << "Error: Could not save " << full_path << std::endl;
     }
+    saveImageVariants(img_to_save, filename);
 }
 
 cv::Mat processImageToMask(const cv::Mat& input_img) {
+    TRACE_SPAN("processImageToMask");
     if (input_img.empty()) {
         std::cerr << "Warning: Input image for mask generation is empty. Returning a black placeholder mask." << std::endl;
         return cv::Mat(200, 200, CV_8UC1, cv::Scalar(0));
@@ -78,6 +243,7 @@ cv::Mat processImageToMask(const cv::Mat& input_img) {
 }
 
 cv::Mat generateSimulated3DRender(const cv::Mat& img_x, const cv::Mat& img_y, const cv::Mat& img_z, int width, int height) {
+    TRACE_SPAN("generateSimulated3DRender");
     cv::Mat render = cv::Mat(height, width, CV_8UC3, cv::Scalar(150, 100, 50));
 
     cv::Scalar plant_color = cv::Scalar(0, 200, 0);
@@ -103,6 +269,7 @@ cv::Mat generateSimulated3DRender(const cv::Mat& img_x, const cv::Mat& img_y, co
 }
 
 cv::Mat processToGrayscale(const cv::Mat& input_img) {
+    TRACE_SPAN("processToGrayscale");
     if (input_img.empty()) {
         std::cerr << "Warning: Input image for grayscale conversion is empty. Returning a black placeholder." << std::endl;
         return cv::Mat(200, 200, CV_8UC1, cv::Scalar(0));
@@ -117,6 +284,7 @@ cv::Mat processToGrayscale(const cv::Mat& input_img) {
 }
 
 cv::Mat processToEdges(const cv::Mat& input_img) {
+    TRACE_SPAN("processToEdges");
     if (input_img.empty()) {
         std::cerr << "Warning: Input image for edge detection is empty. Returning a black placeholder." << std::endl;
         return cv::Mat(200, 200, CV_8UC1, cv::Scalar(0));
@@ -128,6 +296,7 @@ cv::Mat processToEdges(const cv::Mat& input_img) {
 }
 
 cv::Mat processToGreenChannel(const cv::Mat& input_img) {
+    TRACE_SPAN("processToGreenChannel");
     if (input_img.empty()) {
         std::cerr << "Warning: Input image for green channel extraction is empty. Returning a black placeholder." << std::endl;
         return cv::Mat(200, 200, CV_8UC1, cv::Scalar(0));
@@ -142,6 +311,7 @@ cv::Mat processToGreenChannel(const cv::Mat& input_img) {
 }
 
 cv::Mat processGreenThreshold(const cv::Mat& input_img) {
+    TRACE_SPAN("processGreenThreshold");
     if (input_img.empty()) {
         std::cerr << "Warning: Input image for green thresholding is empty. Returning a black placeholder." << std::endl;
         return cv::Mat(200, 200, CV_8UC1, cv::Scalar(0));
@@ -168,6 +338,7 @@ double calculateBinaryArea(const cv::Mat& binary_mask) {
 }
 
 double calculateMeanHueInMask(const cv::Mat& original_bgr, const cv::Mat& binary_mask) {
+    TRACE_SPAN("calculateMeanHueInMask");
     if (original_bgr.empty() || binary_mask.empty() || original_bgr.channels() != 3 || binary_mask.channels() != 1) {
         std::cerr << "Warning: Invalid input for mean hue calculation." << std::endl;
         return 0.0;
@@ -184,7 +355,214 @@ double calculateMeanHueInMask(const cv::Mat& original_bgr, const cv::Mat& binary
     return mean_hue.val[0];
 }
 
+// Green segmentation result of the fused kernel: canopy pixel count and the sum of their 8-bit hues.
+struct GreenCanopyStats {
+    uint64_t pixel_count = 0;
+    uint64_t hue_sum = 0;
+
+    // Same arithmetic as cv::mean(hue_channel, mask) so the color index stays bit-exact.
+    double meanHue() const {
+        return static_cast<double>(hue_sum) * (pixel_count ? 1. / static_cast<double>(pixel_count) : 0.);
+    }
+};
+
+// Divisor tables of OpenCV's 8-bit BGR2HSV conversion (hsv_shift = 12, hue range 0..180).
+const int HSV_SHIFT = 12;
+struct HsvDivTables {
+    int sdiv[256];
+    int hdiv[256];
+    HsvDivTables() {
+        sdiv[0] = hdiv[0] = 0;
+        for (int i = 1; i < 256; ++i) {
+            sdiv[i] = cv::saturate_cast<int>((255 << HSV_SHIFT) / (1. * i));
+            hdiv[i] = cv::saturate_cast<int>((180 << HSV_SHIFT) / (6. * i));
+        }
+    }
+};
+const HsvDivTables HSV_DIV_TABLES;
+
+// Scalar reference path: converts one BGR pixel exactly like cv::cvtColor(COLOR_BGR2HSV) and applies
+// the processGreenThreshold range. Returns true for canopy pixels and stores their hue.
+inline bool classifyGreenPixel(int b, int g, int r, int& hue) {
+    int v = std::max(b, std::max(g, r));
+    int vmin = std::min(b, std::min(g, r));
+    int diff = v - vmin;
+    int vr = v == r ? -1 : 0;
+    int vg = v == g ? -1 : 0;
+
+    int s = (diff * HSV_DIV_TABLES.sdiv[v] + (1 << (HSV_SHIFT - 1))) >> HSV_SHIFT;
+    int h = (vr & (g - b)) + (~vr & ((vg & (b - r + 2 * diff)) + ((~vg) & (r - g + 4 * diff))));
+    h = (h * HSV_DIV_TABLES.hdiv[diff] + (1 << (HSV_SHIFT - 1))) >> HSV_SHIFT;
+    h += h < 0 ? 180 : 0;
+
+    hue = h;
+    return h >= 30 && h <= 80 && s >= 40 && v >= 40;
+}
+
+GreenCanopyStats segmentGreenCanopyScalar(const cv::Mat& input_img, cv::Mat& green_mask) {
+    GreenCanopyStats stats;
+    green_mask.create(input_img.rows, input_img.cols, CV_8UC1);
+    for (int y = 0; y < input_img.rows; ++y) {
+        const uchar* src = input_img.ptr<uchar>(y);
+        uchar* dst = green_mask.ptr<uchar>(y);
+        for (int x = 0; x < input_img.cols; ++x, src += 3) {
+            int hue;
+            bool green = classifyGreenPixel(src[0], src[1], src[2], hue);
+            dst[x] = green ? 255 : 0;
+            if (green) {
+                stats.pixel_count++;
+                stats.hue_sum += static_cast<uint64_t>(hue);
+            }
+        }
+    }
+    return stats;
+}
+
+// Fused replacement for processGreenThreshold + calculateBinaryArea + calculateMeanHueInMask:
+// reads every BGR pixel once and produces the green mask, canopy pixel count and hue sum.
+// Vectorized with OpenCV universal intrinsics; the tail of each row uses the scalar path.
+GreenCanopyStats segmentGreenCanopy(const cv::Mat& input_img, cv::Mat& green_mask) {
+    TRACE_SPAN("segmentGreenCanopy");
+    if (input_img.empty() || input_img.type() != CV_8UC3) {
+        if (input_img.empty()) {
+            std::cerr << "Warning: Input image for green segmentation is empty. Returning a black placeholder." << std::endl;
+        }
+        green_mask = processGreenThreshold(input_img);
+        GreenCanopyStats stats;
+        stats.pixel_count = static_cast<uint64_t>(calculateBinaryArea(green_mask));
+        return stats;
+    }
+
+#if CV_SIMD && !CV_SIMD_SCALABLE
+    using namespace cv;
+    GreenCanopyStats stats;
+    green_mask.create(input_img.rows, input_img.cols, CV_8UC1);
+
+    const int vlanes = v_uint8::nlanes;
+    const v_int32 v_descale = vx_setall_s32(1 << (HSV_SHIFT - 1));
+    const v_int32 v_zero = vx_setzero_s32();
+    const v_int32 v_hue_range = vx_setall_s32(180);
+    const v_int32 v_hue_low = vx_setall_s32(30);
+    const v_int32 v_hue_high = vx_setall_s32(80);
+    const v_int32 v_sv_low = vx_setall_s32(40);
+
+    for (int y = 0; y < input_img.rows; ++y) {
+        const uchar* src = input_img.ptr<uchar>(y);
+        uchar* dst = green_mask.ptr<uchar>(y);
+        v_int32 hue_acc = vx_setzero_s32();
+        v_int32 count_acc = vx_setzero_s32();
+
+        int x = 0;
+        for (; x <= input_img.cols - vlanes; x += vlanes) {
+            v_uint8 b8, g8, r8;
+            v_load_deinterleave(src + x * 3, b8, g8, r8);
+            v_uint16 b16[2], g16[2], r16[2];
+            v_expand(b8, b16[0], b16[1]);
+            v_expand(g8, g16[0], g16[1]);
+            v_expand(r8, r16[0], r16[1]);
+
+            v_int16 mask16[2];
+            for (int half = 0; half < 2; ++half) {
+                v_uint32 b32[2], g32[2], r32[2];
+                v_expand(b16[half], b32[0], b32[1]);
+                v_expand(g16[half], g32[0], g32[1]);
+                v_expand(r16[half], r32[0], r32[1]);
+
+                v_int32 mask32[2];
+                for (int q = 0; q < 2; ++q) {
+                    v_int32 b = v_reinterpret_as_s32(b32[q]);
+                    v_int32 g = v_reinterpret_as_s32(g32[q]);
+                    v_int32 r = v_reinterpret_as_s32(r32[q]);
+
+                    v_int32 v = v_max(v_max(b, g), r);
+                    v_int32 vmin = v_min(v_min(b, g), r);
+                    v_int32 diff = v - vmin;
+                    v_int32 vr = v == r;
+                    v_int32 vg = v == g;
+
+                    v_int32 s = (diff * v_lut(HSV_DIV_TABLES.sdiv, v) + v_descale) >> HSV_SHIFT;
+                    v_int32 h = (vr & (g - b)) + (~vr & ((vg & (b - r + (diff << 1))) + (~vg & (r - g + (diff << 2)))));
+                    h = (h * v_lut(HSV_DIV_TABLES.hdiv, diff) + v_descale) >> HSV_SHIFT;
+                    h = h + ((h < v_zero) & v_hue_range);
+
+                    v_int32 green = (h >= v_hue_low) & (h <= v_hue_high) & (s >= v_sv_low) & (v >= v_sv_low);
+                    hue_acc += h & green;
+                    count_acc -= green;
+                    mask32[q] = green;
+                }
+                mask16[half] = v_pack(mask32[0], mask32[1]);
+            }
+            v_store(dst + x, v_reinterpret_as_u8(v_pack(mask16[0], mask16[1])));
+        }
+        stats.hue_sum += static_cast<uint64_t>(v_reduce_sum(hue_acc));
+        stats.pixel_count += static_cast<uint64_t>(v_reduce_sum(count_acc));
+
+        for (src += x * 3; x < input_img.cols; ++x, src += 3) {
+            int hue;
+            bool green = classifyGreenPixel(src[0], src[1], src[2], hue);
+            dst[x] = green ? 255 : 0;
+            if (green) {
+                stats.pixel_count++;
+                stats.hue_sum += static_cast<uint64_t>(hue);
+            }
+        }
+    }
+    vx_cleanup();
+    return stats;
+#else
+    return segmentGreenCanopyScalar(input_img, green_mask);
+#endif
+}
+
+bool masksEqual(const cv::Mat& a, const cv::Mat& b) {
+    if (a.rows != b.rows || a.cols != b.cols || a.type() != b.type()) return false;
+    size_t row_bytes = static_cast<size_t>(a.cols) * a.elemSize();
+    for (int y = 0; y < a.rows; ++y) {
+        if (std::memcmp(a.ptr<uchar>(y), b.ptr<uchar>(y), row_bytes) != 0) return false;
+    }
+    return true;
+}
+
+// The fused kernel must agree bit for bit with its scalar reference and with the original
+// cvtColor + inRange path, and its hue mean must match calculateMeanHueInMask.
+bool crossCheckSegmentation(const cv::Mat& img, const std::string& label) {
+    cv::Mat fused_mask, scalar_mask;
+    GreenCanopyStats fused = segmentGreenCanopy(img, fused_mask);
+    GreenCanopyStats scalar = segmentGreenCanopyScalar(img, scalar_mask);
+    cv::Mat reference_mask = processGreenThreshold(img);
+    double reference_area = calculateBinaryArea(reference_mask);
+    double reference_hue = calculateMeanHueInMask(img, reference_mask);
+
+    bool ok = masksEqual(fused_mask, scalar_mask) && masksEqual(fused_mask, reference_mask) &&
+              fused.pixel_count == scalar.pixel_count && fused.hue_sum == scalar.hue_sum &&
+              static_cast<double>(fused.pixel_count) == reference_area &&
+              std::fabs(fused.meanHue() - reference_hue) <= 1e-9 * std::max(1.0, reference_hue);
+    if (!ok) {
+        std::fprintf(stderr, "MISMATCH %s: fused %llu px hue %.6f, reference %.0f px hue %.6f\n", label.c_str(),
+                     static_cast<unsigned long long>(fused.pixel_count), fused.meanHue(), reference_area, reference_hue);
+    }
+    return ok;
+}
+
+// Bounding box of the largest external contour in a binary mask (empty if there is none).
+cv::Rect largestBlobBoundingBox(const cv::Mat& binary_mask) {
+    std::vector<std::vector<cv::Point>> contours;
+    cv::findContours(binary_mask, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+
+    double max_area = 0;
+    int largest_contour_idx = -1;
+    for (size_t i = 0; i < contours.size(); ++i) {
+        double area = cv::contourArea(contours[i]);
+        if (area > max_area) {
+            max_area = area;
+            largest_contour_idx = i;
+        }
+    }
+    return largest_contour_idx != -1 ? cv::boundingRect(contours[largest_contour_idx]) : cv::Rect();
+}
+
 void getBoundingBoxDimensions(const cv::Mat& binary_mask, double& height, double& width) {
+    TRACE_SPAN("getBoundingBoxDimensions");
     height = 0.0;
     width = 0.0;
     if (binary_mask.empty() || binary_mask.channels() != 1 || binary_mask.type() != CV_8UC1) {
@@ -192,47 +570,441 @@ void getBoundingBoxDimensions(const cv::Mat& binary_mask, double& height, double
         return;
     }
 
-    std::vector<std::vector<cv::Point>> contours;
-    cv::findContours(binary_mask, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+    cv::Rect bounding_box = largestBlobBoundingBox(binary_mask);
+    height = static_cast<double>(bounding_box.height);
+    width = static_cast<double>(bounding_box.width);
+}
 
-    if (!contours.empty()) {
-        double max_area = 0;
-        int largest_contour_idx = -1;
-        for (size_t i = 0; i < contours.size(); ++i) {
-            double area = cv::contourArea(contours[i]);
-            if (area > max_area) {
-                max_area = area;
-                largest_contour_idx = i;
+// Per-plant metric history: plant_N_metrics.series holds a SeriesHeader followed by MetricRecords
+// (both in plant_state.h) appended in capture order. Once it holds two blocks worth of records the oldest block
+// is XOR/delta compressed into plant_N_metrics.cold and the hot file is rewritten without it.
+// The hot header records how much of the cold file is committed, so an interrupted compaction
+// never duplicates samples.
+const uint32_t COLD_BLOCK_MAGIC = 0x42434d50; // "PMCB"
+const size_t SERIES_BLOCK_RECORDS = 256;
+
+const size_t METRIC_RECORD_VALUES = 6;
+
+struct ColdBlockHeader {
+    uint32_t magic;
+    uint32_t record_count;
+    uint32_t payload_bytes;
+};
+
+std::string seriesPath(int plant_id) {
+    return IMAGE_BASE_DIR + "plant_" + std::to_string(plant_id) + "_metrics.series";
+}
+
+std::string coldSeriesPath(int plant_id) {
+    return IMAGE_BASE_DIR + "plant_" + std::to_string(plant_id) + "_metrics.cold";
+}
+
+MetricRecord toMetricRecord(const MetricData& data) {
+    return MetricRecord{static_cast<int64_t>(data.timestamp_t), data.canopy_area, data.color_index,
+                        data.height_hp, data.width1, data.width2, data.volumetric_proxy};
+}
+
+MetricData toMetricData(const MetricRecord& record) {
+    MetricData data;
+    data.timestamp_t = static_cast<std::time_t>(record.timestamp);
+    std::tm local_tm = {};
+    localtime_r(&data.timestamp_t, &local_tm);
+    char timestamp_buf[32];
+    std::strftime(timestamp_buf, sizeof(timestamp_buf), "%Y%m%d_%H%M%S", &local_tm);
+    data.timestamp_str = timestamp_buf;
+    data.canopy_area = record.canopy_area;
+    data.color_index = record.color_index;
+    data.height_hp = record.height_hp;
+    data.width1 = record.width1;
+    data.width2 = record.width2;
+    data.volumetric_proxy = record.volumetric_proxy;
+    return data;
+}
+
+uint64_t metricValueBits(const MetricRecord& record, size_t index) {
+    const double* values = &record.canopy_area;
+    uint64_t bits;
+    std::memcpy(&bits, &values[index], sizeof(bits));
+    return bits;
+}
+
+void setMetricValueBits(MetricRecord& record, size_t index, uint64_t bits) {
+    double* values = &record.canopy_area;
+    std::memcpy(&values[index], &bits, sizeof(bits));
+}
+
+class BitWriter {
+public:
+    void writeBit(bool bit) {
+        if (used_ == 0) bytes_.push_back(0);
+        if (bit) bytes_.back() |= static_cast<uint8_t>(0x80 >> used_);
+        used_ = (used_ + 1) & 7;
+    }
+    void write(uint64_t value, int bits) {
+        for (int i = bits - 1; i >= 0; --i) writeBit((value >> i) & 1);
+    }
+    const std::vector<uint8_t>& bytes() const { return bytes_; }
+
+private:
+    std::vector<uint8_t> bytes_;
+    int used_ = 0;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : data_(data), bit_count_(size * 8) {}
+    bool readBit(bool& bit) {
+        if (pos_ >= bit_count_) return false;
+        bit = (data_[pos_ / 8] >> (7 - pos_ % 8)) & 1;
+        pos_++;
+        return true;
+    }
+    bool read(int bits, uint64_t& value) {
+        value = 0;
+        for (int i = 0; i < bits; ++i) {
+            bool bit;
+            if (!readBit(bit)) return false;
+            value = (value << 1) | (bit ? 1 : 0);
+        }
+        return true;
+    }
+
+private:
+    const uint8_t* data_;
+    size_t bit_count_;
+    size_t pos_ = 0;
+};
+
+// Gorilla-style XOR encoding: unchanged values cost one bit, others store only the meaningful
+// bits of the XOR with the previous value, reusing the previous leading/trailing zero window when it fits.
+struct XorState {
+    uint64_t prev = 0;
+    int leading = -1;
+    int trailing = 0;
+};
+
+void encodeXorValue(BitWriter& writer, XorState& state, uint64_t bits) {
+    uint64_t x = bits ^ state.prev;
+    state.prev = bits;
+    if (x == 0) {
+        writer.writeBit(false);
+        return;
+    }
+    writer.writeBit(true);
+    int leading = std::min(__builtin_clzll(x), 31);
+    int trailing = __builtin_ctzll(x);
+    if (state.leading >= 0 && leading >= state.leading && trailing >= state.trailing) {
+        writer.writeBit(false);
+        writer.write(x >> state.trailing, 64 - state.leading - state.trailing);
+    } else {
+        int meaningful = 64 - leading - trailing;
+        writer.writeBit(true);
+        writer.write(static_cast<uint64_t>(leading), 5);
+        writer.write(static_cast<uint64_t>(meaningful - 1), 6);
+        writer.write(x >> trailing, meaningful);
+        state.leading = leading;
+        state.trailing = trailing;
+    }
+}
+
+bool decodeXorValue(BitReader& reader, XorState& state, uint64_t& bits) {
+    bool changed, new_window;
+    if (!reader.readBit(changed)) return false;
+    if (!changed) {
+        bits = state.prev;
+        return true;
+    }
+    if (!reader.readBit(new_window)) return false;
+    if (new_window) {
+        uint64_t leading, meaningful_minus_one;
+        if (!reader.read(5, leading) || !reader.read(6, meaningful_minus_one)) return false;
+        state.leading = static_cast<int>(leading);
+        state.trailing = 64 - state.leading - static_cast<int>(meaningful_minus_one + 1);
+    } else if (state.leading < 0) {
+        return false;
+    }
+    uint64_t meaningful_bits;
+    if (!reader.read(64 - state.leading - state.trailing, meaningful_bits)) return false;
+    state.prev ^= meaningful_bits << state.trailing;
+    bits = state.prev;
+    return true;
+}
+
+// Timestamps are stored as delta-of-delta; regular capture intervals encode to a single bit.
+void encodeTimestamp(BitWriter& writer, int64_t& prev_ts, int64_t& prev_delta, int64_t ts) {
+    int64_t delta = ts - prev_ts;
+    int64_t dod = delta - prev_delta;
+    prev_ts = ts;
+    prev_delta = delta;
+    if (dod == 0) {
+        writer.writeBit(false);
+    } else if (dod >= -63 && dod <= 64) {
+        writer.write(0x2, 2);
+        writer.write(static_cast<uint64_t>(dod + 63), 7);
+    } else if (dod >= -255 && dod <= 256) {
+        writer.write(0x6, 3);
+        writer.write(static_cast<uint64_t>(dod + 255), 9);
+    } else if (dod >= -2047 && dod <= 2048) {
+        writer.write(0xE, 4);
+        writer.write(static_cast<uint64_t>(dod + 2047), 12);
+    } else {
+        writer.write(0xF, 4);
+        writer.write(static_cast<uint64_t>(dod), 64);
+    }
+}
+
+bool decodeTimestamp(BitReader& reader, int64_t& prev_ts, int64_t& prev_delta, int64_t& ts) {
+    int prefix_ones = 0;
+    bool bit = true;
+    while (prefix_ones < 4) {
+        if (!reader.readBit(bit)) return false;
+        if (!bit) break;
+        prefix_ones++;
+    }
+    static const int payload_bits[] = {0, 7, 9, 12, 64};
+    static const int64_t payload_bias[] = {0, 63, 255, 2047, 0};
+    uint64_t payload = 0;
+    if (prefix_ones > 0 && !reader.read(payload_bits[prefix_ones], payload)) return false;
+    int64_t dod = static_cast<int64_t>(payload) - payload_bias[prefix_ones];
+    prev_delta += dod;
+    prev_ts += prev_delta;
+    ts = prev_ts;
+    return true;
+}
+
+std::vector<uint8_t> encodeColdBlock(const MetricRecord* records, size_t count) {
+    BitWriter writer;
+    int64_t prev_ts = 0, prev_delta = 0;
+    XorState states[METRIC_RECORD_VALUES];
+    for (size_t i = 0; i < count; ++i) {
+        encodeTimestamp(writer, prev_ts, prev_delta, records[i].timestamp);
+        for (size_t v = 0; v < METRIC_RECORD_VALUES; ++v) {
+            encodeXorValue(writer, states[v], metricValueBits(records[i], v));
+        }
+    }
+
+    ColdBlockHeader header = {COLD_BLOCK_MAGIC, static_cast<uint32_t>(count), static_cast<uint32_t>(writer.bytes().size())};
+    std::vector<uint8_t> block(sizeof(header));
+    std::memcpy(block.data(), &header, sizeof(header));
+    block.insert(block.end(), writer.bytes().begin(), writer.bytes().end());
+    block.resize(block.size() + sizeof(uint32_t));
+    std::memcpy(block.data() + block.size() - sizeof(uint32_t), &header.payload_bytes, sizeof(uint32_t));
+    return block;
+}
+
+bool decodeColdBlock(const uint8_t* payload, const ColdBlockHeader& header, std::vector<MetricRecord>& records) {
+    BitReader reader(payload, header.payload_bytes);
+    int64_t prev_ts = 0, prev_delta = 0;
+    XorState states[METRIC_RECORD_VALUES];
+    records.resize(header.record_count);
+    for (MetricRecord& record : records) {
+        if (!decodeTimestamp(reader, prev_ts, prev_delta, record.timestamp)) return false;
+        for (size_t v = 0; v < METRIC_RECORD_VALUES; ++v) {
+            uint64_t bits;
+            if (!decodeXorValue(reader, states[v], bits)) return false;
+            setMetricValueBits(record, v, bits);
+        }
+    }
+    return true;
+}
+
+// Read-only memory mapping of a whole file; empty when the file is missing.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return;
+        map(fd);
+        close(fd);
+    }
+    // Maps an already open descriptor (e.g. a memfd received over the service socket). The
+    // mapping stays valid after the caller closes fd.
+    explicit MappedFile(int fd) { map(fd); }
+    ~MappedFile() {
+        if (data_) munmap(const_cast<uint8_t*>(data_), size_);
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    void map(int fd) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* mapped = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                data_ = static_cast<const uint8_t*>(mapped);
+                size_ = static_cast<size_t>(st.st_size);
             }
         }
+    }
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+bool readSeriesHeader(const MappedFile& hot, SeriesHeader& header) {
+    if (hot.size() < sizeof(SeriesHeader)) return false;
+    std::memcpy(&header, hot.data(), sizeof(header));
+    return header.magic == SERIES_MAGIC && header.version == SERIES_VERSION && header.record_size == sizeof(MetricRecord);
+}
+
+// Decoded cold history per plant. The cold file is append-only and the hot header records how
+// much of it is committed, so an entry stays valid while cold_bytes matches and only blocks
+// compacted since are decoded. The service keeps these across cycles.
+struct ColdSeriesCache {
+    uint64_t cold_bytes = 0;
+    std::vector<MetricRecord> records;
+};
+std::mutex cold_series_mutex;
+std::map<int, ColdSeriesCache> cold_series_cache;
+
+// Appends the records of the cold blocks stored in [begin, end) of the cold file. Returns false
+// at the first truncated or corrupt block, keeping the records decoded before it.
+bool decodeColdBlocks(int plant_id, size_t begin, size_t end, std::vector<MetricRecord>& records) {
+    MappedFile cold(coldSeriesPath(plant_id));
+    if (cold.size() < end) return false;
+    size_t pos = begin;
+    while (pos < end) {
+        ColdBlockHeader block_header;
+        if (end - pos < sizeof(block_header) + sizeof(uint32_t)) return false;
+        std::memcpy(&block_header, cold.data() + pos, sizeof(block_header));
+        size_t block_size = sizeof(ColdBlockHeader) + block_header.payload_bytes + sizeof(uint32_t);
+        std::vector<MetricRecord> block;
+        if (block_header.magic != COLD_BLOCK_MAGIC || block_size > end - pos ||
+            !decodeColdBlock(cold.data() + pos + sizeof(ColdBlockHeader), block_header, block)) {
+            return false;
+        }
+        records.insert(records.end(), block.begin(), block.end());
+        pos += block_size;
+    }
+    return true;
+}
+
+// Returns every sample of a plant in chronological order: the cached cold history followed by
+// the hot records.
+std::vector<MetricRecord> readMetricHistory(int plant_id) {
+    TRACE_SPAN("readMetricHistory", plant_id);
+    std::vector<MetricRecord> result;
+    MappedFile hot(seriesPath(plant_id));
+    SeriesHeader header;
+    if (!readSeriesHeader(hot, header)) return result;
+
+    const MetricRecord* hot_records = reinterpret_cast<const MetricRecord*>(hot.data() + sizeof(SeriesHeader));
+    size_t hot_count = (hot.size() - sizeof(SeriesHeader)) / sizeof(MetricRecord);
+
+    std::lock_guard<std::mutex> lock(cold_series_mutex);
+    ColdSeriesCache& cache = cold_series_cache[plant_id];
+    if (cache.cold_bytes > header.cold_bytes) cache = ColdSeriesCache();
+    std::vector<MetricRecord> added;
+    if (cache.cold_bytes < header.cold_bytes) {
+        if (decodeColdBlocks(plant_id, cache.cold_bytes, header.cold_bytes, added)) {
+            cache.records.insert(cache.records.end(), added.begin(), added.end());
+            cache.cold_bytes = header.cold_bytes;
+            added.clear();
+        } else {
+            std::cerr << "Warning: Corrupt cold block in " << coldSeriesPath(plant_id) << std::endl;
+        }
+    }
+
+    result.reserve(cache.records.size() + added.size() + hot_count);
+    result.insert(result.end(), cache.records.begin(), cache.records.end());
+    result.insert(result.end(), added.begin(), added.end());
+    result.insert(result.end(), hot_records, hot_records + hot_count);
+    return result;
+}
+
+bool writeAll(int fd, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+        ssize_t n = write(fd, bytes, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        bytes += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Moves the oldest block of hot records into the cold file and atomically replaces the hot file.
+bool compactMetricSeries(int plant_id) {
+    TRACE_SPAN("compactMetricSeries", plant_id);
+    std::vector<uint8_t> hot_copy;
+    SeriesHeader header;
+    {
+        MappedFile hot(seriesPath(plant_id));
+        if (!readSeriesHeader(hot, header)) return false;
+        hot_copy.assign(hot.data(), hot.data() + hot.size());
+    }
+    const MetricRecord* records = reinterpret_cast<const MetricRecord*>(hot_copy.data() + sizeof(SeriesHeader));
+    size_t hot_count = (hot_copy.size() - sizeof(SeriesHeader)) / sizeof(MetricRecord);
+    if (hot_count < 2 * SERIES_BLOCK_RECORDS) return true;
+
+    std::vector<uint8_t> block = encodeColdBlock(records, SERIES_BLOCK_RECORDS);
+    int cold_fd = open(coldSeriesPath(plant_id).c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0664);
+    if (cold_fd < 0) return false;
+    bool ok = ftruncate(cold_fd, static_cast<off_t>(header.cold_bytes)) == 0 &&
+              lseek(cold_fd, static_cast<off_t>(header.cold_bytes), SEEK_SET) >= 0 &&
+              writeAll(cold_fd, block.data(), block.size()) && fsync(cold_fd) == 0;
+    close(cold_fd);
+    if (!ok) return false;
+
+    header.cold_records += SERIES_BLOCK_RECORDS;
+    header.cold_bytes += block.size();
+    std::string tmp_path = seriesPath(plant_id) + ".tmp";
+    int hot_fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0664);
+    if (hot_fd < 0) return false;
+    ok = writeAll(hot_fd, &header, sizeof(header)) &&
+         writeAll(hot_fd, records + SERIES_BLOCK_RECORDS, (hot_count - SERIES_BLOCK_RECORDS) * sizeof(MetricRecord)) &&
+         fsync(hot_fd) == 0;
+    close(hot_fd);
+    if (!ok || rename(tmp_path.c_str(), seriesPath(plant_id).c_str()) != 0) {
+        unlink(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool appendMetricRecords(int plant_id, const MetricRecord* records, size_t count) {
+    int fd = open(seriesPath(plant_id).c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0664);
+    if (fd < 0) {
+        std::cerr << "Error: Could not open metrics series for writing: " << seriesPath(plant_id) << std::endl;
+        return false;
+    }
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0;
+    if (ok && st.st_size == 0) {
+        SeriesHeader header = {SERIES_MAGIC, SERIES_VERSION, sizeof(MetricRecord), 0, 0, 0};
+        ok = writeAll(fd, &header, sizeof(header));
+    }
+    ok = ok && writeAll(fd, records, count * sizeof(MetricRecord));
+    off_t size = ok ? lseek(fd, 0, SEEK_END) : 0;
+    close(fd);
+    if (!ok) {
+        std::cerr << "Error: Could not append to metrics series: " << seriesPath(plant_id) << std::endl;
+        return false;
+    }
 
-        if (largest_contour_idx != -1) {
-            cv::Rect bounding_box = cv::boundingRect(contours[largest_contour_idx]);
-            height = static_cast<double>(bounding_box.height);
-            width = static_cast<double>(bounding_box.width);
+    size_t hot_count = (static_cast<size_t>(size) - sizeof(SeriesHeader)) / sizeof(MetricRecord);
+    while (hot_count >= 2 * SERIES_BLOCK_RECORDS) {
+        if (!compactMetricSeries(plant_id)) {
+            std::cerr << "Warning: Could not compact metrics series for Plant ID: " << plant_id << std::endl;
+            break;
         }
+        hot_count -= SERIES_BLOCK_RECORDS;
     }
+    return true;
 }
 
 void writePlantMetricsToFile(int plant_id, double canopy_area, double color_index,
                              double height_hp, double width1, double width2, double volumetric_proxy,
-                             const std::string& timestamp_str) {
-    std::string filename = IMAGE_BASE_DIR + "plant_" + std::to_string(plant_id) + "_metrics_" + timestamp_str + ".txt";
-    std::ofstream outfile(filename);
-
-    if (outfile.is_open()) {
-        outfile << "Plant ID: " << plant_id << std::endl;
-        outfile << "Timestamp: " << timestamp_str << std::endl;
-        outfile << "Canopy Area (Ac): " << canopy_area << " cm^2" << std::endl;
-        outfile << "Color Index (Ihue): " << color_index << std::endl;
-        outfile << "Height (Hp): " << height_hp << " cm" << std::endl;
-        outfile << "Width 1 (W1): " << width1 << " cm" << std::endl;
-        outfile << "Width 2 (W2): " << width2 << " cm" << std::endl;
-        outfile << "Volumetric Proxy (Vp): " << volumetric_proxy << " cm^3" << std::endl;
-        outfile.close();
-        std::cout << "Generated metrics file: " << filename << std::endl;
-    } else {
-        std::cerr << "Error: Could not open metrics file for writing: " << filename << std::endl;
+                             std::time_t timestamp_t) {
+    TRACE_SPAN("writePlantMetricsToFile", plant_id);
+    MetricRecord record = {static_cast<int64_t>(timestamp_t), canopy_area, color_index, height_hp, width1, width2, volumetric_proxy};
+    if (appendMetricRecords(plant_id, &record, 1)) {
+        std::cout << "Appended metrics sample to: " << seriesPath(plant_id) << std::endl;
     }
 }
 
@@ -282,7 +1054,8 @@ bool parseMetricsFile(const std::string& filename, MetricData& data) {
     return true;
 }
 
-void collectHistoricalMetrics(int plant_id, std::vector<MetricData>& history_data) {
+void collectLegacyMetrics(int plant_id, std::vector<MetricData>& history_data) {
+    TRACE_SPAN("collectLegacyMetrics (directory scan)", plant_id);
     history_data.clear();
     std::string plant_id_prefix = "plant_" + std::to_string(plant_id) + "_metrics_";
 
@@ -304,30 +1077,65 @@ void collectHistoricalMetrics(int plant_id, std::vector<MetricData>& history_dat
     });
 }
 
-void plotMetricGraph(int plant_id, const std::vector<MetricData>& history_data,
-                     const std::string& metric_key_original, const std::string& graph_title,
-                     const std::string& y_axis_label) {
-    if (history_data.empty()) {
-        std::cerr << "No historical data to plot for " << metric_key_original << " for Plant ID: " << plant_id << std::endl;
-        return;
+// One-shot import of the legacy plant_N_metrics_<ts>.txt files into the binary series. Runs only
+// while the plant has no series file yet.
+void importLegacyMetrics(int plant_id) {
+    TRACE_SPAN("importLegacyMetrics", plant_id);
+    if (fs::exists(seriesPath(plant_id))) return;
+
+    std::vector<MetricData> legacy_data;
+    collectLegacyMetrics(plant_id, legacy_data);
+    if (legacy_data.empty()) return;
+
+    std::vector<MetricRecord> records;
+    records.reserve(legacy_data.size());
+    for (const MetricData& data : legacy_data) records.push_back(toMetricRecord(data));
+    if (appendMetricRecords(plant_id, records.data(), records.size())) {
+        std::cout << "Imported " << records.size() << " legacy metrics files for Plant ID: " << plant_id << std::endl;
     }
+}
 
-    std::vector<double> values;
-    for (const auto& data : history_data) {
-        if (metric_key_original == "Canopy Area (Ac)") values.push_back(data.canopy_area);
-        else if (metric_key_original == "Color Index (Ihue)") values.push_back(data.color_index);
-        else if (metric_key_original == "Height (Hp)") values.push_back(data.height_hp);
-        else if (metric_key_original == "Width 1 (W1)") values.push_back(data.width1);
-        else if (metric_key_original == "Width 2 (W2)") values.push_back(data.width2);
-        else if (metric_key_original == "Volumetric Proxy (Vp)") values.push_back(data.volumetric_proxy);
-        else values.push_back(0.0);
-    }
+void collectHistoricalMetrics(int plant_id, std::vector<MetricData>& history_data) {
+    TRACE_SPAN("collectHistoricalMetrics", plant_id);
+    history_data.clear();
+    std::vector<MetricRecord> records = readMetricHistory(plant_id);
+    history_data.reserve(records.size());
+    for (const MetricRecord& record : records) history_data.push_back(toMetricData(record));
+}
 
-    if (values.empty()) {
-        std::cerr << "No valid values found for metric: " << metric_key_original << std::endl;
-        return;
-    }
+const int GRAPH_WIDTH = 800;
+const int GRAPH_HEIGHT = 600;
+const int GRAPH_MARGIN_X = 80;
+const int GRAPH_MARGIN_Y = 80;
+const int GRAPH_ATLAS_COLUMNS = 2;
+
+struct MetricGraphSpec {
+    const char* metric_key;
+    const char* title;
+    const char* y_axis_label;
+};
+
+// Order matters: it is the tile order of the atlas image read by index.c.
+const MetricGraphSpec METRIC_GRAPHS[] = {
+    {"Canopy Area (Ac)", "Canopy Area Over Time", "Canopy Area (cm^2)"},
+    {"Color Index (Ihue)", "Color Index Over Time", "Color Index"},
+    {"Height (Hp)", "Plant Height Over Time", "Height (cm)"},
+    {"Width 1 (W1)", "Width 1 Over Time", "Width (cm)"},
+    {"Width 2 (W2)", "Width 2 Over Time", "Width (cm)"},
+    {"Volumetric Proxy (Vp)", "Volumetric Proxy Over Time", "Volume (cm^3)"},
+};
 
+double metricValue(const MetricData& data, const std::string& metric_key_original) {
+    if (metric_key_original == "Canopy Area (Ac)") return data.canopy_area;
+    else if (metric_key_original == "Color Index (Ihue)") return data.color_index;
+    else if (metric_key_original == "Height (Hp)") return data.height_hp;
+    else if (metric_key_original == "Width 1 (W1)") return data.width1;
+    else if (metric_key_original == "Width 2 (W2)") return data.width2;
+    else if (metric_key_original == "Volumetric Proxy (Vp)") return data.volumetric_proxy;
+    return 0.0;
+}
+
+std::string sanitizeMetricKey(const std::string& metric_key_original) {
     std::string sanitized_metric_key = metric_key_original;
     std::replace(sanitized_metric_key.begin(), sanitized_metric_key.end(), ' ', '_');
     std::replace(sanitized_metric_key.begin(), sanitized_metric_key.end(), '(', '_');
@@ -339,19 +1147,75 @@ void plotMetricGraph(int plant_id, const std::vector<MetricData>& history_data,
     if (sanitized_metric_key.back() == '_') {
         sanitized_metric_key.pop_back();
     }
+    return sanitized_metric_key;
+}
+
+// Largest-Triangle-Three-Buckets: keeps the first and last sample and, per bucket, the sample that
+// forms the largest triangle with the previously kept point and the next bucket's average.
+std::vector<size_t> downsampleLTTB(const std::vector<double>& values, size_t threshold) {
+    size_t n = values.size();
+    std::vector<size_t> selected;
+    if (threshold >= n || threshold < 3) {
+        selected.resize(n);
+        for (size_t i = 0; i < n; ++i) selected[i] = i;
+        return selected;
+    }
 
+    selected.reserve(threshold);
+    selected.push_back(0);
+    double bucket_size = static_cast<double>(n - 2) / static_cast<double>(threshold - 2);
+    size_t a = 0;
+    for (size_t bucket = 0; bucket < threshold - 2; ++bucket) {
+        size_t avg_start = static_cast<size_t>((bucket + 1) * bucket_size) + 1;
+        size_t avg_end = std::min(static_cast<size_t>((bucket + 2) * bucket_size) + 1, n);
+        double avg_x = 0.0, avg_y = 0.0;
+        for (size_t j = avg_start; j < avg_end; ++j) {
+            avg_x += static_cast<double>(j);
+            avg_y += values[j];
+        }
+        double avg_count = static_cast<double>(std::max<size_t>(avg_end - avg_start, 1));
+        avg_x /= avg_count;
+        avg_y /= avg_count;
+
+        size_t range_start = static_cast<size_t>(bucket * bucket_size) + 1;
+        size_t range_end = static_cast<size_t>((bucket + 1) * bucket_size) + 1;
+        double max_area = -1.0;
+        size_t next_a = range_start;
+        for (size_t j = range_start; j < range_end; ++j) {
+            double area = std::fabs((static_cast<double>(a) - avg_x) * (values[j] - values[a]) -
+                                    (static_cast<double>(a) - static_cast<double>(j)) * (avg_y - values[a]));
+            if (area > max_area) {
+                max_area = area;
+                next_a = j;
+            }
+        }
+        selected.push_back(next_a);
+        a = next_a;
+    }
+    selected.push_back(n - 1);
+    return selected;
+}
 
-    int graph_width = 800;
-    int graph_height = 600;
-    int margin_x = 80;
-    int margin_y = 80;
-    int plot_width = graph_width - 2 * margin_x;
-    int plot_height = graph_height - 2 * margin_y;
+// Everything that ends up on a graph, in pixel space.
+struct MetricGraphLayout {
+    std::vector<cv::Point> points;
+    std::vector<std::pair<int, std::string>> time_labels;
+    int min_label = 0;
+    int max_label = 0;
+};
 
-    cv::Mat graph_img(graph_height, graph_width, CV_8UC3, cv::Scalar(255, 255, 255));
+bool buildMetricGraphLayout(const std::vector<MetricData>& history_data, const std::string& metric_key_original,
+                            MetricGraphLayout& layout) {
+    std::vector<double> values;
+    values.reserve(history_data.size());
+    for (const auto& data : history_data) values.push_back(metricValue(data, metric_key_original));
+    if (values.empty()) {
+        std::cerr << "No valid values found for metric: " << metric_key_original << std::endl;
+        return false;
+    }
 
-    cv::line(graph_img, cv::Point(margin_x, margin_y), cv::Point(margin_x, graph_height - margin_y), cv::Scalar(0, 0, 0), 2);
-    cv::line(graph_img, cv::Point(margin_x, graph_height - margin_y), cv::Point(graph_width - margin_x, graph_height - margin_y), cv::Scalar(0, 0, 0), 2);
+    int plot_width = GRAPH_WIDTH - 2 * GRAPH_MARGIN_X;
+    int plot_height = GRAPH_HEIGHT - 2 * GRAPH_MARGIN_Y;
 
     double min_val = *std::min_element(values.begin(), values.end());
     double max_val = *std::max_element(values.begin(), values.end());
@@ -360,36 +1224,77 @@ void plotMetricGraph(int plant_id, const std::vector<MetricData>& history_data,
         min_val -= 1.0;
     }
     double y_scale = plot_height / (max_val - min_val);
+    size_t x_divisor = values.size() > 1 ? (values.size() - 1) : 1;
 
-    cv::Point prev_point(-1, -1);
-    for (size_t i = 0; i < values.size(); ++i) {
-        int x = margin_x + static_cast<int>(i * plot_width / (values.size() > 1 ? (values.size() - 1) : 1));
-        int y = graph_height - margin_y - static_cast<int>((values[i] - min_val) * y_scale);
+    layout = MetricGraphLayout();
+    for (size_t i : downsampleLTTB(values, static_cast<size_t>(plot_width))) {
+        int x = GRAPH_MARGIN_X + static_cast<int>(i * plot_width / x_divisor);
+        int y = GRAPH_HEIGHT - GRAPH_MARGIN_Y - static_cast<int>((values[i] - min_val) * y_scale);
+        layout.points.emplace_back(x, y);
+    }
+
+    int label_interval = std::max(1, (int)(values.size() / 5));
+    for (size_t i = 0; i < values.size(); i += label_interval) {
+        int x = GRAPH_MARGIN_X + static_cast<int>(i * plot_width / x_divisor);
+        layout.time_labels.emplace_back(x, history_data[i].timestamp_str.substr(4, 4));
+    }
+    layout.min_label = static_cast<int>(min_val);
+    layout.max_label = static_cast<int>(max_val);
+    return true;
+}
+
+// Draws one graph into an 800x600 BGR image, which may be a tile of the atlas.
+void drawMetricGraph(cv::Mat& graph_img, const MetricGraphLayout& layout, const std::string& graph_title,
+                     const std::string& y_axis_label) {
+    graph_img.setTo(cv::Scalar(255, 255, 255));
 
-        cv::circle(graph_img, cv::Point(x, y), 3, cv::Scalar(255, 0, 0), -1);
+    cv::line(graph_img, cv::Point(GRAPH_MARGIN_X, GRAPH_MARGIN_Y), cv::Point(GRAPH_MARGIN_X, GRAPH_HEIGHT - GRAPH_MARGIN_Y), cv::Scalar(0, 0, 0), 2);
+    cv::line(graph_img, cv::Point(GRAPH_MARGIN_X, GRAPH_HEIGHT - GRAPH_MARGIN_Y), cv::Point(GRAPH_WIDTH - GRAPH_MARGIN_X, GRAPH_HEIGHT - GRAPH_MARGIN_Y), cv::Scalar(0, 0, 0), 2);
 
+    cv::Point prev_point(-1, -1);
+    for (const cv::Point& point : layout.points) {
+        cv::circle(graph_img, point, 3, cv::Scalar(255, 0, 0), -1);
         if (prev_point.x != -1) {
-            cv::line(graph_img, prev_point, cv::Point(x, y), cv::Scalar(0, 0, 255), 1);
+            cv::line(graph_img, prev_point, point, cv::Scalar(0, 0, 255), 1);
         }
-        prev_point = cv::Point(x, y);
+        prev_point = point;
     }
 
-    int label_interval = std::max(1, (int)(values.size() / 5));
-    for (size_t i = 0; i < values.size(); i += label_interval) {
-        int x = margin_x + static_cast<int>(i * plot_width / (values.size() > 1 ? (values.size() - 1) : 1));
-        std::string label_text = history_data[i].timestamp_str.substr(4, 4);
-        cv::putText(graph_img, label_text, cv::Point(x - 15, graph_height - margin_y + 20), cv::FONT_HERSHEY_SIMPLEX, 0.4, cv::Scalar(0, 0, 0), 1);
+    for (const auto& label : layout.time_labels) {
+        cv::putText(graph_img, label.second, cv::Point(label.first - 15, GRAPH_HEIGHT - GRAPH_MARGIN_Y + 20), cv::FONT_HERSHEY_SIMPLEX, 0.4, cv::Scalar(0, 0, 0), 1);
     }
-    cv::putText(graph_img, "Time (YYYYMMDD_HHMMSS)", cv::Point(graph_width / 2 - 50, graph_height - margin_y + 40), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 0, 0), 1);
+    cv::putText(graph_img, "Time (YYYYMMDD_HHMMSS)", cv::Point(GRAPH_WIDTH / 2 - 50, GRAPH_HEIGHT - GRAPH_MARGIN_Y + 40), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 0, 0), 1);
+
+    cv::putText(graph_img, std::to_string(layout.min_label), cv::Point(GRAPH_MARGIN_X - 40, GRAPH_HEIGHT - GRAPH_MARGIN_Y + 5), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 0, 0), 1);
+    cv::putText(graph_img, std::to_string(layout.max_label), cv::Point(GRAPH_MARGIN_X - 40, GRAPH_MARGIN_Y + 5), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 0, 0), 1);
+    cv::putText(graph_img, y_axis_label, cv::Point(10, GRAPH_HEIGHT / 2), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 0, 0), 1);
 
+    cv::putText(graph_img, graph_title, cv::Point(GRAPH_WIDTH / 2 - 100, 30), cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(0, 0, 0), 2);
+}
+
+std::string metricGraphPath(int plant_id, const std::string& metric_key_original) {
+    return IMAGE_BASE_DIR + "plant_" + std::to_string(plant_id) + "_" + sanitizeMetricKey(metric_key_original) + "_graph.png";
+}
+
+std::string metricAtlasPath(int plant_id) {
+    return IMAGE_BASE_DIR + "plant_" + std::to_string(plant_id) + "_metrics_atlas.png";
+}
 
-    cv::putText(graph_img, std::to_string(static_cast<int>(min_val)), cv::Point(margin_x - 40, graph_height - margin_y + 5), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 0, 0), 1);
-    cv::putText(graph_img, std::to_string(static_cast<int>(max_val)), cv::Point(margin_x - 40, margin_y + 5), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 0, 0), 1);
-    cv::putText(graph_img, y_axis_label, cv::Point(10, graph_height / 2), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 0, 0), 1);
+void plotMetricGraph(int plant_id, const std::vector<MetricData>& history_data,
+                     const std::string& metric_key_original, const std::string& graph_title,
+                     const std::string& y_axis_label) {
+    TRACE_SPAN("plotMetricGraph", plant_id);
+    if (history_data.empty()) {
+        std::cerr << "No historical data to plot for " << metric_key_original << " for Plant ID: " << plant_id << std::endl;
+        return;
+    }
 
-    cv::putText(graph_img, graph_title, cv::Point(graph_width / 2 - 100, 30), cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(0, 0, 0), 2);
+    MetricGraphLayout layout;
+    if (!buildMetricGraphLayout(history_data, metric_key_original, layout)) return;
 
-    std::string output_filename = IMAGE_BASE_DIR + "plant_" + std::to_string(plant_id) + "_" + sanitized_metric_key + "_graph.png";
+    std::string output_filename = metricGraphPath(plant_id, metric_key_original);
+    cv::Mat graph_img(GRAPH_HEIGHT, GRAPH_WIDTH, CV_8UC3);
+    drawMetricGraph(graph_img, layout, graph_title, y_axis_label);
     if (cv::imwrite(output_filename, graph_img)) {
         std::cout << "Generated graph image: " << output_filename << std::endl;
     } else {
@@ -397,138 +1302,1204 @@ void plotMetricGraph(int plant_id, const std::vector<MetricData>& history_data,
     }
 }
 
+// Renders all six metric graphs as tiles of one image so a render costs a single PNG encode.
+void plotMetricAtlas(int plant_id, const std::vector<MetricData>& history_data) {
+    TRACE_SPAN("plotMetricAtlas", plant_id);
+    const size_t graph_count = sizeof(METRIC_GRAPHS) / sizeof(METRIC_GRAPHS[0]);
+    const int rows = static_cast<int>((graph_count + GRAPH_ATLAS_COLUMNS - 1) / GRAPH_ATLAS_COLUMNS);
 
-int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <plant_id>" << std::endl;
-        std::cerr << "Example: " << argv[0] << " 1" << std::endl;
-        return 1;
+    std::vector<MetricGraphLayout> layouts(graph_count);
+    for (size_t i = 0; i < graph_count; ++i) {
+        if (!buildMetricGraphLayout(history_data, METRIC_GRAPHS[i].metric_key, layouts[i])) return;
     }
 
-    int plant_id = std::stoi(argv[1]);
-    if (plant_id <= 0) {
-        std::cerr << "Error: Plant ID must be a positive integer." << std::endl;
-        return 1;
+    std::string output_filename = metricAtlasPath(plant_id);
+
+    cv::Mat atlas(rows * GRAPH_HEIGHT, GRAPH_ATLAS_COLUMNS * GRAPH_WIDTH, CV_8UC3);
+    for (size_t i = 0; i < graph_count; ++i) {
+        int col = static_cast<int>(i) % GRAPH_ATLAS_COLUMNS;
+        int row = static_cast<int>(i) / GRAPH_ATLAS_COLUMNS;
+        cv::Mat tile = atlas(cv::Rect(col * GRAPH_WIDTH, row * GRAPH_HEIGHT, GRAPH_WIDTH, GRAPH_HEIGHT));
+        drawMetricGraph(tile, layouts[i], METRIC_GRAPHS[i].title, METRIC_GRAPHS[i].y_axis_label);
+    }
+    if (cv::imwrite(output_filename, atlas)) {
+        std::cout << "Generated graph atlas: " << output_filename << std::endl;
+    } else {
+        std::cerr << "Error: Could not save graph atlas: " << output_filename << std::endl;
     }
+}
+
+// PLANT_MONITOR_GRAPH_ATLAS=1 switches from six graph PNGs to one atlas per plant.
+bool graphAtlasEnabled() {
+    const char* value = std::getenv("PLANT_MONITOR_GRAPH_ATLAS");
+    return value && std::strcmp(value, "1") == 0;
+}
+
+void plotMetricGraphs(int plant_id, const std::vector<MetricData>& history_data) {
+    TRACE_SPAN("plotMetricGraphs", plant_id);
+    std::error_code ec;
+    if (graphAtlasEnabled()) {
+        plotMetricAtlas(plant_id, history_data);
+        for (const MetricGraphSpec& spec : METRIC_GRAPHS) {
+            fs::remove(metricGraphPath(plant_id, spec.metric_key), ec);
+        }
+    } else {
+        for (const MetricGraphSpec& spec : METRIC_GRAPHS) {
+            plotMetricGraph(plant_id, history_data, spec.metric_key, spec.title, spec.y_axis_label);
+        }
+        fs::remove(metricAtlasPath(plant_id), ec);
+    }
+}
 
-    auto now = std::chrono::system_clock::now();
-    std::time_t current_time_t = std::chrono::system_clock::to_time_t(now);
-    std::tm* local_tm = std::localtime(&current_time_t);
-    std::stringstream ss;
-    ss << std::put_time(local_tm, "%Y%m%d_%H%M%S");
-    std::string timestamp_str = ss.str();
 
+bool ensureImageDirectory() {
     if (!fs::exists(IMAGE_BASE_DIR)) {
         if (fs::create_directories(IMAGE_BASE_DIR)) {
             std::cout << "Created directory: " << IMAGE_BASE_DIR << std::endl;
         } else {
             std::cerr << "Error: Could not create directory " << IMAGE_BASE_DIR << std::endl;
-            return 1;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Small fixed-size worker pool for the per-view work of a plant. A thread waiting on a task
+// runs queued tasks itself, so tasks can wait on subtasks without starving the pool.
+class TaskPool {
+public:
+    explicit TaskPool(unsigned thread_count) {
+        for (unsigned i = 0; i < thread_count; ++i) workers_.emplace_back([this] { workerLoop(); });
+    }
+    ~TaskPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (std::thread& worker : workers_) worker.join();
+    }
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    std::future<void> submit(std::function<void()> task) {
+        auto packaged = std::make_shared<std::packaged_task<void()>>(std::move(task));
+        std::future<void> future = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.emplace_back([packaged] { (*packaged)(); });
         }
+        cv_.notify_one();
+        return future;
+    }
+
+    void wait(std::future<void>& future) {
+        while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            if (!runPendingTask()) future.wait_for(std::chrono::milliseconds(1));
+        }
+        future.get();
+    }
+
+private:
+    bool runPendingTask() {
+        std::function<void()> task;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (queue_.empty()) return false;
+            task = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        task();
+        return true;
+    }
+
+    void workerLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+                if (queue_.empty()) return;
+                task = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> queue_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+};
+
+TaskPool& viewTaskPool() {
+    static TaskPool pool(std::max(1u, std::min(3u, std::thread::hardware_concurrency())));
+    return pool;
+}
+
+// Set on batch workers while the batch runs more than one of them: the workers already fill the
+// cores, so their view tasks run inline instead of adding the view pool's threads on top.
+thread_local bool run_view_tasks_inline = false;
+
+// Runs the tasks concurrently and joins them in submission order. Every task is joined before the
+// first failure is rethrown, since tasks usually reference the caller's stack.
+void runTasksInParallel(const std::vector<std::function<void()>>& tasks) {
+    if (run_view_tasks_inline) {
+        std::exception_ptr first_error;
+        for (const auto& task : tasks) {
+            try {
+                task();
+            } catch (...) {
+                if (!first_error) first_error = std::current_exception();
+            }
+        }
+        if (first_error) std::rethrow_exception(first_error);
+        return;
+    }
+
+    TaskPool& pool = viewTaskPool();
+    std::vector<std::future<void>> futures;
+    futures.reserve(tasks.size());
+    for (const auto& task : tasks) futures.push_back(pool.submit(task));
+
+    std::exception_ptr first_error;
+    for (auto& future : futures) {
+        try {
+            pool.wait(future);
+        } catch (...) {
+            if (!first_error) first_error = std::current_exception();
+        }
+    }
+    if (first_error) std::rethrow_exception(first_error);
+}
+
+// The three camera views of a plant. X and Z are the side cameras, Y looks down on the canopy.
+enum ViewIndex { VIEW_X = 0, VIEW_Y = 1, VIEW_Z = 2, VIEW_COUNT = 3 };
+
+struct ViewSpec {
+    char position;
+    cv::Scalar placeholder_color;
+    const char* artifact_key;
+    const char* artifact_label;
+};
+
+const ViewSpec VIEW_SPECS[VIEW_COUNT] = {
+    {'X', cv::Scalar(100, 100, 200), "side1", "Side 1"},
+    {'Y', cv::Scalar(100, 200, 100), "top", "Top"},
+    {'Z', cv::Scalar(200, 100, 100), "side2", "Side 2"},
+};
+
+// Camera JPEGs handed over in memory by application.c (memfds passed with SCM_RIGHTS), so a
+// fetched frame is decoded straight from RAM instead of round-tripping through the SD card.
+// Views whose camera did not deliver are flagged as missing and get a cached placeholder; any
+// other view is read from disk as before.
+using EncodedFrame = std::shared_ptr<MappedFile>;
+using EncodedViews = std::array<EncodedFrame, VIEW_COUNT>;
+
+struct PlantFrames {
+    EncodedViews encoded;
+    std::array<bool, VIEW_COUNT> missing{};
+};
+using FrameHandoff = std::map<int, PlantFrames>;
+
+int viewForPosition(char position) {
+    for (int view = 0; view < VIEW_COUNT; ++view) {
+        if (VIEW_SPECS[view].position == position) return view;
+    }
+    return -1;
+}
+
+std::string viewCapturePath(const std::string& plant_id_str, int view) {
+    return IMAGE_BASE_DIR + "plant_" + plant_id_str + "_initial_" + VIEW_SPECS[view].position + ".jpg";
+}
+
+TaskPool& frameWriterPool() {
+    static TaskPool pool(1);
+    return pool;
+}
+
+// Atomically replaces a view's capture file, which the dashboard shows.
+void writeCaptureFile(int plant_id, int view, const uint8_t* data, size_t size) {
+    TRACE_SPAN("writeCaptureFile", plant_id);
+    std::string path = viewCapturePath(std::to_string(plant_id), view);
+    std::string tmp_path = path + ".tmp";
+    int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool ok = fd >= 0 && writeAll(fd, data, size);
+    if (fd >= 0 && close(fd) != 0) ok = false;
+    if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "Warning: Could not write " << path << ": " << std::strerror(errno) << std::endl;
+        unlink(tmp_path.c_str());
     }
+}
+
+// Writes the dashboard's on-disk copy of a handed-over frame on a background thread. Nobody waits
+// for it: processing uses the in-memory bytes.
+void persistFrameAsync(int plant_id, int view, const EncodedFrame& frame) {
+    frameWriterPool().submit([plant_id, view, frame] { writeCaptureFile(plant_id, view, frame->data(), frame->size()); });
+}
 
+cv::Mat makePlaceholderView(int view, int img_width, int img_height) {
+    const ViewSpec& spec = VIEW_SPECS[view];
+    cv::Mat placeholder(img_height, img_width, CV_8UC3, spec.placeholder_color);
+    cv::putText(placeholder, std::string("No ") + spec.position + " Input", cv::Point(10, img_height / 2), cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255, 255, 255), 2);
+    return placeholder;
+}
+
+// Placeholders for views whose camera is offline, built once per (plant, view) and frame size and
+// shared read-only across cycles. Each is written to the view's capture file once so the dashboard
+// shows it; a real frame arriving for that view re-arms the write (see notePlaceholderReplaced).
+struct PlaceholderEntry {
+    cv::Mat image;
+    bool on_disk = false;
+};
+
+std::mutex placeholder_mutex;
+std::map<std::pair<int, int>, PlaceholderEntry> placeholder_cache;
+
+cv::Mat cachedPlaceholderView(int plant_id, int view, int img_width, int img_height) {
+    std::lock_guard<std::mutex> lock(placeholder_mutex);
+    PlaceholderEntry& entry = placeholder_cache[{plant_id, view}];
+    if (entry.image.cols != img_width || entry.image.rows != img_height) {
+        entry.image = makePlaceholderView(view, img_width, img_height);
+        entry.on_disk = false;
+    }
+    if (!entry.on_disk) {
+        entry.on_disk = true;
+        cv::Mat image = entry.image;
+        frameWriterPool().submit([plant_id, view, image] {
+            std::vector<uchar> jpeg;
+            if (cv::imencode(".jpg", image, jpeg)) writeCaptureFile(plant_id, view, jpeg.data(), jpeg.size());
+        });
+    }
+    return entry.image;
+}
+
+void notePlaceholderReplaced(int plant_id, int view) {
+    std::lock_guard<std::mutex> lock(placeholder_mutex);
+    auto found = placeholder_cache.find({plant_id, view});
+    if (found != placeholder_cache.end()) found->second.on_disk = false;
+}
+
+void forEachViewInParallel(const std::function<void(int)>& view_task) {
+    std::vector<std::function<void()>> tasks;
+    for (int view = 0; view < VIEW_COUNT; ++view) tasks.push_back([&view_task, view] { view_task(view); });
+    runTasksInParallel(tasks);
+}
+
+// Substitutes a placeholder for a missing view and resizes present ones to the common size.
+void normalizeView(cv::Mat& view_img, int view, int plant_id, bool camera_offline, int img_width, int img_height) {
+    TRACE_SPAN("normalizeView");
+    const ViewSpec& spec = VIEW_SPECS[view];
+    if (camera_offline) {
+        view_img = cachedPlaceholderView(plant_id, view, img_width, img_height);
+    } else if (view_img.empty()) {
+        std::cerr << "Warning: plant_" << plant_id << "_initial_" << spec.position << ".jpg not found or could not be read. Generating placeholder for " << spec.position << "-axis input." << std::endl;
+        view_img = makePlaceholderView(view, img_width, img_height);
+    } else if (view_img.cols != img_width || view_img.rows != img_height) {
+        cv::resize(view_img, view_img, cv::Size(img_width, img_height));
+    }
+}
+
+// Loads the three camera views of a plant (from handed-over frames where available, otherwise
+// from disk), substituting placeholders for missing ones and resizing them all to the size of
+// the first available view. Decoding and resizing run per view in parallel; the common size is
+// picked between the two phases. Views flagged missing are neither decoded nor read.
+void loadPlantViews(int plant_id, cv::Mat (&views)[VIEW_COUNT], int& img_width, int& img_height,
+                    const PlantFrames* frames = nullptr) {
     std::string plant_id_str = std::to_string(plant_id);
-    int img_width = 200;
-    int img_height = 200;
-
-    cv::Mat initial_x_img = cv::imread(IMAGE_BASE_DIR + "plant_" + plant_id_str + "_initial_X.jpg");
-    cv::Mat initial_y_img = cv::imread(IMAGE_BASE_DIR + "plant_" + plant_id_str + "_initial_Y.jpg");
-    cv::Mat initial_z_img = cv::imread(IMAGE_BASE_DIR + "plant_" + plant_id_str + "_initial_Z.jpg");
-
-    if (!initial_x_img.empty()) {
-        img_width = initial_x_img.cols;
-        img_height = initial_x_img.rows;
-    } else if (!initial_y_img.empty()) {
-        img_width = initial_y_img.cols;
-        img_height = initial_y_img.rows;
-    } else if (!initial_z_img.empty()) {
-        img_width = initial_z_img.cols;
-        img_height = initial_z_img.rows;
-    }
-
-    if (initial_x_img.empty()) {
-        std::cerr << "Warning: plant_" << plant_id_str << "_initial_X.jpg not found or could not be read. Generating placeholder for X-axis input." << std::endl;
-        initial_x_img = cv::Mat(img_height, img_width, CV_8UC3, cv::Scalar(100, 100, 200));
-        cv::putText(initial_x_img, "No X Input", cv::Point(10, img_height / 2), cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255, 255, 255), 2);
-    } else {
-        if (initial_x_img.cols != img_width || initial_x_img.rows != img_height) {
-            cv::resize(initial_x_img, initial_x_img, cv::Size(img_width, img_height));
+    forEachViewInParallel([&](int view) {
+        if (frames && frames->missing[view]) return;
+        const EncodedFrame* frame = frames && frames->encoded[view] && frames->encoded[view]->data() ? &frames->encoded[view] : nullptr;
+        if (frame) {
+            TRACE_SPAN("imdecode");
+            cv::Mat bytes(1, static_cast<int>((*frame)->size()), CV_8UC1, const_cast<uint8_t*>((*frame)->data()));
+            views[view] = cv::imdecode(bytes, cv::IMREAD_COLOR);
+        } else {
+            TRACE_SPAN("imread");
+            views[view] = cv::imread(viewCapturePath(plant_id_str, view));
+        }
+    });
+
+    img_width = 200;
+    img_height = 200;
+    for (const cv::Mat& view_img : views) {
+        if (!view_img.empty()) {
+            img_width = view_img.cols;
+            img_height = view_img.rows;
+            break;
         }
     }
-    if (initial_y_img.empty()) {
-        std::cerr << "Warning: plant_" << plant_id_str << "_initial_Y.jpg not found or could not be read. Generating placeholder for Y-axis input." << std::endl;
-        initial_y_img = cv::Mat(img_height, img_width, CV_8UC3, cv::Scalar(100, 200, 100));
-        cv::putText(initial_y_img, "No Y Input", cv::Point(10, img_height / 2), cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255, 255, 255), 2);
-    } else {
-        if (initial_y_img.cols != img_width || initial_y_img.rows != img_height) {
-            cv::resize(initial_y_img, initial_y_img, cv::Size(img_width, img_height));
+
+    forEachViewInParallel([&](int view) {
+        normalizeView(views[view], view, plant_id, frames && frames->missing[view], img_width, img_height);
+    });
+}
+
+std::string artifactStampPath(int plant_id) {
+    return IMAGE_BASE_DIR + "plant_" + std::to_string(plant_id) + "_artifacts.stamp";
+}
+
+void saveViewArtifacts(const cv::Mat& view_img, const std::string& plant_id_str, const std::string& view_key, const std::string& view_label) {
+    TRACE_SPAN("saveViewArtifacts");
+    cv::Mat green_filtered_img;
+    segmentGreenCanopy(view_img, green_filtered_img);
+    saveImage(processImageToMask(view_img), "plant_" + plant_id_str + "_" + view_key + "_mask.jpg", view_label + " Mask (Processed)");
+    saveImage(processToGrayscale(view_img), "plant_" + plant_id_str + "_" + view_key + "_grayscale.jpg", view_label + " Grayscale");
+    saveImage(processToEdges(view_img), "plant_" + plant_id_str + "_" + view_key + "_edges.jpg", view_label + " Edges");
+    saveImage(processToGreenChannel(view_img), "plant_" + plant_id_str + "_" + view_key + "_green.jpg", view_label + " Green Ch.");
+    saveImage(green_filtered_img, "plant_" + plant_id_str + "_" + view_key + "_green_filtered.jpg", view_label + " Green Filtered");
+}
+
+// Renders the diagnostic views and metric graphs shown on the plant detail page. Called on demand
+// by index.cgi rather than on every capture cycle; returns early while the cached artifacts are
+// still current (see plant_artifacts_fresh). The stamp records the captures and the metric series
+// as they were before loading them.
+int renderDiagnosticArtifacts(int plant_id) {
+    TRACE_SPAN("renderDiagnosticArtifacts", plant_id);
+    char signature[PLANT_ARTIFACT_SIGNATURE_SIZE];
+    plant_artifacts_signature(IMAGE_BASE_DIR.c_str(), plant_id, signature, sizeof(signature));
+    if (plant_artifacts_fresh(IMAGE_BASE_DIR.c_str(), plant_id)) {
+        std::cout << "Diagnostic artifacts are current for Plant ID: " << plant_id << std::endl;
+        return 0;
+    }
+    if (!ensureImageDirectory()) return 1;
+
+    std::string plant_id_str = std::to_string(plant_id);
+    cv::Mat views[VIEW_COUNT];
+    int img_width, img_height;
+    loadPlantViews(plant_id, views, img_width, img_height);
+
+    std::vector<std::function<void()>> tasks;
+    for (int view : {VIEW_Y, VIEW_X, VIEW_Z}) {
+        tasks.push_back([&, view] {
+            saveViewArtifacts(views[view], plant_id_str, VIEW_SPECS[view].artifact_key, VIEW_SPECS[view].artifact_label);
+        });
+    }
+    tasks.push_back([&] {
+        saveImage(generateSimulated3DRender(views[VIEW_X], views[VIEW_Y], views[VIEW_Z], img_width, img_height),
+                  "plant_" + plant_id_str + "_3d_render.png", "");
+    });
+    tasks.push_back([plant_id] {
+        std::vector<MetricData> history_data;
+        collectHistoricalMetrics(plant_id, history_data);
+        if (!history_data.empty()) {
+            plotMetricGraphs(plant_id, history_data);
+        } else {
+            std::cerr << "Not enough historical data to generate graphs for Plant ID: " << plant_id << std::endl;
         }
+    });
+    runTasksInParallel(tasks);
+
+    std::ofstream stamp(artifactStampPath(plant_id), std::ios::trunc);
+    stamp << signature;
+    if (!stamp.good()) {
+        std::cerr << "Warning: Could not write artifact stamp for Plant ID: " << plant_id << std::endl;
     }
-    if (initial_z_img.empty()) {
-        std::cerr << "Warning: plant_" << plant_id_str << "_initial_Z.jpg not found or could not be read. Generating placeholder for Z-axis input." << std::endl;
-        initial_z_img = cv::Mat(img_height, img_width, CV_8UC3, cv::Scalar(200, 100, 100));
-        cv::putText(initial_z_img, "No Z Input", cv::Point(10, img_height / 2), cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255, 255, 255), 2);
-    } else {
-        if (initial_z_img.cols != img_width || initial_z_img.rows != img_height) {
-            cv::resize(initial_z_img, initial_z_img, cv::Size(img_width, img_height));
-        }
-    }
-
-    cv::Mat top_green_filtered_img = processGreenThreshold(initial_y_img);
-    saveImage(processImageToMask(initial_y_img), "plant_" + plant_id_str + "_top_mask.jpg", "Top Mask (Processed)");
-    saveImage(processToGrayscale(initial_y_img), "plant_" + plant_id_str + "_top_grayscale.jpg", "Top Grayscale");
-    saveImage(processToEdges(initial_y_img), "plant_" + plant_id_str + "_top_edges.jpg", "Top Edges");
-    saveImage(processToGreenChannel(initial_y_img), "plant_" + plant_id_str + "_top_green.jpg", "Top Green Ch.");
-    saveImage(top_green_filtered_img, "plant_" + plant_id_str + "_top_green_filtered.jpg", "Top Green Filtered");
-
-    cv::Mat side1_green_filtered_img = processGreenThreshold(initial_x_img);
-    saveImage(processImageToMask(initial_x_img), "plant_" + plant_id_str + "_side1_mask.jpg", "Side 1 Mask (Processed)");
-    saveImage(processToGrayscale(initial_x_img), "plant_" + plant_id_str + "_side1_grayscale.jpg", "Side 1 Grayscale");
-    saveImage(processToEdges(initial_x_img), "plant_" + plant_id_str + "_side1_edges.jpg", "Side 1 Edges");
-    saveImage(processToGreenChannel(initial_x_img), "plant_" + plant_id_str + "_side1_green.jpg", "Side 1 Green Ch.");
-    saveImage(side1_green_filtered_img, "plant_" + plant_id_str + "_side1_green_filtered.jpg", "Side 1 Green Filtered");
-    
-    cv::Mat side2_green_filtered_img = processGreenThreshold(initial_z_img);
-    saveImage(processImageToMask(initial_z_img), "plant_" + plant_id_str + "_side2_mask.jpg", "Side 2 Mask (Processed)");
-    saveImage(processToGrayscale(initial_z_img), "plant_" + plant_id_str + "_side2_grayscale.jpg", "Side 2 Grayscale");
-    saveImage(processToEdges(initial_z_img), "plant_" + plant_id_str + "_side2_edges.jpg", "Side 2 Edges");
-    saveImage(processToGreenChannel(initial_z_img), "plant_" + plant_id_str + "_side2_green.jpg", "Side 2 Green Ch.");
-    saveImage(side2_green_filtered_img, "plant_" + plant_id_str + "_side2_green_filtered.jpg", "Side 2 Green Filtered");
-
-    saveImage(generateSimulated3DRender(initial_x_img, initial_y_img, initial_z_img, img_width, img_height),
-              "plant_" + plant_id_str + "_3d_render.png", "");
-
-    double canopy_area = calculateBinaryArea(top_green_filtered_img) * PIXEL_AREA_TO_CM2_RATIO;
-    double color_index = calculateMeanHueInMask(initial_y_img, top_green_filtered_img);
-
-    double height_hp = 0.0, width1 = 0.0, width2 = 0.0;
-    getBoundingBoxDimensions(side1_green_filtered_img, height_hp, width1);
+    return 0;
+}
+
+// Per-view segmentation results; X and Z also carry the bounding box of their largest blob.
+// green_mask is always frame-sized. For side views tracked by ROI it is zero outside the ROI and
+// canopy_stats count only the ROI, which the sampled outside check in analyzeSideView backs.
+struct ViewAnalysis {
+    cv::Mat green_mask;
+    GreenCanopyStats canopy_stats;
+    double bbox_height = 0.0;
+    double bbox_width = 0.0;
+    double processed_fraction = 1.0;
+};
+
+// ROI tracking for the side views. Plants move little between captures, so a side view is
+// segmented and contoured only inside a padded box around the previous run's largest blob. The
+// run falls back to the full frame when a blob touches an interior edge of the ROI, the green
+// pixel count inside the ROI moves by more than ROI_MAX_COVERAGE_CHANGE, or ROI_MAX_REUSE runs
+// have passed since the last full-frame pass (to pick up growth elsewhere in the frame). It also
+// falls back when green turns up on a ROI_OUTSIDE_GRID_STEP grid sampled outside the ROI; only
+// blobs thinner than the step that fit between grid rows or columns go unnoticed until then.
+// The top view always runs full-frame: canopy area counts every green pixel in the frame.
+const double ROI_PADDING_RATIO = 0.25;
+const int ROI_MIN_PADDING = 16;
+const double ROI_MAX_COVERAGE_CHANGE = 0.3;
+const int ROI_MAX_REUSE = 24;
+const int ROI_OUTSIDE_GRID_STEP = 4;
+
+struct ViewRoi {
+    cv::Rect box;              // largest blob on the last run, full-frame coordinates
+    cv::Size frame;            // frame size the box refers to
+    uint64_t roi_pixels = 0;   // green pixels in the ROI processed on the last run
+    int reuse_count = 0;       // ROI-only runs since the last full-frame pass
+};
+
+std::string roiStatePath(int plant_id) {
+    return IMAGE_BASE_DIR + "plant_" + std::to_string(plant_id) + "_roi.state";
+}
+
+void loadViewRois(int plant_id, ViewRoi (&rois)[VIEW_COUNT]) {
+    std::ifstream infile(roiStatePath(plant_id));
+    char position;
+    ViewRoi roi;
+    while (infile >> position >> roi.box.x >> roi.box.y >> roi.box.width >> roi.box.height
+                  >> roi.frame.width >> roi.frame.height >> roi.roi_pixels >> roi.reuse_count) {
+        for (int view = 0; view < VIEW_COUNT; ++view) {
+            if (VIEW_SPECS[view].position == position) rois[view] = roi;
+        }
+    }
+}
+
+void saveViewRois(int plant_id, const ViewRoi (&rois)[VIEW_COUNT]) {
+    std::ofstream outfile(roiStatePath(plant_id), std::ios::trunc);
+    for (int view = 0; view < VIEW_COUNT; ++view) {
+        const ViewRoi& roi = rois[view];
+        if (roi.box.area() == 0) continue;
+        outfile << VIEW_SPECS[view].position << " " << roi.box.x << " " << roi.box.y << " " << roi.box.width << " "
+                << roi.box.height << " " << roi.frame.width << " " << roi.frame.height << " " << roi.roi_pixels << " "
+                << roi.reuse_count << "\n";
+    }
+}
+
+cv::Rect paddedRoi(const cv::Rect& box, const cv::Size& frame) {
+    int pad_x = std::max(ROI_MIN_PADDING, static_cast<int>(box.width * ROI_PADDING_RATIO));
+    int pad_y = std::max(ROI_MIN_PADDING, static_cast<int>(box.height * ROI_PADDING_RATIO));
+    cv::Rect padded(box.x - pad_x, box.y - pad_y, box.width + 2 * pad_x, box.height + 2 * pad_y);
+    return padded & cv::Rect(0, 0, frame.width, frame.height);
+}
+
+// Classifies every ROI_OUTSIDE_GRID_STEP-th pixel of every ROI_OUTSIDE_GRID_STEP-th row outside
+// the crop; about 1/16 of those pixels at the scalar path's cost.
+bool greenOutsideRoi(const cv::Mat& view_img, const cv::Rect& crop) {
+    TRACE_SPAN("greenOutsideRoi");
+    for (int y = 0; y < view_img.rows; y += ROI_OUTSIDE_GRID_STEP) {
+        const uchar* row = view_img.ptr<uchar>(y);
+        bool crop_row = y >= crop.y && y < crop.br().y;
+        for (int x = 0; x < view_img.cols; x += ROI_OUTSIDE_GRID_STEP) {
+            if (crop_row && x >= crop.x && x < crop.br().x) {
+                x = (crop.br().x - 1) / ROI_OUTSIDE_GRID_STEP * ROI_OUTSIDE_GRID_STEP;
+                continue;
+            }
+            int hue;
+            if (classifyGreenPixel(row[x * 3], row[x * 3 + 1], row[x * 3 + 2], hue)) return true;
+        }
+    }
+    return false;
+}
+
+// Segments a side view and measures its largest blob, inside the tracked ROI when possible.
+// When the ROI is accepted every blob in it is complete, so its contours (translated) are the
+// ones full-frame processing would find there.
+void analyzeSideView(const cv::Mat& view_img, ViewRoi& roi, ViewAnalysis& analysis) {
+    TRACE_SPAN("analyzeSideView");
+    bool roi_usable = !view_img.empty() && view_img.type() == CV_8UC3 && roi.box.area() > 0 &&
+                      roi.frame.width == view_img.cols && roi.frame.height == view_img.rows && roi.reuse_count < ROI_MAX_REUSE;
+
+    if (roi_usable) {
+        cv::Rect crop = paddedRoi(roi.box, view_img.size());
+        cv::Mat crop_mask;
+        GreenCanopyStats crop_stats = segmentGreenCanopy(view_img(crop), crop_mask);
+
+        cv::Rect box = largestBlobBoundingBox(crop_mask);
+        // A blob can only extend past the ROI through a green pixel on one of its edges. Edges
+        // that coincide with the frame edge are the same for full-frame processing.
+        cv::Rect interior(crop.x > 0 ? 1 : 0, crop.y > 0 ? 1 : 0, 0, 0);
+        interior.width = std::max(0, crop.width - interior.x - (crop.br().x < view_img.cols ? 1 : 0));
+        interior.height = std::max(0, crop.height - interior.y - (crop.br().y < view_img.rows ? 1 : 0));
+        bool cut_off = interior.area() == 0 ||
+                       static_cast<uint64_t>(cv::countNonZero(crop_mask(interior))) != crop_stats.pixel_count;
+        double previous = static_cast<double>(roi.roi_pixels);
+        bool coverage_stable = previous > 0 && std::fabs(static_cast<double>(crop_stats.pixel_count) - previous) <= ROI_MAX_COVERAGE_CHANGE * previous;
+
+        if (box.area() > 0 && !cut_off && coverage_stable && !greenOutsideRoi(view_img, crop)) {
+            roi.box = cv::Rect(box.x + crop.x, box.y + crop.y, box.width, box.height);
+            roi.roi_pixels = crop_stats.pixel_count;
+            ++roi.reuse_count;
+            analysis.green_mask = cv::Mat(view_img.size(), CV_8UC1, cv::Scalar(0));
+            cv::Mat mask_roi = analysis.green_mask(crop);
+            crop_mask.copyTo(mask_roi);
+            analysis.canopy_stats = crop_stats;
+            analysis.bbox_height = box.height;
+            analysis.bbox_width = box.width;
+            analysis.processed_fraction = static_cast<double>(crop.area()) / view_img.total();
+            return;
+        }
+    }
+
+    analysis.canopy_stats = segmentGreenCanopy(view_img, analysis.green_mask);
+    analysis.processed_fraction = 1.0;
+    analysis.bbox_height = 0.0;
+    analysis.bbox_width = 0.0;
+    roi = ViewRoi();
+    if (analysis.green_mask.empty() || analysis.green_mask.type() != CV_8UC1) {
+        std::cerr << "Warning: Invalid binary mask for bounding box calculation." << std::endl;
+        return;
+    }
+
+    cv::Rect box = largestBlobBoundingBox(analysis.green_mask);
+    analysis.bbox_height = box.height;
+    analysis.bbox_width = box.width;
+    if (box.area() > 0) {
+        roi.box = box;
+        roi.frame = analysis.green_mask.size();
+        roi.roi_pixels = static_cast<uint64_t>(cv::countNonZero(analysis.green_mask(paddedRoi(box, roi.frame))));
+    }
+}
+
+// Computes and records the plant metrics. Diagnostic images and metric graphs are left to
+// renderDiagnosticArtifacts.
+int processPlant(int plant_id, const PlantFrames* frames = nullptr) {
+    TRACE_SPAN("processPlant", plant_id);
+    auto now = std::chrono::system_clock::now();
+    std::time_t current_time_t = std::chrono::system_clock::to_time_t(now);
+
+    if (!ensureImageDirectory()) return 1;
+
+    std::string plant_id_str = std::to_string(plant_id);
+    cv::Mat views[VIEW_COUNT];
+    int img_width, img_height;
+    loadPlantViews(plant_id, views, img_width, img_height, frames);
+    // The capture files themselves are the cameras' JPEG bytes; their variants come from the
+    // decoded views, queued behind the capture writes on the same background thread. A capture
+    // that was not rewritten this cycle (an offline camera's placeholder already on disk) keeps
+    // its variants.
+    for (int view = 0; view < VIEW_COUNT; ++view) {
+        cv::Mat view_img = views[view];
+        std::string filename = "plant_" + plant_id_str + "_initial_" + VIEW_SPECS[view].position + ".jpg";
+        frameWriterPool().submit([view_img, filename] {
+            if (!imageVariantsCurrent(filename)) saveImageVariants(view_img, filename);
+        });
+    }
+
+    ViewAnalysis analysis[VIEW_COUNT];
+    ViewRoi rois[VIEW_COUNT];
+    loadViewRois(plant_id, rois);
+    forEachViewInParallel([&](int view) {
+        if (view == VIEW_Y) {
+            analysis[view].canopy_stats = segmentGreenCanopy(views[view], analysis[view].green_mask);
+        } else {
+            analyzeSideView(views[view], rois[view], analysis[view]);
+        }
+    });
+    saveViewRois(plant_id, rois);
+    std::cout << "Processed " << std::fixed << std::setprecision(0)
+              << (analysis[VIEW_X].processed_fraction + analysis[VIEW_Y].processed_fraction + analysis[VIEW_Z].processed_fraction) * 100.0 / VIEW_COUNT
+              << "% of view pixels for Plant ID: " << plant_id << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+
+    const GreenCanopyStats& top_canopy_stats = analysis[VIEW_Y].canopy_stats;
+    double canopy_area = static_cast<double>(top_canopy_stats.pixel_count) * PIXEL_AREA_TO_CM2_RATIO;
+    double color_index = top_canopy_stats.meanHue();
+
+    double height_hp = analysis[VIEW_X].bbox_height, width1 = analysis[VIEW_X].bbox_width, width2 = 0.0;
     height_hp *= PIXEL_TO_CM_RATIO;
     width1 *= PIXEL_TO_CM_RATIO;
 
-    getBoundingBoxDimensions(side2_green_filtered_img, height_hp, width2);
-    width2 *= PIXEL_TO_CM_RATIO;
+    height_hp = analysis[VIEW_Z].bbox_height;
+    width2 = analysis[VIEW_Z].bbox_width * PIXEL_TO_CM_RATIO;
 
     double volumetric_proxy = canopy_area * height_hp * 0.5;
 
-    writePlantMetricsToFile(plant_id, canopy_area, color_index, height_hp, width1, width2, volumetric_proxy, timestamp_str);
+    importLegacyMetrics(plant_id);
+    writePlantMetricsToFile(plant_id, canopy_area, color_index, height_hp, width1, width2, volumetric_proxy, current_time_t);
 
-    std::vector<MetricData> history_data;
-    collectHistoricalMetrics(plant_id, history_data);
+    std::cout << "Image generation complete for Plant ID: " << plant_id << std::endl;
 
-    if (!history_data.empty()) {
-        std::cout << "Generating historical graphs for Plant ID: " << plant_id << std::endl;
-        plotMetricGraph(plant_id, history_data, "Canopy Area (Ac)", "Canopy Area Over Time", "Canopy Area (cm^2)");
-        plotMetricGraph(plant_id, history_data, "Color Index (Ihue)", "Color Index Over Time", "Color Index");
-        plotMetricGraph(plant_id, history_data, "Height (Hp)", "Plant Height Over Time", "Height (cm)");
-        plotMetricGraph(plant_id, history_data, "Width 1 (W1)", "Width 1 Over Time", "Width (cm)");
-        plotMetricGraph(plant_id, history_data, "Width 2 (W2)", "Width 2 Over Time", "Width (cm)");
-        plotMetricGraph(plant_id, history_data, "Volumetric Proxy (Vp)", "Volumetric Proxy Over Time", "Volume (cm^3)");
-    } else {
-        std::cerr << "Not enough historical data to generate graphs for Plant ID: " << plant_id << std::endl;
+    return 0;
+}
+
+// Plant IDs are line numbers in plants.txt, so "all" expands to 1..<number of plants>.
+int countConfiguredPlants() {
+    std::ifstream file(PLANTS_FILE);
+    if (!file.is_open()) {
+        std::cerr << "Warning: Could not open " << PLANTS_FILE << std::endl;
+        return 0;
     }
+    int count = 0;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line != "\r") ++count;
+    }
+    return count;
+}
+
+// Parses "all" or a comma-separated list of IDs and ranges such as "1,3,5-8" into ascending,
+// de-duplicated plant IDs.
+bool parsePlantIdList(const std::string& spec, std::vector<int>& plant_ids) {
+    plant_ids.clear();
+    if (spec == "all") {
+        int count = countConfiguredPlants();
+        for (int plant_id = 1; plant_id <= count; ++plant_id) plant_ids.push_back(plant_id);
+        return true;
+    }
+
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        char* endptr = nullptr;
+        long first = std::strtol(item.c_str(), &endptr, 10);
+        long last = first;
+        if (*endptr == '-') {
+            const char* last_str = endptr + 1;
+            last = std::strtol(last_str, &endptr, 10);
+            if (endptr == last_str) return false;
+        }
+        if (endptr == item.c_str() || *endptr != '\0' || first <= 0 || last < first || last > 100000) return false;
+        for (long plant_id = first; plant_id <= last; ++plant_id) plant_ids.push_back(static_cast<int>(plant_id));
+    }
+    std::sort(plant_ids.begin(), plant_ids.end());
+    plant_ids.erase(std::unique(plant_ids.begin(), plant_ids.end()), plant_ids.end());
+    return !plant_ids.empty();
+}
+
+// Work-stealing scheduler for batch runs. Each worker owns a deque seeded round-robin, takes its
+// own work from the back and steals from the front of the others once it runs dry, so workers
+// that drew placeholder-only plants pick up the slow ones queued behind another worker.
+class WorkStealingScheduler {
+public:
+    explicit WorkStealingScheduler(unsigned worker_count) : queues_(std::max(1u, worker_count)) {}
+
+    void seed(size_t item_count) {
+        for (size_t i = 0; i < item_count; ++i) queues_[i % queues_.size()].items.push_back(i);
+    }
+
+    void run(const std::function<void(size_t, unsigned)>& work) {
+        std::vector<std::thread> threads;
+        for (unsigned worker = 1; worker < queues_.size(); ++worker) {
+            threads.emplace_back([this, &work, worker] { workerLoop(worker, work); });
+        }
+        workerLoop(0, work);
+        for (std::thread& thread : threads) thread.join();
+    }
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<size_t> items;
+    };
+
+    bool popLocal(unsigned worker, size_t& item) {
+        WorkQueue& queue = queues_[worker];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.items.empty()) return false;
+        item = queue.items.back();
+        queue.items.pop_back();
+        return true;
+    }
+
+    bool steal(unsigned thief, size_t& item) {
+        for (size_t offset = 1; offset < queues_.size(); ++offset) {
+            WorkQueue& victim = queues_[(thief + offset) % queues_.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.items.empty()) {
+                item = victim.items.front();
+                victim.items.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // No work is added once the run starts, so a worker that finds every deque empty is done.
+    void workerLoop(unsigned worker, const std::function<void(size_t, unsigned)>& work) {
+        size_t item;
+        while (popLocal(worker, item) || steal(worker, item)) work(item, worker);
+    }
+
+    std::vector<WorkQueue> queues_;
+};
+
+struct PlantRunResult {
+    int plant_id = 0;
+    int status = 1;
+    double seconds = 0.0;
+    unsigned worker = 0;
+};
+
+void printBatchSummary(const std::vector<PlantRunResult>& results, unsigned worker_count, double wall_seconds) {
+    double total_seconds = 0.0;
+    const PlantRunResult* slowest = nullptr;
+    int failures = 0;
+    for (const PlantRunResult& result : results) {
+        total_seconds += result.seconds;
+        if (!slowest || result.seconds > slowest->seconds) slowest = &result;
+        if (result.status != 0) ++failures;
+    }
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Batch summary: " << results.size() << " plants on " << worker_count << " workers in "
+              << wall_seconds << " s (" << total_seconds << " s of plant time, " << failures << " failed)" << std::endl;
+    for (const PlantRunResult& result : results) {
+        std::cout << "  Plant " << result.plant_id << ": " << result.seconds << " s on worker " << result.worker
+                  << (result.status == 0 ? "" : " FAILED") << std::endl;
+    }
+    if (slowest) std::cout << "  Slowest: Plant " << slowest->plant_id << " (" << slowest->seconds << " s)" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+}
+
+// Processes several plants across all cores. Each plant still goes through processPlant, so the
+// files it writes are the same as for a single-plant run. Workers and view threads are sized together:
+// either several workers with inline views, or one worker sharing its views with the view pool.
+int processPlantBatch(const std::vector<int>& plant_ids, const FrameHandoff* handoff = nullptr) {
+    TRACE_SPAN("processPlantBatch");
+    if (plant_ids.empty()) {
+        std::cerr << "Warning: Batch contains no plants." << std::endl;
+        return 0;
+    }
+
+    unsigned worker_count = std::min<unsigned>(std::max(1u, std::thread::hardware_concurrency()), plant_ids.size());
+    std::vector<PlantRunResult> results(plant_ids.size());
+    // One worker per core at most; a single worker still fans its views out to the view pool.
+    bool inline_views = worker_count > 1;
+
+    // Plants already run in parallel across workers and views; OpenCV's own parallel_for would
+    // only add threads competing for the same cores.
+    int previous_cv_threads = cv::getNumThreads();
+    cv::setNumThreads(1);
+
+    auto batch_start = std::chrono::steady_clock::now();
+    WorkStealingScheduler scheduler(worker_count);
+    scheduler.seed(plant_ids.size());
+    scheduler.run([&](size_t index, unsigned worker) {
+        run_view_tasks_inline = inline_views;
+        PlantRunResult& result = results[index];
+        result.plant_id = plant_ids[index];
+        result.worker = worker;
+        auto start = std::chrono::steady_clock::now();
+        try {
+            const PlantFrames* frames = nullptr;
+            if (handoff) {
+                auto found = handoff->find(result.plant_id);
+                if (found != handoff->end()) frames = &found->second;
+            }
+            result.status = processPlant(result.plant_id, frames);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: Plant ID " << result.plant_id << " failed: " << e.what() << std::endl;
+            result.status = 1;
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    });
+    double wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - batch_start).count();
+    run_view_tasks_inline = false; // worker 0 is this thread
 
-    std::cout << "Image generation and graphing complete for Plant ID: " << plant_id << std::endl;
+    cv::setNumThreads(previous_cv_threads);
 
+    printBatchSummary(results, worker_count, wall_seconds);
+    for (const PlantRunResult& result : results) {
+        if (result.status != 0) return 1;
+    }
     return 0;
 }
+
+// Parses a "<plant_id><position>" token such as "12Z".
+bool parseViewToken(const std::string& token, int& plant_id, int& view) {
+    if (token.size() < 2) return false;
+    view = viewForPosition(token.back());
+    plant_id = std::atoi(token.c_str());
+    return view >= 0 && plant_id > 0;
+}
+
+// Maps the memfds that came with a request to the frames named after its " FRAMES" marker
+// (view tokens in descriptor order) and queues their disk copies.
+bool buildFrameHandoff(const std::string& frame_list, const std::vector<int>& fds, FrameHandoff& handoff) {
+    std::istringstream tokens(frame_list);
+    std::string token;
+    size_t index = 0;
+    while (tokens >> token) {
+        int plant_id, view;
+        if (index >= fds.size() || !parseViewToken(token, plant_id, view)) return false;
+
+        EncodedFrame frame = std::make_shared<MappedFile>(fds[index++]);
+        if (!frame->data()) continue;
+        handoff[plant_id].encoded[view] = frame;
+        notePlaceholderReplaced(plant_id, view);
+        persistFrameAsync(plant_id, view, frame);
+    }
+    return true;
+}
+
+// Flags the views listed after " MISSING" (or in --missing, comma separated) as camera offline.
+bool markMissingViews(std::string view_list, FrameHandoff& handoff) {
+    std::replace(view_list.begin(), view_list.end(), ',', ' ');
+    std::istringstream tokens(view_list);
+    std::string token;
+    while (tokens >> token) {
+        int plant_id, view;
+        if (!parseViewToken(token, plant_id, view)) return false;
+        handoff[plant_id].missing[view] = true;
+    }
+    return true;
+}
+
+// Executes one capture request line: "<plant_id>" processes a capture and "BATCH <ids>" processes
+// several plants (see parsePlantIdList). A BATCH line may continue with " FRAMES <view tokens>",
+// with one memfd per frame passed alongside (see FrameHandoff), and " MISSING <view tokens>".
+// "RENDER <plant_id>" requests are queued by queueArtifactRender instead.
+std::string handleServiceRequest(const char* request, const std::vector<int>& fds = {}) {
+    TRACE_SPAN("handleServiceRequest");
+    if (std::strncmp(request, "BATCH ", 6) == 0) {
+        std::string spec(request + 6);
+        spec.erase(std::find(spec.begin(), spec.end(), '\n'), spec.end());
+        FrameHandoff handoff;
+        size_t missing_pos = spec.find(" MISSING ");
+        if (missing_pos != std::string::npos) {
+            if (!markMissingViews(spec.substr(missing_pos + 9), handoff)) return "ERR invalid missing list\n";
+            spec.erase(missing_pos);
+        }
+        size_t frames_pos = spec.find(" FRAMES ");
+        if (frames_pos != std::string::npos) {
+            if (!buildFrameHandoff(spec.substr(frames_pos + 8), fds, handoff)) return "ERR invalid frame list\n";
+            spec.erase(frames_pos);
+        }
+        std::vector<int> plant_ids;
+        if (!parsePlantIdList(spec, plant_ids)) return "ERR invalid plant list\n";
+        return processPlantBatch(plant_ids, &handoff) == 0 ? "OK\n" : "ERR processing failed\n";
+    }
+
+    char* endptr = nullptr;
+    long plant_id = std::strtol(request, &endptr, 10);
+    if (endptr == request || plant_id <= 0 || (*endptr != '\n' && *endptr != '\0')) {
+        return "ERR invalid plant id\n";
+    }
+
+    try {
+        return processPlant(static_cast<int>(plant_id)) == 0 ? "OK\n" : "ERR processing failed\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Request '" << request << "' failed: " << e.what() << std::endl;
+        return "ERR exception\n";
+    }
+}
+
+// Jobs read by the service's accept loop and run in order by its worker thread, so requests keep
+// being read while OpenCV is busy. A capture job answers its client when done; a render job was
+// already answered by queueArtifactRender.
+struct ServiceJob {
+    int client_fd = -1;
+    std::string request;
+    std::vector<int> fds;
+    int render_plant_id = 0;
+};
+
+std::mutex service_mutex;
+std::condition_variable service_cv;
+std::deque<ServiceJob> service_jobs;
+std::set<int> queued_renders; // plants with a render job that has not started yet
+
+// Answers "RENDER <plant_id>" at once: "OK" while the artifacts are current, otherwise "OK queued"
+// after queuing a render unless one for the plant is already waiting. The check and the queuing
+// happen under one lock, so every viewer of a detail page costs at most one pending render.
+std::string queueArtifactRender(const char* id_str) {
+    char* endptr = nullptr;
+    long plant_id = std::strtol(id_str, &endptr, 10);
+    if (endptr == id_str || plant_id <= 0 || plant_id > PLANT_STATE_MAX_PLANTS || (*endptr != '\n' && *endptr != '\0')) {
+        return "ERR invalid plant id\n";
+    }
+
+    std::lock_guard<std::mutex> lock(service_mutex);
+    if (plant_artifacts_fresh(IMAGE_BASE_DIR.c_str(), static_cast<int>(plant_id))) return "OK\n";
+    if (queued_renders.insert(static_cast<int>(plant_id)).second) {
+        ServiceJob job;
+        job.render_plant_id = static_cast<int>(plant_id);
+        service_jobs.push_back(std::move(job));
+        service_cv.notify_one();
+    }
+    return "OK queued\n";
+}
+
+// A render leaves queued_renders when it starts, so a capture landing mid-render queues another
+// one; renderDiagnosticArtifacts returns early if the stamp turns out to be current by then.
+void runServiceWorker() {
+    while (true) {
+        ServiceJob job;
+        {
+            std::unique_lock<std::mutex> lock(service_mutex);
+            service_cv.wait(lock, [] { return !service_jobs.empty(); });
+            job = std::move(service_jobs.front());
+            service_jobs.pop_front();
+            if (job.render_plant_id) queued_renders.erase(job.render_plant_id);
+        }
+
+        if (job.render_plant_id) {
+            try {
+                renderDiagnosticArtifacts(job.render_plant_id);
+            } catch (const std::exception& e) {
+                std::cerr << "Error: Rendering artifacts of Plant ID " << job.render_plant_id << " failed: " << e.what() << std::endl;
+            }
+        } else {
+            std::string reply = handleServiceRequest(job.request.c_str(), job.fds);
+            for (int fd : job.fds) close(fd);
+            if (write(job.client_fd, reply.data(), reply.size()) < 0) {
+                std::cerr << "Warning: Could not reply to client: " << std::strerror(errno) << std::endl;
+            }
+            close(job.client_fd);
+        }
+        flushTrace();
+    }
+}
+
+// Serves plant jobs from application.c and artifact requests from index.cgi over a Unix socket
+// so OpenCV stays loaded between cycles. The client writes one request line (at most
+// SERVICE_MAX_REQUEST_BYTES) and receives "OK\n", "OK queued\n" (RENDER) or "ERR <reason>\n".
+int runService() {
+    fs::create_directories(fs::path(SERVICE_SOCKET_PATH).parent_path());
+    unlink(SERVICE_SOCKET_PATH.c_str());
+
+    int server_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (server_fd < 0) {
+        std::cerr << "Error: Could not create service socket: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, SERVICE_SOCKET_PATH.c_str(), sizeof(addr.sun_path) - 1);
+    if (bind(server_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0 || listen(server_fd, 16) < 0) {
+        std::cerr << "Error: Could not listen on " << SERVICE_SOCKET_PATH << ": " << std::strerror(errno) << std::endl;
+        close(server_fd);
+        return 1;
+    }
+    chmod(SERVICE_SOCKET_PATH.c_str(), 0660);
+    signal(SIGPIPE, SIG_IGN);
+    std::cout << "Listening for plant jobs on " << SERVICE_SOCKET_PATH << std::endl;
+    std::thread(runServiceWorker).detach();
+
+    while (true) {
+        int client_fd = accept4(server_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client_fd < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Error: accept failed: " << std::strerror(errno) << std::endl;
+            continue;
+        }
+
+        std::string request;
+        std::vector<int> fds;
+        char chunk[4096];
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(SERVICE_REQUEST_TIMEOUT_MS);
+        bool timed_out = false;
+        while (request.size() <= SERVICE_MAX_REQUEST_BYTES) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            struct pollfd pfd = {client_fd, POLLIN, 0};
+            int ready = remaining.count() > 0 ? poll(&pfd, 1, static_cast<int>(remaining.count())) : 0;
+            if (ready < 0 && errno == EINTR) continue;
+            if (ready == 0) {
+                timed_out = true;
+                break;
+            }
+            if (ready < 0) break;
+            struct iovec iov = {chunk, sizeof(chunk)};
+            alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int) * MAX_HANDOFF_FRAMES)];
+            struct msghdr msg = {};
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            ssize_t n = recvmsg(client_fd, &msg, MSG_CMSG_CLOEXEC);
+            if (n < 0 && errno == EINTR) continue;
+            for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+                if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+                size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                const int* received = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
+                fds.insert(fds.end(), received, received + count);
+            }
+            if (n <= 0) break;
+            request.append(chunk, static_cast<size_t>(n));
+            if (std::memchr(chunk, '\n', static_cast<size_t>(n))) break;
+        }
+
+        std::string reply;
+        if (timed_out) {
+            std::cerr << "Warning: Dropped a service client that sent no complete request within "
+                      << SERVICE_REQUEST_TIMEOUT_MS << " ms." << std::endl;
+            reply = "ERR timeout\n";
+        } else if (request.size() > SERVICE_MAX_REQUEST_BYTES) {
+            std::cerr << "Warning: Rejected a service request of more than " << SERVICE_MAX_REQUEST_BYTES << " bytes." << std::endl;
+            reply = "ERR request too long\n";
+        } else if (std::strncmp(request.c_str(), "RENDER ", 7) == 0) {
+            reply = queueArtifactRender(request.c_str() + 7);
+        } else {
+            ServiceJob job;
+            job.client_fd = client_fd;
+            job.request = std::move(request);
+            job.fds = std::move(fds);
+            std::lock_guard<std::mutex> lock(service_mutex);
+            service_jobs.push_back(std::move(job));
+            service_cv.notify_one();
+            continue;
+        }
+        for (int fd : fds) close(fd);
+        // index.cgi queues renders without waiting, so a closed peer is not worth a warning.
+        if (write(client_fd, reply.data(), reply.size()) < 0 && errno != EPIPE) {
+            std::cerr << "Warning: Could not reply to client: " << std::strerror(errno) << std::endl;
+        }
+        close(client_fd);
+    }
+}
+
+// Forwards a request line to the resident service. Returns -1 when no service is listening.
+int requestFromService(const std::string& request) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, SERVICE_SOCKET_PATH.c_str(), sizeof(addr.sun_path) - 1);
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    std::string line = request + "\n";
+    char reply[128] = {0};
+    ssize_t n = -1;
+    if (write(fd, line.data(), line.size()) == static_cast<ssize_t>(line.size())) {
+        n = read(fd, reply, sizeof(reply) - 1);
+    }
+    close(fd);
+
+    if (n <= 0) {
+        std::cerr << "Error: No reply from service for request: " << request << std::endl;
+        return 1;
+    }
+    std::cout << "Service reply for '" << request << "': " << reply;
+    return std::strncmp(reply, "OK", 2) == 0 ? 0 : 1;
+}
+
+// benchmark_plant_images.cpp includes this file and supplies its own main.
+#ifndef PLANT_IMAGES_NO_MAIN
+// Soil-coloured frame with a noisy leafy ellipse, for the self-test.
+cv::Mat makeSelfTestPlant(cv::RNG& rng, const cv::Size& size, const cv::Point& center, const cv::Size& axes) {
+    cv::Mat img(size, CV_8UC3, cv::Scalar(45, 75, 110));
+    cv::ellipse(img, center, axes, 0, 0, 360, cv::Scalar(40, 150, 60), cv::FILLED);
+    cv::Mat noise(size, CV_8UC3);
+    rng.fill(noise, cv::RNG::UNIFORM, 0, 20);
+    cv::add(img, noise, img);
+    return img;
+}
+
+// generate_plant_images --self-test: checks segmentGreenCanopy against processGreenThreshold +
+// calculateMeanHueInMask on every BGR colour, on random and synthetic frames with odd widths and on
+// non-continuous ROIs, then the side-view ROI tracking against full-frame passes. install.sh runs
+// it after building; it exits non-zero on any mismatch.
+int runSelfTest() {
+    bool ok = true;
+    int checks = 0;
+
+    // All 2^24 colours, 16 red values per image: column r * 256 + b, row g.
+    for (int r0 = 0; r0 < 256; r0 += 16) {
+        cv::Mat cube(256, 16 * 256, CV_8UC3);
+        for (int g = 0; g < 256; ++g) {
+            uchar* px = cube.ptr<uchar>(g);
+            for (int r = r0; r < r0 + 16; ++r) {
+                for (int b = 0; b < 256; ++b, px += 3) {
+                    px[0] = static_cast<uchar>(b);
+                    px[1] = static_cast<uchar>(g);
+                    px[2] = static_cast<uchar>(r);
+                }
+            }
+        }
+        ok = crossCheckSegmentation(cube, "colour cube r=" + std::to_string(r0)) && ok;
+        ++checks;
+    }
+
+    cv::RNG rng(0x504d5354);
+    const cv::Size sizes[] = {{1, 1}, {7, 3}, {15, 2}, {16, 16}, {17, 5}, {31, 9}, {33, 7}, {317, 241}, {640, 480}, {801, 601}};
+    for (const cv::Size& size : sizes) {
+        std::string label = std::to_string(size.width) + "x" + std::to_string(size.height);
+        cv::Mat random_img(size, CV_8UC3);
+        rng.fill(random_img, cv::RNG::UNIFORM, 0, 256);
+        cv::Mat plant = makeSelfTestPlant(rng, size, cv::Point(size.width / 2, size.height / 2), cv::Size(size.width / 3, size.height / 3));
+        ok = crossCheckSegmentation(random_img, "random " + label) && ok;
+        ok = crossCheckSegmentation(plant, "plant " + label) && ok;
+
+        cv::Mat parent(size.height + 5, size.width + 9, CV_8UC3);
+        rng.fill(parent, cv::RNG::UNIFORM, 0, 256);
+        ok = crossCheckSegmentation(parent(cv::Rect(3, 2, size.width, size.height)), "random ROI " + label) && ok;
+        checks += 3;
+    }
+
+    // Side-view ROI tracking: an unchanged frame reuses the ROI and matches the full-frame pass, and
+    // a larger blob appearing outside the ROI forces the next run back to the full frame.
+    cv::Mat side = makeSelfTestPlant(rng, cv::Size(640, 480), cv::Point(200, 240), cv::Size(60, 120));
+    ViewRoi roi, fresh_roi;
+    ViewAnalysis full, tracked;
+    analyzeSideView(side, roi, full);
+    analyzeSideView(side, roi, tracked);
+    if (tracked.processed_fraction >= 1.0 || !masksEqual(tracked.green_mask, full.green_mask) ||
+        tracked.bbox_width != full.bbox_width || tracked.bbox_height != full.bbox_height) {
+        std::fprintf(stderr, "MISMATCH side-view ROI: tracked run differs from the full-frame run\n");
+        ok = false;
+    }
+    cv::circle(side, cv::Point(520, 240), 100, cv::Scalar(40, 150, 60), cv::FILLED);
+    ViewAnalysis off_roi, reference;
+    analyzeSideView(side, roi, off_roi);
+    analyzeSideView(side, fresh_roi, reference);
+    if (off_roi.processed_fraction < 1.0 || off_roi.bbox_width != reference.bbox_width ||
+        off_roi.bbox_height != reference.bbox_height) {
+        std::fprintf(stderr, "MISMATCH side-view ROI: blob outside the ROI was missed (%.0fx%.0f, expected %.0fx%.0f)\n",
+                     off_roi.bbox_width, off_roi.bbox_height, reference.bbox_width, reference.bbox_height);
+        ok = false;
+    }
+    checks += 2;
+
+    std::cout << (ok ? "Self-test passed (" : "Self-test FAILED (") << checks << " checks)." << std::endl;
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+    initTracing("generate_plant_images");
+
+    if (argc == 2 && std::string(argv[1]) == "--self-test") {
+        return runSelfTest();
+    }
+
+    if (argc == 2 && std::string(argv[1]) == "--serve") {
+        return runService();
+    }
+
+    std::vector<std::string> args(argv + 1, argv + argc);
+    bool local = !args.empty() && args[0] == "--local";
+    if (local) args.erase(args.begin());
+    bool render = !local && args.size() == 2 && args[0] == "--artifacts";
+    bool batch = (args.size() == 2 || (args.size() == 4 && args[2] == "--missing")) && args[0] == "--batch";
+    if (args.size() != 1 && !render && !batch) {
+        std::cerr << "Usage: " << argv[0] << " [--local] <plant_id> | [--local] --batch <all|ids> [--missing <views>] | --artifacts <plant_id> | --serve | --self-test" << std::endl;
+        std::cerr << "Example: " << argv[0] << " 1" << std::endl;
+        std::cerr << "Example: " << argv[0] << " --batch 1,3,5-8 --missing 3Z,5X" << std::endl;
+        return 1;
+    }
+
+    if (batch) {
+        std::vector<int> plant_ids;
+        if (!parsePlantIdList(args[1], plant_ids)) {
+            std::cerr << "Error: Invalid plant list '" << args[1] << "'." << std::endl;
+            return 1;
+        }
+        std::string missing = args.size() == 4 ? args[3] : "";
+        FrameHandoff handoff;
+        if (!markMissingViews(missing, handoff)) {
+            std::cerr << "Error: Invalid missing view list '" << missing << "'." << std::endl;
+            return 1;
+        }
+        if (!local) {
+            std::replace(missing.begin(), missing.end(), ',', ' ');
+            int ret = requestFromService("BATCH " + args[1] + (missing.empty() ? "" : " MISSING " + missing));
+            if (ret != -1) return ret;
+            std::cerr << "Warning: Service not reachable at " << SERVICE_SOCKET_PATH << ". Processing in-process." << std::endl;
+        }
+        return processPlantBatch(plant_ids, &handoff);
+    }
+
+    int plant_id = std::stoi(args.back());
+    if (plant_id <= 0) {
+        std::cerr << "Error: Plant ID must be a positive integer." << std::endl;
+        return 1;
+    }
+
+    if (!local) {
+        int ret = requestFromService((render ? "RENDER " : "") + std::to_string(plant_id));
+        if (ret != -1) return ret;
+        std::cerr << "Warning: Service not reachable at " << SERVICE_SOCKET_PATH << ". Processing in-process." << std::endl;
+    }
+    return render ? renderDiagnosticArtifacts(plant_id) : processPlant(plant_id);
+}
+#endif
@@ -7,12 +7,69 @@
 #include <stdarg.h>
 #include <dirent.h> // For directory listing
 #include <sys/stat.h> // For stat() and S_ISREG()
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <zlib.h>
+
+#include "plant_state.h"
 
 #define PING_FILE "/var/www/html/data/ping.txt"
 #define DEVICES_FILE "/var/www/html/data/devices.txt"
 #define PLANTS_FILE "/var/www/html/data/plants.txt"
 #define PROCESSES_FILE "/var/www/html/data/processes.txt"
 #define IMAGE_BASE_DIR "/var/www/html/data/images/" // Define image base directory for index.c
+#define IMAGE_SERVICE_SOCKET "/run/plant-monitor/generate_plant_images.sock"
+#define PAGES_DIR "/var/www/html/data/pages/" // Pre-rendered pages (index.cgi --prerender)
+
+// Patches the page from the event gateway's stream (gateway.c) instead of reloading it: device
+// rows, the global timer and, on a detail page, the metric values and images of that plant.
+// Images (and their srcset variants) get a ?v= query so the browser fetches the new capture or
+// rendering. Live previews come from the gateway's frame cache and are reloaded every
+// LIVE_PREVIEW_REFRESH_MS while visible.
+// The global timer counts down locally, since pre-rendered pages carry the time they were
+// rendered at, and a pre-rendered detail page asks for its plant's diagnostic images and graphs
+// on load.
+#define LIVE_PREVIEW_REFRESH_MS "5000"
+#define LIVE_UPDATE_SCRIPT \
+    "<script>(function(){" \
+    "var detail=document.getElementById('plantDetail'),detailPlant=detail?+detail.getAttribute('data-plant'):0;" \
+    "var units={canopy_area:' cm^2',color_index:'',height_hp:' cm',width1:' cm',width2:' cm',volumetric_proxy:' cm^3'};" \
+    "function pad(n){return(n<10?'0':'')+n;}" \
+    "function stamp(t){var d=new Date(t*1000);return d.getFullYear()+'-'+pad(d.getMonth()+1)+'-'+pad(d.getDate())+' '+pad(d.getHours())+':'+pad(d.getMinutes())+':'+pad(d.getSeconds());}" \
+    "function setText(cell,text){if(cell.textContent!==text)cell.textContent=text;}" \
+    "var timer=document.getElementById('globalTimer'),skew=0;" \
+    "function showTimer(){if(!timer)return;var start=+timer.getAttribute('data-start'),left=start+(+timer.getAttribute('data-duration'))-Math.floor(Date.now()/1000+skew);" \
+    "setText(timer,!start?'Not Started / Reset':left<=0?'Completed. Click Start All to rerun.':Math.floor(left/60)+' min '+left%60+' sec remaining');}" \
+    "showTimer();setInterval(showTimer,1000);" \
+    "function renderArtifacts(plant){var x=new XMLHttpRequest();x.open('POST','/cgi-bin/index.cgi');" \
+    "x.setRequestHeader('Content-Type','application/x-www-form-urlencoded');x.send('action=render_artifacts&plant_index='+plant);}" \
+    "if(detail&&detail.hasAttribute('data-render-artifacts'))renderArtifacts(detailPlant);" \
+    "if(!window.EventSource)return;" \
+    "function variant(src,suffix){return src.replace(/(\\.\\w+)$/,suffix+'$1');}" \
+    "function refreshImages(pattern,version){if(!detail)return;" \
+    "var imgs=detail.querySelectorAll('img[data-src]');for(var i=0;i<imgs.length;i++){var src=imgs[i].getAttribute('data-src'),v='?v='+version;if(!pattern.test(src))continue;" \
+    "if(imgs[i].hasAttribute('data-variants'))imgs[i].setAttribute('srcset',variant(src,'_thumb')+v+' 160w, '+variant(src,'_mid')+v+' 480w');imgs[i].src=src+v;}" \
+    "var tiles=detail.querySelectorAll('div[role=img]');for(var j=0;j<tiles.length;j++){if(pattern.test(tiles[j].style.backgroundImage))tiles[j].style.backgroundImage='url(\"'+tiles[j].style.backgroundImage.replace(/^url\\([\"']?|[\"']?\\)$/g,'').split('?')[0]+'?v='+version+'\")';}}" \
+    "var events=new EventSource('/cgi-bin/events');" \
+    "events.addEventListener('device',function(e){var d=JSON.parse(e.data),row=document.getElementById('device-'+d.id);" \
+    "if(!row){var rows=document.getElementById('deviceRows');if(!rows)return;var empty=document.getElementById('deviceEmpty');if(empty)empty.parentNode.removeChild(empty);" \
+    "row=rows.insertRow(-1);row.id='device-'+d.id;for(var i=0;i<7;i++)row.insertCell(-1);row.cells[0].textContent=d.id;" \
+    "var img=document.createElement('img');img.className='live-preview';img.width=100;img.height=75;img.alt='Live Image Device '+d.id;img.src='/cgi-bin/preview?device='+d.id;row.cells[6].appendChild(img);}" \
+    "setText(row.cells[1],d.ip);setText(row.cells[2],d.plant_name);setText(row.cells[3],d.position);setText(row.cells[4],stamp(d.last_ping));setText(row.cells[5],d.command);});" \
+    "events.addEventListener('device-removed',function(e){var row=document.getElementById('device-'+JSON.parse(e.data).id);if(row)row.parentNode.removeChild(row);});" \
+    "events.addEventListener('timer',function(e){var t=JSON.parse(e.data);if(!timer)return;" \
+    "timer.setAttribute('data-start',t.start);timer.setAttribute('data-duration',t.duration);skew=t.now-Date.now()/1000;showTimer();});" \
+    "events.addEventListener('metrics',function(e){var m=JSON.parse(e.data);if(m.plant!==detailPlant)return;" \
+    "if(m.metrics){var cells=detail.querySelectorAll('[data-metric]');for(var i=0;i<cells.length;i++){var key=cells[i].getAttribute('data-metric'),v=m.metrics[key];setText(cells[i],v===null||v===undefined?'N/A':v.toFixed(2)+units[key]);}}" \
+    "refreshImages(/_initial_/,m.capture_version);" \
+    "renderArtifacts(m.plant);});" \
+    "events.addEventListener('artifacts',function(e){var a=JSON.parse(e.data);if(a.plant===detailPlant)refreshImages(/_(top|side1|side2)_|_3d_render|_graph\\.png|_metrics_atlas\\.png/,a.version);});" \
+    "events.addEventListener('plants',function(){location.reload();});" \
+    "setInterval(function(){if(document.hidden)return;var imgs=document.querySelectorAll('img.live-preview');" \
+    "for(var i=0;i<imgs.length;i++){var src=imgs[i].getAttribute('src');if(src.indexOf('/cgi-bin/preview')===0)imgs[i].src=src.split('&')[0]+'&t='+Date.now();}}," LIVE_PREVIEW_REFRESH_MS ");" \
+    "})();</script>"
 
 typedef struct { char *name; } plant_lookup_t;
 static plant_lookup_t *plant_names_lookup = NULL;
@@ -30,7 +87,6 @@ typedef struct {
     double volumetric_proxy;
 } MetricData;
 
-
 static void log_cgi_message(const char *format, ...) {
     time_t now = time(NULL);
     struct tm *t = localtime(&now);
@@ -64,14 +120,22 @@ static char *read_file(const char *f) {
     return buf;
 }
 
+// Writes to a per-process temporary file and renames it into place, so the application and the
+// ping endpoint never read a half-written file.
 static int write_file(const char *f, const char *s) {
-    FILE *fp = fopen(f, "w");
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", f, (long)getpid());
+    FILE *fp = fopen(tmp, "w");
     if (!fp) {
-        log_cgi_message("ERR: write %s", f);
+        log_cgi_message("ERR: write %s", tmp);
         return 1;
     }
     fprintf(fp, "%s", s);
-    fclose(fp);
+    if (fclose(fp) != 0 || rename(tmp, f) != 0) {
+        log_cgi_message("ERR: write %s: %s", f, strerror(errno));
+        unlink(tmp);
+        return 1;
+    }
     return 0;
 }
 
@@ -226,8 +290,31 @@ static int parse_metrics_file(const char* filename, MetricData* data) {
     return 1;
 }
 
+// Reads the newest sample from plant_N_metrics.series. Returns -1 if the plant has no series yet.
+static int get_latest_series_metrics(int plant_id, MetricData* latest_data) {
+    char path[512];
+    snprintf(path, sizeof(path), "%splant_%d_metrics.series", IMAGE_BASE_DIR, plant_id);
+    if (access(path, F_OK) != 0) return -1;
+
+    MetricRecord record;
+    if (!plant_series_read_latest(IMAGE_BASE_DIR, (uint32_t)plant_id, &record)) return 0;
+    latest_data->timestamp_t = (time_t)record.timestamp;
+    strftime(latest_data->timestamp_str, sizeof(latest_data->timestamp_str), "%Y%m%d_%H%M%S", localtime(&latest_data->timestamp_t));
+    latest_data->canopy_area = record.canopy_area;
+    latest_data->color_index = record.color_index;
+    latest_data->height_hp = record.height_hp;
+    latest_data->width1 = record.width1;
+    latest_data->width2 = record.width2;
+    latest_data->volumetric_proxy = record.volumetric_proxy;
+    return 1;
+}
+
 // Function to get the latest metrics data for a given plant ID
 static int get_latest_metrics_data(int plant_id, MetricData* latest_data) {
+    int series_found = get_latest_series_metrics(plant_id, latest_data);
+    if (series_found >= 0) return series_found;
+
+    // No series file yet: fall back to the legacy per-run text files.
     char plant_id_prefix[64];
     snprintf(plant_id_prefix, sizeof(plant_id_prefix), "plant_%d_metrics_", plant_id);
     size_t prefix_len = strlen(plant_id_prefix);
@@ -286,14 +373,467 @@ static int get_latest_metrics_data(int plant_id, MetricData* latest_data) {
 }
 
 
-int main(void) {
-    load_plant_names_for_lookup();
-    log_cgi_message("INFO: Initial plant_names_count after load_plant_names_for_lookup: %llu", plant_names_count);
+// Graphs come either as one PNG per metric or, with PLANT_MONITOR_GRAPH_ATLAS=1 in the image service,
+// as tiles of plant_N_metrics_atlas.png laid out like METRIC_GRAPHS in generate_plant_images.cpp.
+#define GRAPH_ATLAS_COLUMNS 2
+#define GRAPH_ATLAS_ROWS 3
+
+static int plant_graph_atlas_exists(int plant_id) {
+    char path[512];
+    struct stat st;
+    snprintf(path, sizeof(path), "%splant_%d_metrics_atlas.png", IMAGE_BASE_DIR, plant_id);
+    return stat(path, &st) == 0;
+}
+
+static void print_metric_graph(int plant_id, int use_atlas, const char *graph_key, int atlas_slot, const char *alt) {
+    if (use_atlas) {
+        printf("<div role=\"img\" aria-label=\"%s\" style=\"width:150px;height:50px;margin:0 auto;"
+               "background:url('/data/images/plant_%d_metrics_atlas.png') -%dpx -%dpx/%dpx %dpx no-repeat;\"></div>",
+               alt, plant_id, (atlas_slot % GRAPH_ATLAS_COLUMNS) * 150, (atlas_slot / GRAPH_ATLAS_COLUMNS) * 50,
+               GRAPH_ATLAS_COLUMNS * 150, GRAPH_ATLAS_ROWS * 50);
+    } else {
+        printf("<img src=\"/data/images/plant_%d_%s_graph.png\" data-src=\"/data/images/plant_%d_%s_graph.png\" width=\"150\" height=\"50\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x50/E0E0E0/333333?text=No+Graph';\" alt=\"%s\">",
+               plant_id, graph_key, plant_id, graph_key, alt);
+    }
+}
+
+// Queues a rendering of the plant's diagnostic images with the image service and returns at
+// once; the event gateway announces the new stamp and open pages reload the images. The socket is
+// non-blocking, so a service busy with a capture batch cannot hold up the CGI.
+static void request_plant_artifacts(int plant_id) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0) return;
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, IMAGE_SERVICE_SOCKET, sizeof(addr.sun_path) - 1);
+    char request[32];
+    int request_len = snprintf(request, sizeof(request), "RENDER %d\n", plant_id);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || write(fd, request, request_len) != request_len) {
+        log_cgi_message("WARN: Could not queue artifacts of plant %d with the image service (%s).", plant_id, strerror(errno));
+    }
+    close(fd);
+}
+
+// Detail page images are shown at 150x150. generate_plant_images writes _thumb (160 px wide) and
+// _mid (480 px) variants next to each image (IMAGE_VARIANTS there), and the browser picks one by
+// pixel density. Images written before the variants existed are served at full size; an image that
+// does not exist yet (e.g. diagnostics rendered after a pre-rendered page) is expected to get them.
+// The error handler falls back from the variants to the full image, then to the placeholder.
+static void print_detail_image(const char *src, const char *placeholder_text, const char *alt) {
+    const char *prefix = "/data/images/";
+    const char *ext = strrchr(src, '.');
+    char thumb[256], mid[256], path[512];
+    struct stat st;
+    int has_variants = 0;
+    if (ext && strncmp(src, prefix, strlen(prefix)) == 0) {
+        snprintf(thumb, sizeof(thumb), "%.*s_thumb%s", (int)(ext - src), src, ext);
+        snprintf(mid, sizeof(mid), "%.*s_mid%s", (int)(ext - src), src, ext);
+        snprintf(path, sizeof(path), "%s%s", IMAGE_BASE_DIR, thumb + strlen(prefix));
+        has_variants = stat(path, &st) == 0;
+        snprintf(path, sizeof(path), "%s%s", IMAGE_BASE_DIR, src + strlen(prefix));
+        if (!has_variants && stat(path, &st) != 0) has_variants = 1;
+    }
+    printf("<img src=\"%s\" data-src=\"%s\"", src, src);
+    if (has_variants) printf(" data-variants srcset=\"%s 160w, %s 480w\" sizes=\"150px\"", thumb, mid);
+    printf(" width=\"150\" height=\"150\" loading=\"lazy\" onerror=\"if(this.hasAttribute('srcset'))this.removeAttribute('srcset');"
+           "else if(this.src.indexOf('https://placehold.co/')!==0)this.src='https://placehold.co/150x150/E0E0E0/333333?text=%s';\" alt=\"%s\">",
+           placeholder_text, alt);
+}
+
+// Prints the dashboard for `state` as of `current_cgi_time`, with the detail panel of plant
+// `display_detail_plant_idx` (0-based) unless it is -1. Pre-rendered pages do not wait for the
+// plant's diagnostic images; the page script asks for them once it is loaded.
+static void render_page(const PlantState *state, int display_detail_plant_idx, time_t current_cgi_time, int prerendered) {
+    long long global_current_timestamp = state->global_timer_start;
+    long long global_set_duration = state->global_timer_duration;
+    char global_timer_status_str[128];
+
+    long long time_remaining = 0;
+    if (global_current_timestamp > 0) {
+        time_remaining = (global_current_timestamp + global_set_duration) - current_cgi_time;
+        if (time_remaining < 0) time_remaining = 0;
+    }
+
+    if (global_current_timestamp == 0) {
+        strcpy(global_timer_status_str, "Not Started / Reset");
+    } else if (time_remaining == 0) {
+        strcpy(global_timer_status_str, "Completed. Click Start All to rerun.");
+    } else {
+        long long minutes_rem = time_remaining / 60;
+        long long seconds_rem = time_remaining % 60;
+        snprintf(global_timer_status_str, sizeof(global_timer_status_str), "%lld min %lld sec remaining", minutes_rem, seconds_rem);
+    }
+
+    long long initial_minutes_value = global_set_duration / 60;
+    if (initial_minutes_value == 0 && global_set_duration > 0) {
+        initial_minutes_value = 1;
+    } else if (global_set_duration == 0) {
+        initial_minutes_value = 60;
+    }
+
+
+    puts("<!DOCTYPE html><html lang=\"en\"><head><meta charset=\"UTF-8\"><meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">"
+         "<title>Morpho-Physiologic Plant Monitor</title><style>"
+         "body{font-family:Arial,sans-serif;background-color:#f0f0f0;color:#333;margin:20px;padding:0;display:flex;flex-direction:column;align-items:center;justify-content:flex-start;min-height:90vh;}"
+         "h1{color:#0056b3;text-align:center;border-bottom:2px solid #0056b3;padding-bottom:10px;margin-bottom:20px;width:80%;max-width:800px;}"
+         "h2{color:#007bff;text-align:center;margin-top:30px;margin-bottom:15px;width:80%;max-width:800px;}"
+         ".container{background-color:#ffffff;padding:30px;border-radius:10px;box-shadow:0 4px 8px rgba(0,0,0,0.1);margin-bottom:20px;width:90%;max-width:900px;box-sizing:border-box;}"
+         "table{width:100%;border-collapse:collapse;margin-top:15px;}"
+         "th,td{border:1px solid #ddd;padding:8px;text-align:left;}"
+         "th{background-color:#f2f2f2;color:#555;}"
+         ".button-group{display:flex;gap:10px;margin-top:10px;justify-content:center;flex-wrap:wrap;}"
+         "button,input[type=\"submit\"]{background-color:#007bff;color:white;padding:8px 15px;border:none;border-radius:5px;cursor:pointer;font-size:1em;transition:background-color 0.3s ease;box-shadow:0 2px 4px rgba(0,0,0,0.1);}"
+         "button:hover,input[type=\"submit\"]:hover{background-color:#0056b3;}"
+         "input[type=\"text\"],input[type=\"number\"]{padding:8px;border:1px solid #ccc;border-radius:5px;margin-right:5px;width:80px;}"
+         ".graph-placeholder{width:150px;height:50px;background-color:#e9ecef;border:1px dashed #adb5bd;display:flex;align-items:center;justify-content:center;font-size:0.8em;color:#6c757d;border-radius:5px;}"
+         ".assign-device-cell { display: flex; flex-wrap: wrap; align-items: center; gap: 10px; }"
+         ".assign-device-row { display: flex; align-items: center; gap: 5px; }"
+         ".plant-panel { margin-top: 10px; }"
+         ".plant-panel h3 { color:#007bff; margin-top: 20px; margin-bottom: 10px; text-align: center; font-size: 1.1em;}"
+         ".plant-panel table { width: 100%; border-collapse: collapse; margin-top: 10px; background-color: #ffffff; box-shadow:0 2px 4px rgba(0,0,0,0.05); border-radius: 8px; overflow: hidden; }"
+         ".plant-panel th, .plant-panel td { padding: 10px; text-align: center; border: 1px solid #f0f0f0; }"
+         ".plant-panel th { background-color: #fafafa; color: #666; font-weight: bold; }"
+         ".plant-panel td img { max_width: 150px; height: auto; display: block; margin: 0 auto; border: none; border-radius: 4px; }"
+         ".plant-panel tr:nth-child(even) { background-color: #fcfcfc; }"
+         "</style></head><body><h1>Morpho-Physiologic Plant Monitor</h1><div class=\"container\"><h2>Connected Devices</h2><table><thead><tr><th>Index</th><th>IP</th><th>Plant Name</th><th>Position</th><th>Last Ping</th><th>Command</th><th>Live Image</th></tr></thead><tbody id=\"deviceRows\">");
+
+    for (uint32_t i = 0; i < state->device_count; ++i) {
+        const PlantStateDevice *device = &state->devices[i];
+        time_t ts = (time_t)device->ping_timestamp;
+        char ts_str[64];
+        strftime(ts_str, sizeof(ts_str), "%Y-%m-%d %H:%M:%S", localtime(&ts));
+        printf("<tr id=\"device-%llu\"><td>%llu</td><td>%s</td><td>%s</td><td>%c</td><td>%s</td><td>%s</td><td><img class=\"live-preview\" src=\"/cgi-bin/preview?device=%llu\" width=\"100\" height=\"75\" onerror=\"this.onerror=null;this.src='https://placehold.co/100x75/E0E0E0/333333?text=No+Feed';\" alt=\"Live Image Device %llu\"></td></tr>\n", device->id, device->id, device->ip, device->plant_name, device->position, ts_str, device->command, device->id, device->id);
+    }
+    if (state->device_total > state->device_count) {
+        printf("<tr><td colspan=\"7\">%llu more devices not shown.</td></tr>\n", state->device_total - state->device_count);
+    } else if (state->device_count == 0) { puts("<tr id=\"deviceEmpty\"><td colspan=\"7\">Error: No devices found or file unreadable.</td></tr>\n"); }
+    puts("</tbody></table></div>"
+         "<div class=\"container\"><h2>Plants</h2><div style=\"text-align: center; margin-bottom: 15px;\">"
+         "<form action=\"/cgi-bin/index.cgi\" method=\"POST\"><label for=\"plantName\">Plant Name:</label>"
+         "<input type=\"text\" id=\"plantName\" name=\"plantName\" placeholder=\"e.g., Basil 1\" required>"
+         "<button type=\"submit\" name=\"action\" value=\"add_plant\">Add Plant</button></form></div>"
+         "<table><thead><tr><th>Name</th><th>Assign Devices</th></tr></thead><tbody>");
+
+    for (int p_idx = 0; p_idx < (int)state->plant_count; ++p_idx) {
+        printf("<tr><td>%s</td><td><div class=\"assign-device-cell\">"
+               "<form class=\"assign-device-row\" action=\"/cgi-bin/index.cgi\" method=\"POST\"><input type=\"hidden\" name=\"plant_index\" value=\"%d\">"
+               "<label for=\"device_id_X_%d\">X:</label><input type=\"number\" id=\"device_id_X_%d\" name=\"device_id\" placeholder=\"ID\" required min=\"0\">"
+               "<button type=\"submit\" name=\"action\" value=\"assign_device_X\">Set X</button></form>"
+               "<form class=\"assign-device-row\" action=\"/cgi-bin/index.cgi\" method=\"POST\"><input type=\"hidden\" name=\"plant_index\" value=\"%d\">"
+               "<label for=\"device_id_Y_%d\">Y:</label><input type=\"number\" id=\"device_id_Y_%d\" name=\"device_id\" placeholder=\"ID\" required min=\"0\">"
+               "<button type=\"submit\" name=\"action\" value=\"assign_device_Y\">Set Y</button></form>"
+               "<form class=\"assign-device-row\" action=\"/cgi-bin/index.cgi\" method=\"POST\"><input type=\"hidden\" name=\"plant_index\" value=\"%d\">"
+               "<label for=\"device_id_Z_%d\">Z:</label><input type=\"number\" id=\"device_id_Z_%d\" name=\"device_id\" placeholder=\"ID\" required min=\"0\">"
+               "<button type=\"submit\" name=\"action\" value=\"assign_device_Z\">Set Z</button></form>"
+               "</td></tr>\n", state->plants[p_idx].name, p_idx, p_idx, p_idx, p_idx, p_idx, p_idx, p_idx, p_idx, p_idx);
+    }
+    if (state->plant_count == 0) { puts("<tr><td colspan=\"2\">Error: No plants found or file unreadable.</td></tr>\n"); }
+    printf("</tbody></table></div>"
+         "<div class=\"container\"><h2>Processes</h2><div class=\"button-group\">"
+         "<form action=\"/cgi-bin/index.cgi\" method=\"POST\" style=\"display:inline;\">"
+         "<label for=\"minutes\">Minutes:</label><input type=\"number\" id=\"minutes\" name=\"minutes\" value=\"%lld\" min=\"1\">"
+         "<button type=\"submit\" name=\"action\" value=\"set_minutes\">Set Duration</button></form>", initial_minutes_value);
+    puts("<form action=\"/cgi-bin/index.cgi\" method=\"POST\" style=\"display:inline;\"><button type=\"submit\" name=\"action\" value=\"start_all_processes\">Start All</button></form>"
+         "<form action=\"/cgi-bin/index.cgi\" method=\"POST\" style=\"display:inline;\"><button type=\"submit\" name=\"action\" value=\"reset_all_processes\">Reset All</button></form>"
+         "</div>");
+    // The page script counts the timer down from the data attributes between timer events.
+    printf("<h3 style=\"text-align: center;\">Global Process Timer: <span id=\"globalTimer\" data-start=\"%lld\" data-duration=\"%lld\">%s</span></h3>",
+           global_current_timestamp, global_set_duration, global_timer_status_str);
+    puts("<table><thead><tr><th>Plant Name</th><th>Details</th></tr></thead><tbody>");
+
+    for (int p_idx = 0; p_idx < (int)state->plant_count; ++p_idx) {
+        printf("<tr><td>%s</td><td>"
+               "<form action=\"/cgi-bin/index.cgi\" method=\"GET\" style=\"display:inline;\">"
+               "<input type=\"hidden\" name=\"plant_detail_idx\" value=\"%d\">"
+               "<button type=\"submit\">Details</button>"
+               "</form></td></tr>\n", state->plants[p_idx].name, p_idx);
+    }
+    if (state->plant_count == 0) { puts("<tr><td colspan=\"2\">Error: No plants found or file unreadable.</td></tr>\n"); }
+    puts("</tbody></table></div>");
+
+    if (display_detail_plant_idx != -1) {
+        MetricData current_plant_metrics = {0};
+        int metrics_found = get_latest_metrics_data(display_detail_plant_idx + 1, &current_plant_metrics);
+        // Stale diagnostic images and graphs are queued now, or by the page script once a pre-rendered
+        // page is viewed; until they arrive the page shows the previous ones (or placeholders).
+        int artifacts_pending = !plant_artifacts_fresh(IMAGE_BASE_DIR, display_detail_plant_idx + 1);
+        if (artifacts_pending && !prerendered) request_plant_artifacts(display_detail_plant_idx + 1);
+        int use_graph_atlas = plant_graph_atlas_exists(display_detail_plant_idx + 1);
+
+        printf("<div class=\"container\" id=\"plantDetail\" data-plant=\"%d\"%s><h2>Details</h2>", display_detail_plant_idx + 1,
+               artifacts_pending && prerendered ? " data-render-artifacts" : "");
+        const char *detail_plant_name = "Unknown Plant";
+        if (display_detail_plant_idx >= 0 && (uint32_t)display_detail_plant_idx < state->plant_count) {
+            detail_plant_name = state->plants[display_detail_plant_idx].name;
+        }
+        printf("<h3>Details for %s</h3>", detail_plant_name);
+        puts("<div class=\"plant-panel\"><h3>Initial Processed Images (X, Y, Z)</h3>");
+        puts("<table><thead><tr><th>X Position</th><th>Y Position</th><th>Z Position</th></tr></thead><tbody><tr>");
+        char img_src_x[256];
+        char img_src_y[256];
+        char img_src_z[256];
+        snprintf(img_src_x, sizeof(img_src_x), "/data/images/plant_%d_initial_X.jpg", display_detail_plant_idx + 1);
+        snprintf(img_src_y, sizeof(img_src_y), "/data/images/plant_%d_initial_Y.jpg", display_detail_plant_idx + 1);
+        snprintf(img_src_z, sizeof(img_src_z), "/data/images/plant_%d_initial_Z.jpg", display_detail_plant_idx + 1);
+        puts("<td>");
+        print_detail_image(img_src_x, "No+X+Image", "Initial X Image");
+        puts("</td><td>");
+        print_detail_image(img_src_y, "No+Y+Image", "Initial Y Image");
+        puts("</td><td>");
+        print_detail_image(img_src_z, "No+Z+Image", "Initial Z Image");
+        puts("</td>");
+        puts("</tr></tbody></table></div>");
+        puts("<div class=\"plant-panel\"><h3>Canopy Area and Color Index (Top-Down View)</h3><table><thead><tr><th>Metric</th><th>Value</th><th>Trend / Image</th></tr></thead><tbody>");
+        char canopy_area_str[32], color_index_str[32];
+        if (metrics_found) {
+            snprintf(canopy_area_str, sizeof(canopy_area_str), "%.2f cm^2", current_plant_metrics.canopy_area);
+            snprintf(color_index_str, sizeof(color_index_str), "%.2f", current_plant_metrics.color_index);
+        } else {
+            strcpy(canopy_area_str, "N/A");
+            strcpy(color_index_str, "N/A");
+        }
+        printf("<tr><td>Canopy Area (Ac)</td><td data-metric=\"canopy_area\">%s</td><td>", canopy_area_str);
+        print_metric_graph(display_detail_plant_idx + 1, use_graph_atlas, "Canopy_Area_Ac", 0, "Canopy Area Graph");
+        puts("</td></tr>");
+        printf("<tr><td>Color Index (Ihue)</td><td data-metric=\"color_index\">%s</td><td>", color_index_str);
+        print_metric_graph(display_detail_plant_idx + 1, use_graph_atlas, "Color_Index_Ihue", 1, "Color Index Graph");
+        puts("</td></tr>");
+        
+        char top_orig_src[256], top_mask_src[256], top_grayscale_src[256], top_edges_src[256], top_green_src[256], top_green_filtered_src[256];
+        snprintf(top_orig_src, sizeof(top_orig_src), "/data/images/plant_%d_initial_Y.jpg", display_detail_plant_idx + 1); // Top original is initial_Y
+        snprintf(top_mask_src, sizeof(top_mask_src), "/data/images/plant_%d_top_mask.jpg", display_detail_plant_idx + 1);
+        snprintf(top_grayscale_src, sizeof(top_grayscale_src), "/data/images/plant_%d_top_grayscale.jpg", display_detail_plant_idx + 1);
+        snprintf(top_edges_src, sizeof(top_edges_src), "/data/images/plant_%d_top_edges.jpg", display_detail_plant_idx + 1);
+        snprintf(top_green_src, sizeof(top_green_src), "/data/images/plant_%d_top_green.jpg", display_detail_plant_idx + 1);
+        snprintf(top_green_filtered_src, sizeof(top_green_filtered_src), "/data/images/plant_%d_top_green_filtered.jpg", display_detail_plant_idx + 1);
+
+        printf("<tr><td>Original Image (Top)</td><td></td><td>");
+        print_detail_image(top_orig_src, "No+Img", "Top-Down Original Image");
+        puts("</td></tr>");
+        printf("<tr><td>Binary Mask (M_top)</td><td></td><td>");
+        print_detail_image(top_mask_src, "No+Mask", "Top-Down Binary Mask");
+        puts("</td></tr>");
+        printf("<tr><td>Grayscale (Top)</td><td></td><td>");
+        print_detail_image(top_grayscale_src, "No+Grayscale", "Top-Down Grayscale Image");
+        puts("</td></tr>");
+        printf("<tr><td>Edges (Top)</td><td></td><td>");
+        print_detail_image(top_edges_src, "No+Edges", "Top-Down Edges Image");
+        puts("</td></tr>");
+        printf("<tr><td>Green Channel (Top)</td><td></td><td>");
+        print_detail_image(top_green_src, "No+Green", "Top-Down Green Channel Image");
+        puts("</td></tr>");
+        printf("<tr><td>Green Filtered (Top)</td><td></td><td>");
+        print_detail_image(top_green_filtered_src, "No+Green+Filtered", "Top-Down Green Filtered Image");
+        puts("</td></tr>");
+        puts("</tbody></table></div>");
+        puts("<div class=\"plant-panel\"><h3>Height and Orthogonal Widths (Side Views)</h3><table><thead><tr><th>Metric</th><th>Value</th><th>Trend / Image</th></tr></thead><tbody>");
+        char height_hp_str[32], width1_str[32], width2_str[32];
+        if (metrics_found) {
+            snprintf(height_hp_str, sizeof(height_hp_str), "%.2f cm", current_plant_metrics.height_hp);
+            snprintf(width1_str, sizeof(width1_str), "%.2f cm", current_plant_metrics.width1);
+            snprintf(width2_str, sizeof(width2_str), "%.2f cm", current_plant_metrics.width2);
+        } else {
+            strcpy(height_hp_str, "N/A");
+            strcpy(width1_str, "N/A");
+            strcpy(width2_str, "N/A");
+        }
+        printf("<tr><td>Height (Hp)</td><td data-metric=\"height_hp\">%s</td><td>", height_hp_str);
+        print_metric_graph(display_detail_plant_idx + 1, use_graph_atlas, "Height_Hp", 2, "Height Graph");
+        puts("</td></tr>");
+        printf("<tr><td>Width 1 (W1)</td><td data-metric=\"width1\">%s</td><td>", width1_str);
+        print_metric_graph(display_detail_plant_idx + 1, use_graph_atlas, "Width_1_W1", 3, "Width 1 Graph");
+        puts("</td></tr>");
+        printf("<tr><td>Width 2 (W2)</td><td data-metric=\"width2\">%s</td><td>", width2_str);
+        print_metric_graph(display_detail_plant_idx + 1, use_graph_atlas, "Width_2_W2", 4, "Width 2 Graph");
+        puts("</td></tr>");
+
+        char side1_orig_src[256], side1_mask_src[256], side1_grayscale_src[256], side1_edges_src[256], side1_green_src[256], side1_green_filtered_src[256];
+        char side2_orig_src[256], side2_mask_src[256], side2_grayscale_src[256], side2_edges_src[256], side2_green_src[256], side2_green_filtered_src[256];
+        snprintf(side1_orig_src, sizeof(side1_orig_src), "/data/images/plant_%d_initial_X.jpg", display_detail_plant_idx + 1); // Side1 original is initial_X
+        snprintf(side1_mask_src, sizeof(side1_mask_src), "/data/images/plant_%d_side1_mask.jpg", display_detail_plant_idx + 1);
+        snprintf(side1_grayscale_src, sizeof(side1_grayscale_src), "/data/images/plant_%d_side1_grayscale.jpg", display_detail_plant_idx + 1);
+        snprintf(side1_edges_src, sizeof(side1_edges_src), "/data/images/plant_%d_side1_edges.jpg", display_detail_plant_idx + 1);
+        snprintf(side1_green_src, sizeof(side1_green_src), "/data/images/plant_%d_side1_green.jpg", display_detail_plant_idx + 1);
+        snprintf(side1_green_filtered_src, sizeof(side1_green_filtered_src), "/data/images/plant_%d_side1_green_filtered.jpg", display_detail_plant_idx + 1);
+
+        snprintf(side2_orig_src, sizeof(side2_orig_src), "/data/images/plant_%d_initial_Z.jpg", display_detail_plant_idx + 1); // Side2 original is initial_Z
+        snprintf(side2_mask_src, sizeof(side2_mask_src), "/data/images/plant_%d_side2_mask.jpg", display_detail_plant_idx + 1);
+        snprintf(side2_grayscale_src, sizeof(side2_grayscale_src), "/data/images/plant_%d_side2_grayscale.jpg", display_detail_plant_idx + 1);
+        snprintf(side2_edges_src, sizeof(side2_edges_src), "/data/images/plant_%d_side2_edges.jpg", display_detail_plant_idx + 1);
+        snprintf(side2_green_src, sizeof(side2_green_src), "/data/images/plant_%d_side2_green.jpg", display_detail_plant_idx + 1);
+        snprintf(side2_green_filtered_src, sizeof(side2_green_filtered_src), "/data/images/plant_%d_side2_green_filtered.jpg", display_detail_plant_idx + 1);
+
+        printf("<tr><td>Original Image (Side 1)</td><td></td><td>");
+        print_detail_image(side1_orig_src, "No+Img", "Side 1 Original Image");
+        puts("</td></tr>");
+        printf("<tr><td>Binary Mask (M_side1)</td><td></td><td>");
+        print_detail_image(side1_mask_src, "No+Mask", "Side 1 Binary Mask");
+        puts("</td></tr>");
+        printf("<tr><td>Grayscale (Side 1)</td><td></td><td>");
+        print_detail_image(side1_grayscale_src, "No+Grayscale", "Side 1 Grayscale Image");
+        puts("</td></tr>");
+        printf("<tr><td>Edges (Side 1)</td><td></td><td>");
+        print_detail_image(side1_edges_src, "No+Edges", "Side 1 Edges Image");
+        puts("</td></tr>");
+        printf("<tr><td>Green Channel (Side 1)</td><td></td><td>");
+        print_detail_image(side1_green_src, "No+Green", "Side 1 Green Channel Image");
+        puts("</td></tr>");
+        printf("<tr><td>Green Filtered (Side 1)</td><td></td><td>");
+        print_detail_image(side1_green_filtered_src, "No+Green+Filtered", "Side 1 Green Filtered Image");
+        puts("</td></tr>");
+        printf("<tr><td>Original Image (Side 2)</td><td></td><td>");
+        print_detail_image(side2_orig_src, "No+Img", "Side 2 Original Image");
+        puts("</td></tr>");
+        printf("<tr><td>Binary Mask (M_side2)</td><td></td><td>");
+        print_detail_image(side2_mask_src, "No+Mask", "Side 2 Binary Mask");
+        puts("</td></tr>");
+        printf("<tr><td>Grayscale (Side 2)</td><td></td><td>");
+        print_detail_image(side2_grayscale_src, "No+Grayscale", "Side 2 Grayscale Image");
+        puts("</td></tr>");
+        printf("<tr><td>Edges (Side 2)</td><td></td><td>");
+        print_detail_image(side2_edges_src, "No+Edges", "Side 2 Edges Image");
+        puts("</td></tr>");
+        printf("<tr><td>Green Channel (Side 2)</td><td></td><td>");
+        print_detail_image(side2_green_src, "No+Green", "Side 2 Green Channel Image");
+        puts("</td></tr>");
+        printf("<tr><td>Green Filtered (Side 2)</td><td></td><td>");
+        print_detail_image(side2_green_filtered_src, "No+Green+Filtered", "Side 2 Green Filtered Image");
+        puts("</td></tr>");
+        puts("</tbody></table></div>");
+        puts("<div class=\"plant-panel\"><h3>Volumetric Estimation (Voxel Sculpting)</h3><table><thead><tr><th>Metric</th><th>Value</th><th>Trend / Image</th></tr></thead><tbody>");
+        char volumetric_proxy_str[32];
+        if (metrics_found) {
+            snprintf(volumetric_proxy_str, sizeof(volumetric_proxy_str), "%.2f cm^3", current_plant_metrics.volumetric_proxy);
+        } else {
+            strcpy(volumetric_proxy_str, "N/A");
+        }
+        printf("<tr><td>Volumetric Proxy (Vp)</td><td data-metric=\"volumetric_proxy\">%s</td><td>", volumetric_proxy_str);
+        print_metric_graph(display_detail_plant_idx + 1, use_graph_atlas, "Volumetric_Proxy_Vp", 5, "Volumetric Proxy Graph");
+        puts("</td></tr>");
+        
+        // Color Index is already displayed above, no need to duplicate here.
+        printf("<tr><td>Color Index (Ihue)</td><td data-metric=\"color_index\">%s</td><td>", color_index_str);
+        print_metric_graph(display_detail_plant_idx + 1, use_graph_atlas, "Color_Index_Ihue", 1, "Color Index Graph");
+        puts("</td></tr>"); // Re-using color_index_str from above
+
+        char volumetric_render_src[256];
+        snprintf(volumetric_render_src, sizeof(volumetric_render_src), "/data/images/plant_%d_3d_render.png", display_detail_plant_idx + 1);
+        printf("<tr><td>3D Reconstructed Model</td><td></td><td>");
+        print_detail_image(volumetric_render_src, "No+3D+Model", "3D Reconstructed Model");
+        puts("</td></tr>");
+        puts("</tbody></table></div>");
+        puts("</div>");
+    }
+    puts(LIVE_UPDATE_SCRIPT);
+    puts("</body></html>");
+}
+
+// Renders a page into a malloc'd buffer instead of stdout.
+static char *render_page_to_buffer(const PlantState *state, int detail_idx, time_t now, size_t *length) {
+    char *buffer = NULL;
+    fflush(stdout);
+    FILE *page = open_memstream(&buffer, length);
+    if (!page) return NULL;
+    FILE *out = stdout;
+    stdout = page;
+    render_page(state, detail_idx, now, 1);
+    stdout = out;
+    if (fclose(page) != 0) {
+        free(buffer);
+        return NULL;
+    }
+    return buffer;
+}
+
+// Writes a page and its gzip variant (path + ".gz"), each to a temporary file that is then renamed
+// into place, so lighttpd never serves a partly written page.
+static int write_page(const char *path, const char *html, size_t length) {
+    char tmp_path[600], gz_path[600];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *fp = fopen(tmp_path, "w");
+    if (!fp) return -1;
+    int ok = fwrite(html, 1, length, fp) == length;
+    ok = fclose(fp) == 0 && ok;
+    if (!ok || rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        return -1;
+    }
+
+    snprintf(gz_path, sizeof(gz_path), "%s.gz", path);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.gz.tmp", path);
+    gzFile gz = gzopen(tmp_path, "wb9");
+    if (!gz) return -1;
+    ok = length == 0 || gzwrite(gz, html, (unsigned)length) == (int)length;
+    ok = gzclose(gz) == Z_OK && ok;
+    if (!ok || rename(tmp_path, gz_path) != 0) {
+        unlink(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+// index.cgi --prerender: writes the dashboard (index.html) and the detail page of every plant
+// (plant_detail_<idx>.html, idx as in ?plant_detail_idx=) to PAGES_DIR with gzip variants, and
+// removes the pages of plants that no longer exist. application.c runs it when the state changes;
+// lighttpd answers GETs of the dashboard from these files (lighttpd.conf).
+static int prerender_pages(void) {
+    PlantState *state = (PlantState*)malloc(sizeof(PlantState));
+    if (!state) return 1;
+    plant_state_load(state, DEVICES_FILE, PLANTS_FILE, PROCESSES_FILE);
+    if (mkdir(PAGES_DIR, 0755) != 0 && errno != EEXIST) {
+        log_cgi_message("ERR: Cannot create %s (%s).", PAGES_DIR, strerror(errno));
+        free(state);
+        return 1;
+    }
+
+    time_t now = time(NULL);
+    int failures = 0;
+    for (int idx = -1; idx < (int)state->plant_count; ++idx) {
+        char path[512];
+        if (idx < 0) snprintf(path, sizeof(path), "%sindex.html", PAGES_DIR);
+        else snprintf(path, sizeof(path), "%splant_detail_%d.html", PAGES_DIR, idx);
+        size_t length = 0;
+        char *html = render_page_to_buffer(state, idx, now, &length);
+        if (!html || write_page(path, html, length) != 0) {
+            log_cgi_message("WARN: Cannot pre-render %s (%s).", path, strerror(errno));
+            failures++;
+        }
+        free(html);
+    }
+
+    DIR *dir = opendir(PAGES_DIR);
+    if (dir) {
+        struct dirent *entry;
+        int idx;
+        while ((entry = readdir(dir))) {
+            if (sscanf(entry->d_name, "plant_detail_%d.", &idx) == 1 && idx >= (int)state->plant_count) {
+                unlinkat(dirfd(dir), entry->d_name, 0);
+            }
+        }
+        closedir(dir);
+    }
+    free(state);
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc == 2 && strcmp(argv[1], "--prerender") == 0) {
+        return prerender_pages();
+    }
 
     char *method = getenv("REQUEST_METHOD");
     char *query_string = getenv("QUERY_STRING");
     int display_detail_plant_idx = -1;
 
+    // lighttpd's 404 handler for a page not pre-rendered yet runs index.cgi?fallback; the page
+    // asked for is then in the query of the original REQUEST_URI.
+    if (query_string && strcmp(query_string, "fallback") == 0) {
+        char *request_uri = getenv("REQUEST_URI");
+        char *original_query = request_uri ? strchr(request_uri, '?') : NULL;
+        query_string = original_query ? original_query + 1 : "";
+    }
+
     if (method && strcmp(method, "GET") == 0 && query_string && strlen(query_string) > 0) {
         char *qs_copy = strdup(query_string);
         char *param_tok, *param_rest = qs_copy;
@@ -329,6 +869,22 @@ int main(void) {
             else if (strcmp(key, "plant_index") == 0) plant_idx_str = val;
         }
 
+        // Background refresh from the live update script after a new capture of the plant on
+        // display: queues its diagnostic images, which the event gateway announces once rendered.
+        // The image service coalesces repeated requests for a plant.
+        if (strcmp(action, "render_artifacts") == 0) {
+            int plant_id = atoi(plant_idx_str);
+            if (plant_id < 1 || plant_id > PLANT_STATE_MAX_PLANTS) {
+                puts("Status: 400 Bad Request\n");
+            } else if (plant_artifacts_fresh(IMAGE_BASE_DIR, plant_id)) {
+                puts("Status: 204 No Content\n");
+            } else {
+                request_plant_artifacts(plant_id);
+                puts("Status: 202 Accepted\n");
+            }
+            exit(0);
+        }
+
         if (strcmp(action, "add_plant") == 0 && strlen(plant_name) > 0) {
             if (!plant_name_exists(plant_name)) { FILE *fp = fopen(PLANTS_FILE, "a"); if (fp) { fprintf(fp, "%s,%lld,%lld\n", plant_name, (long long)0, (long long)3600); fclose(fp); } }
         } else if (strncmp(action, "assign_device_", 14) == 0 && strlen(dev_id_str) > 0) {
@@ -424,321 +980,20 @@ int main(void) {
             exit(0);
         }
         load_plant_names_for_lookup();
-        puts("Status: 302 Found\nLocation: /cgi-bin/index.cgi\n\n");
+        // Rendered by the CGI rather than served pre-rendered (see lighttpd.conf), so the page
+        // already shows the change while application.c is still re-rendering the static pages.
+        puts("Status: 302 Found\nLocation: /cgi-bin/index.cgi?updated=1\n\n");
         exit(0);
     } else {
-        time_t current_cgi_time = time(NULL);
-
-        char *processes_content = read_file(PROCESSES_FILE);
-        long long global_current_timestamp = 0;
-        long long global_set_duration = 3600;
-        char global_timer_status_str[128];
-
-        if (processes_content) {
-            char *temp_content = strdup(processes_content);
-            if (temp_content) {
-                char *ts_curr_str = strtok(temp_content, ",");
-                char *ts_set_str = strtok(NULL, "\n");
-                if (ts_curr_str) global_current_timestamp = strtoll(ts_curr_str, NULL, 10);
-                if (ts_set_str) global_set_duration = strtoll(ts_set_str, NULL, 10);
-                free(temp_content);
-            } else {
-                log_cgi_message("ERR: strdup failed for processes_content in GET request.");
-            }
-            free(processes_content);
-        }
-
-        long long time_remaining = 0;
-        if (global_current_timestamp > 0) {
-            time_remaining = (global_current_timestamp + global_set_duration) - current_cgi_time;
-            if (time_remaining < 0) time_remaining = 0;
-        }
-
-        if (global_current_timestamp == 0) {
-            strcpy(global_timer_status_str, "Not Started / Reset");
-        } else if (time_remaining == 0) {
-            strcpy(global_timer_status_str, "Completed. Click Start All to rerun.");
-        } else {
-            long long minutes_rem = time_remaining / 60;
-            long long seconds_rem = time_remaining % 60;
-            snprintf(global_timer_status_str, sizeof(global_timer_status_str), "%lld min %lld sec remaining", minutes_rem, seconds_rem);
-        }
-
-        long long initial_minutes_value = global_set_duration / 60;
-        if (initial_minutes_value == 0 && global_set_duration > 0) {
-            initial_minutes_value = 1;
-        } else if (global_set_duration == 0) {
-            initial_minutes_value = 60;
-        }
-
-
-        puts("Content-Type: text/html\n\n"
-             "<!DOCTYPE html><html lang=\"en\"><head><meta charset=\"UTF-8\"><meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">"
-             "<title>Morpho-Physiologic Plant Monitor</title><style>"
-             "body{font-family:Arial,sans-serif;background-color:#f0f0f0;color:#333;margin:20px;padding:0;display:flex;flex-direction:column;align-items:center;justify-content:flex-start;min-height:90vh;}"
-             "h1{color:#0056b3;text-align:center;border-bottom:2px solid #0056b3;padding-bottom:10px;margin-bottom:20px;width:80%;max-width:800px;}"
-             "h2{color:#007bff;text-align:center;margin-top:30px;margin-bottom:15px;width:80%;max-width:800px;}"
-             ".container{background-color:#ffffff;padding:30px;border-radius:10px;box-shadow:0 4px 8px rgba(0,0,0,0.1);margin-bottom:20px;width:90%;max-width:900px;box-sizing:border-box;}"
-             "table{width:100%;border-collapse:collapse;margin-top:15px;}"
-             "th,td{border:1px solid #ddd;padding:8px;text-align:left;}"
-             "th{background-color:#f2f2f2;color:#555;}"
-             ".button-group{display:flex;gap:10px;margin-top:10px;justify-content:center;flex-wrap:wrap;}"
-             "button,input[type=\"submit\"]{background-color:#007bff;color:white;padding:8px 15px;border:none;border-radius:5px;cursor:pointer;font-size:1em;transition:background-color 0.3s ease;box-shadow:0 2px 4px rgba(0,0,0,0.1);}"
-             "button:hover,input[type=\"submit\"]:hover{background-color:#0056b3;}"
-             "input[type=\"text\"],input[type=\"number\"]{padding:8px;border:1px solid #ccc;border-radius:5px;margin-right:5px;width:80px;}"
-             ".graph-placeholder{width:150px;height:50px;background-color:#e9ecef;border:1px dashed #adb5bd;display:flex;align-items:center;justify-content:center;font-size:0.8em;color:#6c757d;border-radius:5px;}"
-             ".assign-device-cell { display: flex; flex-wrap: wrap; align-items: center; gap: 10px; }"
-             ".assign-device-row { display: flex; align-items: center; gap: 5px; }"
-             ".plant-panel { margin-top: 10px; }"
-             ".plant-panel h3 { color:#007bff; margin-top: 20px; margin-bottom: 10px; text-align: center; font-size: 1.1em;}"
-             ".plant-panel table { width: 100%; border-collapse: collapse; margin-top: 10px; background-color: #ffffff; box-shadow:0 2px 4px rgba(0,0,0,0.05); border-radius: 8px; overflow: hidden; }"
-             ".plant-panel th, .plant-panel td { padding: 10px; text-align: center; border: 1px solid #f0f0f0; }"
-             ".plant-panel th { background-color: #fafafa; color: #666; font-weight: bold; }"
-             ".plant-panel td img { max_width: 150px; height: auto; display: block; margin: 0 auto; border: none; border-radius: 4px; }"
-             ".plant-panel tr:nth-child(even) { background-color: #fcfcfc; }"
-             "</style></head><body><h1>Morpho-Physiologic Plant Monitor</h1><div class=\"container\"><h2>Connected Devices</h2><table><thead><tr><th>Index</th><th>IP</th><th>Plant Name</th><th>Position</th><th>Last Ping</th><th>Command</th><th>Live Image</th></tr></thead><tbody>");
-
-        char *dev_content = read_file(DEVICES_FILE);
-        if (dev_content) {
-            char *line, *r_line = dev_content;
-            while ( (line = strtok_r(r_line, "\n", &r_line)) ) {
-                char *id_s, *ip_s, *p_id_s, *plant_name_s, *pos_s, *ts_s, *cmd_s;
-                char *t_line = strdup(line);
-                
-                id_s = strtok(t_line, ",");
-                ip_s = strtok(NULL, ",");
-                p_id_s = strtok(NULL, ",");
-                plant_name_s = strtok(NULL, ",");
-                pos_s = strtok(NULL, ",");
-                ts_s = strtok(NULL, ",");
-                cmd_s = strtok(NULL, "\n");
-
-                if (id_s && ip_s && p_id_s && plant_name_s && pos_s && ts_s && cmd_s) {
-                    uint64_t id = strtoull(id_s, NULL, 10);
-                    uint8_t p_id = (uint8_t)strtoul(p_id_s, NULL, 10);
-                    char pos = pos_s[0];
-                    uint64_t ts = strtoull(ts_s, NULL, 10);
-                    char ts_str[64];
-                    strftime(ts_str, sizeof(ts_str), "%Y-%m-%d %H:%M:%S", localtime((time_t*)&ts));
-                    printf("<tr><td>%llu</td><td>%s</td><td>%s</td><td>%c</td><td>%s</td><td>%s</td><td><img src=\"http://%s/\" width=\"100\" height=\"75\" onerror=\"this.onerror=null;this.src='https://placehold.co/100x75/E0E0E0/333333?text=No+Feed';\" alt=\"Live Image Device %llu\"></td></tr>\n", id, ip_s, plant_name_s, pos, ts_str, cmd_s, ip_s, id);
-                }
-                free(t_line);
-            }
-            free(dev_content);
-        } else { puts("<tr><td colspan=\"7\">Error: No devices found or file unreadable.</td></tr>\n"); }
-        puts("</tbody></table></div>"
-             "<div class=\"container\"><h2>Plants</h2><div style=\"text-align: center; margin-bottom: 15px;\">"
-             "<form action=\"/cgi-bin/index.cgi\" method=\"POST\"><label for=\"plantName\">Plant Name:</label>"
-             "<input type=\"text\" id=\"plantName\" name=\"plantName\" placeholder=\"e.g., Basil 1\" required>"
-             "<button type=\"submit\" name=\"action\" value=\"add_plant\">Add Plant</button></form></div>"
-             "<table><thead><tr><th>Name</th><th>Assign Devices</th></tr></thead><tbody>");
-
-        char *plant_content = read_file(PLANTS_FILE);
-        if (plant_content) {
-            char *line, *r_line = plant_content;
-            int p_idx = 0;
-            while ( (line = strtok_r(r_line, "\n", &r_line)) ) {
-                char *name = strtok(line, ",");
-                if (name) {
-                    printf("<tr><td>%s</td><td><div class=\"assign-device-cell\">"
-                           "<form class=\"assign-device-row\" action=\"/cgi-bin/index.cgi\" method=\"POST\"><input type=\"hidden\" name=\"plant_index\" value=\"%d\">"
-                           "<label for=\"device_id_X_%d\">X:</label><input type=\"number\" id=\"device_id_X_%d\" name=\"device_id\" placeholder=\"ID\" required min=\"0\">"
-                           "<button type=\"submit\" name=\"action\" value=\"assign_device_X\">Set X</button></form>"
-                           "<form class=\"assign-device-row\" action=\"/cgi-bin/index.cgi\" method=\"POST\"><input type=\"hidden\" name=\"plant_index\" value=\"%d\">"
-                           "<label for=\"device_id_Y_%d\">Y:</label><input type=\"number\" id=\"device_id_Y_%d\" name=\"device_id\" placeholder=\"ID\" required min=\"0\">"
-                           "<button type=\"submit\" name=\"action\" value=\"assign_device_Y\">Set Y</button></form>"
-                           "<form class=\"assign-device-row\" action=\"/cgi-bin/index.cgi\" method=\"POST\"><input type=\"hidden\" name=\"plant_index\" value=\"%d\">"
-                           "<label for=\"device_id_Z_%d\">Z:</label><input type=\"number\" id=\"device_id_Z_%d\" name=\"device_id\" placeholder=\"ID\" required min=\"0\">"
-                           "<button type=\"submit\" name=\"action\" value=\"assign_device_Z\">Set Z</button></form>"
-                           "</td></tr>\n", name, p_idx, p_idx, p_idx, p_idx, p_idx, p_idx);
-                }
-                p_idx++;
-            }
-            free(plant_content);
-        } else { puts("<tr><td colspan=\"2\">Error: No plants found or file unreadable.</td></tr>\n"); }
-        puts("</tbody></table></div>"
-             "<div class=\"container\"><h2>Processes</h2><div class=\"button-group\">"
-             "<form action=\"/cgi-bin/index.cgi\" method=\"POST\" style=\"display:inline;\">"
-             "<label for=\"minutes\">Minutes:</label><input type=\"number\" id=\"minutes\" name=\"minutes\" value=\"%lld\" min=\"1\">"
-             "<button type=\"submit\" name=\"action\" value=\"set_minutes\">Set Duration</button></form>"
-             "<form action=\"/cgi-bin/index.cgi\" method=\"POST\" style=\"display:inline;\"><button type=\"submit\" name=\"action\" value=\"start_all_processes\">Start All</button></form>"
-             "<form action=\"/cgi-bin/index.cgi\" method=\"POST\" style=\"display:inline;\"><button type=\"submit\" name=\"action\" value=\"reset_all_processes\">Reset All</button></form>"
-             "</div>");
-        printf("<h3 style=\"text-align: center;\">Global Process Timer: <span id=\"globalTimer\">%s</span></h3>", global_timer_status_str);
-        puts("<table><thead><tr><th>Plant Name</th><th>Details</th></tr></thead><tbody>");
-
-        char *plants_file_process_content = read_file(PLANTS_FILE);
-        if (plants_file_process_content) {
-            char *line_copy = strdup(plants_file_process_content);
-            char *line, *r_line = line_copy;
-            int p_idx = 0;
-            while ( (line = strtok_r(r_line, "\n", &r_line)) ) {
-                char *name, *status_s, *duration_s;
-                char *t_line = strdup(line);
-                name = strtok(t_line, ","); status_s = strtok(NULL, ","); duration_s = strtok(NULL, "\n");
-                if (name && status_s) {
-                    printf("<tr><td>%s</td><td>"
-                           "<form action=\"/cgi-bin/index.cgi\" method=\"GET\" style=\"display:inline;\">"
-                           "<input type=\"hidden\" name=\"plant_detail_idx\" value=\"%d\">"
-                           "<button type=\"submit\">Details</button>"
-                           "</form></td></tr>\n", name, p_idx);
-                }
-                free(t_line);
-                p_idx++;
-            }
-            free(line_copy);
-            free(plants_file_process_content);
-        } else { puts("<tr><td colspan=\"2\">Error: No plants found or file unreadable.</td></tr>\n"); }
-        puts("</tbody></table></div>");
-
-        if (display_detail_plant_idx != -1) {
-            MetricData current_plant_metrics = {0};
-            int metrics_found = get_latest_metrics_data(display_detail_plant_idx + 1, &current_plant_metrics);
-
-            puts("<div class=\"container\"><h2>Details</h2>");
-            char *plants_content_for_details = read_file(PLANTS_FILE);
-            char *detail_plant_name = "Unknown Plant";
-            if (plants_content_for_details) {
-                char *line_ptr = plants_content_for_details;
-                int current_idx = 0;
-                char line_buffer[256];
-                char *temp_line_ptr;
-                while(current_idx <= display_detail_plant_idx && (temp_line_ptr = strchr(line_ptr, '\n')) != NULL) {
-                    size_t len = temp_line_ptr - line_ptr;
-                    if (len >= sizeof(line_buffer)) len = sizeof(line_buffer) - 1;
-                    strncpy(line_buffer, line_ptr, len);
-                    line_buffer[len] = '\0';
-                    if (current_idx == display_detail_plant_idx) {
-                        char *name_token = strtok(line_buffer, ",");
-                        if (name_token) { detail_plant_name = strdup(name_token); }
-                        break;
-                    }
-                    line_ptr = temp_line_ptr + 1;
-                    current_idx++;
-                }
-                if (current_idx == display_detail_plant_idx && detail_plant_name == (char*)"Unknown Plant" && strlen(line_ptr) > 0) {
-                    strncpy(line_buffer, line_ptr, sizeof(line_buffer) - 1);
-                    line_buffer[sizeof(line_buffer) - 1] = '\0';
-                    char *name_token = strtok(line_buffer, ",");
-                    if (name_token) { detail_plant_name = strdup(name_token); }
-                }
-            }
-            printf("<h3>Details for %s</h3>", detail_plant_name);
-            puts("<div class=\"plant-panel\"><h3>Initial Processed Images (X, Y, Z)</h3>");
-            puts("<table><thead><tr><th>X Position</th><th>Y Position</th><th>Z Position</th></tr></thead><tbody><tr>");
-            char img_src_x[256];
-            char img_src_y[256];
-            char img_src_z[256];
-            snprintf(img_src_x, sizeof(img_src_x), "/data/images/plant_%d_initial_X.jpg", display_detail_plant_idx + 1);
-            snprintf(img_src_y, sizeof(img_src_y), "/data/images/plant_%d_initial_Y.jpg", display_detail_plant_idx + 1);
-            snprintf(img_src_z, sizeof(img_src_z), "/data/images/plant_%d_initial_Z.jpg", display_detail_plant_idx + 1);
-            puts("<td>");
-            printf("<img src=\"%s\" width=\"150\" height=\"150\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x150/E0E0E0/333333?text=No+X+Image';\" alt=\"Initial X Image\"></td></tr>", img_src_x);
-            puts("</td><td>");
-            printf("<img src=\"%s\" width=\"150\" height=\"150\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x150/E0E0E0/333333?text=No+Y+Image';\" alt=\"Initial Y Image\"></td></tr>", img_src_y);
-            puts("</td><td>");
-            printf("<img src=\"%s\" width=\"150\" height=\"150\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x150/E0E0E0/333333?text=No+Z+Image';\" alt=\"Initial Z Image\"></td></tr>", img_src_z);
-            puts("</td>");
-            puts("</tr></tbody></table></div>");
-            puts("<div class=\"plant-panel\"><h3>Canopy Area and Color Index (Top-Down View)</h3><table><thead><tr><th>Metric</th><th>Value</th><th>Trend / Image</th></tr></thead><tbody>");
-            char canopy_area_str[32], color_index_str[32];
-            if (metrics_found) {
-                snprintf(canopy_area_str, sizeof(canopy_area_str), "%.2f cm^2", current_plant_metrics.canopy_area);
-                snprintf(color_index_str, sizeof(color_index_str), "%.2f", current_plant_metrics.color_index);
-            } else {
-                strcpy(canopy_area_str, "N/A");
-                strcpy(color_index_str, "N/A");
-            }
-            printf("<tr><td>Canopy Area (Ac)</td><td>%s</td><td><img src=\"/data/images/plant_%d_Canopy_Area_Ac_graph.png\" width=\"150\" height=\"50\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x50/E0E0E0/333333?text=No+Graph';\" alt=\"Canopy Area Graph\"></td></tr>",
-                   canopy_area_str, display_detail_plant_idx + 1);
-            printf("<tr><td>Color Index (Ihue)</td><td>%s</td><td><img src=\"/data/images/plant_%d_Color_Index_Ihue_graph.png\" width=\"150\" height=\"50\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x50/E0E0E0/333333?text=No+Graph';\" alt=\"Color Index Graph\"></td></tr>",
-                   color_index_str, display_detail_plant_idx + 1);
-            
-            char top_orig_src[256], top_mask_src[256], top_grayscale_src[256], top_edges_src[256], top_green_src[256], top_green_filtered_src[256];
-            snprintf(top_orig_src, sizeof(top_orig_src), "/data/images/plant_%d_initial_Y.jpg", display_detail_plant_idx + 1); // Top original is initial_Y
-            snprintf(top_mask_src, sizeof(top_mask_src), "/data/images/plant_%d_top_mask.jpg", display_detail_plant_idx + 1);
-            snprintf(top_grayscale_src, sizeof(top_grayscale_src), "/data/images/plant_%d_top_grayscale.jpg", display_detail_plant_idx + 1);
-            snprintf(top_edges_src, sizeof(top_edges_src), "/data/images/plant_%d_top_edges.jpg", display_detail_plant_idx + 1);
-            snprintf(top_green_src, sizeof(top_green_src), "/data/images/plant_%d_top_green.jpg", display_detail_plant_idx + 1);
-            snprintf(top_green_filtered_src, sizeof(top_green_filtered_src), "/data/images/plant_%d_top_green_filtered.jpg", display_detail_plant_idx + 1);
-
-            printf("<tr><td>Original Image (Top)</td><td></td><td><img src=\"%s\" width=\"150\" height=\"150\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x150/E0E0E0/333333?text=No+Img';\" alt=\"Top-Down Original Image\"></td></tr>", top_orig_src);
-            printf("<tr><td>Binary Mask (M_top)</td><td></td><td><img src=\"%s\" width=\"150\" height=\"150\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x150/E0E0E0/333333?text=No+Mask';\" alt=\"Top-Down Binary Mask\"></td></tr>", top_mask_src);
-            printf("<tr><td>Grayscale (Top)</td><td></td><td><img src=\"%s\" width=\"150\" height=\"150\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x150/E0E0E0/333333?text=No+Grayscale';\" alt=\"Top-Down Grayscale Image\"></td></tr>", top_grayscale_src);
-            printf("<tr><td>Edges (Top)</td><td></td><td><img src=\"%s\" width=\"150\" height=\"150\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x150/E0E0E0/333333?text=No+Edges';\" alt=\"Top-Down Edges Image\"></td></tr>", top_edges_src);
-            printf("<tr><td>Green Channel (Top)</td><td></td><td><img src=\"%s\" width=\"150\" height=\"150\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x150/E0E0E0/333333?text=No+Green';\" alt=\"Top-Down Green Channel Image\"></td></tr>", top_green_src);
-            printf("<tr><td>Green Filtered (Top)</td><td></td><td><img src=\"%s\" width=\"150\" height=\"150\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x150/E0E0E0/333333?text=No+Green+Filtered';\" alt=\"Top-Down Green Filtered Image\"></td></tr>", top_green_filtered_src);
-            puts("</tbody></table></div>");
-            puts("<div class=\"plant-panel\"><h3>Height and Orthogonal Widths (Side Views)</h3><table><thead><tr><th>Metric</th><th>Value</th><th>Trend / Image</th></tr></thead><tbody>");
-            char height_hp_str[32], width1_str[32], width2_str[32];
-            if (metrics_found) {
-                snprintf(height_hp_str, sizeof(height_hp_str), "%.2f cm", current_plant_metrics.height_hp);
-                snprintf(width1_str, sizeof(width1_str), "%.2f cm", current_plant_metrics.width1);
-                snprintf(width2_str, sizeof(width2_str), "%.2f cm", current_plant_metrics.width2);
-            } else {
-                strcpy(height_hp_str, "N/A");
-                strcpy(width1_str, "N/A");
-                strcpy(width2_str, "N/A");
-            }
-            printf("<tr><td>Height (Hp)</td><td>%s</td><td><img src=\"/data/images/plant_%d_Height_Hp_graph.png\" width=\"150\" height=\"50\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x50/E0E0E0/333333?text=No+Graph';\" alt=\"Height Graph\"></td></tr>",
-                   height_hp_str, display_detail_plant_idx + 1);
-            printf("<tr><td>Width 1 (W1)</td><td>%s</td><td><img src=\"/data/images/plant_%d_Width_1_W1_graph.png\" width=\"150\" height=\"50\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x50/E0E0E0/333333?text=No+Graph';\" alt=\"Width 1 Graph\"></td></tr>",
-                   width1_str, display_detail_plant_idx + 1);
-            printf("<tr><td>Width 2 (W2)</td><td>%s</td><td><img src=\"/data/images/plant_%d_Width_2_W2_graph.png\" width=\"150\" height=\"50\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x50/E0E0E0/333333?text=No+Graph';\" alt=\"Width 2 Graph\"></td></tr>",
-                   width2_str, display_detail_plant_idx + 1);
-
-            char side1_orig_src[256], side1_mask_src[256], side1_grayscale_src[256], side1_edges_src[256], side1_green_src[256], side1_green_filtered_src[256];
-            char side2_orig_src[256], side2_mask_src[256], side2_grayscale_src[256], side2_edges_src[256], side2_green_src[256], side2_green_filtered_src[256];
-            snprintf(side1_orig_src, sizeof(side1_orig_src), "/data/images/plant_%d_initial_X.jpg", display_detail_plant_idx + 1); // Side1 original is initial_X
-            snprintf(side1_mask_src, sizeof(side1_mask_src), "/data/images/plant_%d_side1_mask.jpg", display_detail_plant_idx + 1);
-            snprintf(side1_grayscale_src, sizeof(side1_grayscale_src), "/data/images/plant_%d_side1_grayscale.jpg", display_detail_plant_idx + 1);
-            snprintf(side1_edges_src, sizeof(side1_edges_src), "/data/images/plant_%d_side1_edges.jpg", display_detail_plant_idx + 1);
-            snprintf(side1_green_src, sizeof(side1_green_src), "/data/images/plant_%d_side1_green.jpg", display_detail_plant_idx + 1);
-            snprintf(side1_green_filtered_src, sizeof(side1_green_filtered_src), "/data/images/plant_%d_side1_green_filtered.jpg", display_detail_plant_idx + 1);
-
-            snprintf(side2_orig_src, sizeof(side2_orig_src), "/data/images/plant_%d_initial_Z.jpg", display_detail_plant_idx + 1); // Side2 original is initial_Z
-            snprintf(side2_mask_src, sizeof(side2_mask_src), "/data/images/plant_%d_side2_mask.jpg", display_detail_plant_idx + 1);
-            snprintf(side2_grayscale_src, sizeof(side2_grayscale_src), "/data/images/plant_%d_side2_grayscale.jpg", display_detail_plant_idx + 1);
-            snprintf(side2_edges_src, sizeof(side2_edges_src), "/data/images/plant_%d_side2_edges.jpg", display_detail_plant_idx + 1);
-            snprintf(side2_green_src, sizeof(side2_green_src), "/data/images/plant_%d_side2_green.jpg", display_detail_plant_idx + 1);
-            snprintf(side2_green_filtered_src, sizeof(side2_green_filtered_src), "/data/images/plant_%d_side2_green_filtered.jpg", display_detail_plant_idx + 1);
-
-            printf("<tr><td>Original Image (Side 1)</td><td></td><td><img src=\"%s\" width=\"150\" height=\"150\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x150/E0E0E0/333333?text=No+Img';\" alt=\"Side 1 Original Image\"></td></tr>", side1_orig_src);
-            printf("<tr><td>Binary Mask (M_side1)</td><td></td><td><img src=\"%s\" width=\"150\" height=\"150\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x150/E0E0E0/333333?text=No+Mask';\" alt=\"Side 1 Binary Mask\"></td></tr>", side1_mask_src);
-            printf("<tr><td>Grayscale (Side 1)</td><td></td><td><img src=\"%s\" width=\"150\" height=\"150\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x150/E0E0E0/333333?text=No+Grayscale';\" alt=\"Side 1 Grayscale Image\"></td></tr>", side1_grayscale_src);
-            printf("<tr><td>Edges (Side 1)</td><td></td><td><img src=\"%s\" width=\"150\" height=\"150\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x150/E0E0E0/333333?text=No+Edges';\" alt=\"Side 1 Edges Image\"></td></tr>", side1_edges_src);
-            printf("<tr><td>Green Channel (Side 1)</td><td></td><td><img src=\"%s\" width=\"150\" height=\"150\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x150/E0E0E0/333333?text=No+Green';\" alt=\"Side 1 Green Channel Image\"></td></tr>", side1_green_src);
-            printf("<tr><td>Green Filtered (Side 1)</td><td></td><td><img src=\"%s\" width=\"150\" height=\"150\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x150/E0E0E0/333333?text=No+Green+Filtered';\" alt=\"Side 1 Green Filtered Image\"></td></tr>", side1_green_filtered_src);
-            printf("<tr><td>Original Image (Side 2)</td><td></td><td><img src=\"%s\" width=\"150\" height=\"150\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x150/E0E0E0/333333?text=No+Img';\" alt=\"Side 2 Original Image\"></td></tr>", side2_orig_src);
-            printf("<tr><td>Binary Mask (M_side2)</td><td></td><td><img src=\"%s\" width=\"150\" height=\"150\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x150/E0E0E0/333333?text=No+Mask';\" alt=\"Side 2 Binary Mask\"></td></tr>", side2_mask_src);
-            printf("<tr><td>Grayscale (Side 2)</td><td></td><td><img src=\"%s\" width=\"150\" height=\"150\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x150/E0E0E0/333333?text=No+Grayscale';\" alt=\"Side 2 Grayscale Image\"></td></tr>", side2_grayscale_src);
-            printf("<tr><td>Edges (Side 2)</td><td></td><td><img src=\"%s\" width=\"150\" height=\"150\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x150/E0E0E0/333333?text=No+Edges';\" alt=\"Side 2 Edges Image\"></td></tr>", side2_edges_src);
-            printf("<tr><td>Green Channel (Side 2)</td><td></td><td><img src=\"%s\" width=\"150\" height=\"150\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x150/E0E0E0/333333?text=No+Green';\" alt=\"Side 2 Green Channel Image\"></td></tr>", side2_green_src);
-            printf("<tr><td>Green Filtered (Side 2)</td><td></td><td><img src=\"%s\" width=\"150\" height=\"150\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x150/E0E0E0/333333?text=No+Green+Filtered';\" alt=\"Side 2 Green Filtered Image\"></td></tr>", side2_green_filtered_src);
-            puts("</tbody></table></div>");
-            puts("<div class=\"plant-panel\"><h3>Volumetric Estimation (Voxel Sculpting)</h3><table><thead><tr><th>Metric</th><th>Value</th><th>Trend / Image</th></tr></thead><tbody>");
-            char volumetric_proxy_str[32];
-            if (metrics_found) {
-                snprintf(volumetric_proxy_str, sizeof(volumetric_proxy_str), "%.2f cm^3", current_plant_metrics.volumetric_proxy);
-            } else {
-                strcpy(volumetric_proxy_str, "N/A");
-            }
-            printf("<tr><td>Volumetric Proxy (Vp)</td><td>%s</td><td><img src=\"/data/images/plant_%d_Volumetric_Proxy_Vp_graph.png\" width=\"150\" height=\"50\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x50/E0E0E0/333333?text=No+Graph';\" alt=\"Volumetric Proxy Graph\"></td></tr>",
-                   volumetric_proxy_str, display_detail_plant_idx + 1);
-            
-            // Color Index is already displayed above, no need to duplicate here.
-            printf("<tr><td>Color Index (Ihue)</td><td>%s</td><td><img src=\"/data/images/plant_%d_Color_Index_Ihue_graph.png\" width=\"150\" height=\"50\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x50/E0E0E0/333333?text=No+Graph';\" alt=\"Color Index Graph\"></td></tr>",
-                   color_index_str, display_detail_plant_idx + 1); // Re-using color_index_str from above
-
-            char volumetric_render_src[256];
-            snprintf(volumetric_render_src, sizeof(volumetric_render_src), "/data/images/plant_%d_3d_render.png", display_detail_plant_idx + 1);
-            printf("<tr><td>3D Reconstructed Model</td><td></td><td><img src=\"%s\" width=\"150\" height=\"150\" onerror=\"this.onerror=null;this.src='https://placehold.co/150x150/E0E0E0/333333?text=No+3D+Model';\" alt=\"3D Reconstructed Model\"></td></tr>", volumetric_render_src);
-            puts("</tbody></table></div>");
-            if (detail_plant_name != (char*)"Unknown Plant") { free(detail_plant_name); }
-            if (plants_content_for_details) { free(plants_content_for_details); }
-            puts("</div>");
+        PlantState *state = (PlantState*)malloc(sizeof(PlantState));
+        if (state) plant_state_load(state, DEVICES_FILE, PLANTS_FILE, PROCESSES_FILE);
+        if (!state) {
+            puts("Status: 500 Internal Server Error\nContent-Type: text/plain\n\nOut of memory.");
+            exit(0);
         }
-        puts("</body></html>");
+        fputs("Content-Type: text/html\n\n", stdout);
+        render_page(state, display_detail_plant_idx, time(NULL), 0);
+        free(state);
     }
     free_plant_names_lookup();
     return 0;
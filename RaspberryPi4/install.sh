@@ -20,7 +20,7 @@ sudo apt install -y \
     libx264-dev libfontconfig1-dev libcairo2-dev libgdk-pixbuf2.0-dev libpango1.0-dev \
     libatk1.0-dev libglib2.0-dev libgtk2.0-dev libhdf5-dev libhdf5-103 libtbb-dev \
     libatlas-base-dev gfortran libfaac-dev libmp3lame-dev libvorbis-dev libopenexr-dev \
-    libwebp-dev libopencv-dev network-manager dnsmasq hostapd wget"
+    libwebp-dev libopencv-dev zlib1g-dev network-manager dnsmasq hostapd wget"
 
 echo "Sending Repository's Files"
 scp -r ../RaspberryPi4 "$1":~/
@@ -32,41 +32,76 @@ ssh "$1" << 'EOF_REMOTE_COMMANDS'
 set -x
 
 echo "--- Processing lighttpd.conf ---"
-sudo mv ~/RaspberryPi4/lighttpd.conf /etc/lighttpd/lighttptd.conf
+sudo mv ~/RaspberryPi4/lighttpd.conf /etc/lighttpd/lighttpd.conf
+if ! sudo lighttpd -tt -f /etc/lighttpd/lighttpd.conf; then
+    echo "Error: /etc/lighttpd/lighttpd.conf failed lighttpd's config check."
+    exit 1
+fi
 
 echo "--- Compiling and setting up index.cgi (Web UI) ---"
 sudo mkdir -p /usr/lib/cgi-bin/
-sudo gcc -o /usr/lib/cgi-bin/index.cgi ~/RaspberryPi4/index.c
+sudo gcc -O2 -o /usr/lib/cgi-bin/index.cgi ~/RaspberryPi4/index.c -lz
 sudo chown www-data:www-data /usr/lib/cgi-bin/index.cgi
 sudo chmod 755 /usr/lib/cgi-bin/index.cgi
 
 echo "--- Compiling and setting up ping.cgi (Device Pings) ---"
-sudo gcc -o /usr/lib/cgi-bin/ping.cgi ~/RaspberryPi4/ping.c
+sudo gcc -O2 -o /usr/lib/cgi-bin/ping.cgi ~/RaspberryPi4/ping.c
 sudo chown www-data:www-data /usr/lib/cgi-bin/ping.cgi
 sudo chmod 755 /usr/lib/cgi-bin/ping.cgi
 
+echo "--- Compiling and setting up api.cgi (JSON API) ---"
+sudo gcc -O2 -o /usr/lib/cgi-bin/api.cgi ~/RaspberryPi4/api.c
+sudo chown www-data:www-data /usr/lib/cgi-bin/api.cgi
+sudo chmod 755 /usr/lib/cgi-bin/api.cgi
+
+echo "--- Compiling and setting up the live update gateway (gateway.c) ---"
+sudo gcc -O2 -o /usr/local/bin/gateway ~/RaspberryPi4/gateway.c
+sudo chmod 755 /usr/local/bin/gateway
+
 echo "--- Compiling and setting up application binary ---"
-sudo gcc -o /usr/local/bin/application ~/RaspberryPi4/application.c
+sudo gcc -O2 -o /usr/local/bin/application ~/RaspberryPi4/application.c
 sudo chmod 755 /usr/local/bin/application
 
 echo "--- Compiling and setting up OpenCV image generator (generate_plant_images.cpp) ---"
 if pkg-config opencv4 --cflags --libs >/dev/null 2>&1; then
-    sudo g++ -o /usr/local/bin/generate_plant_images ~/RaspberryPi4/generate_plant_images.cpp $(pkg-config opencv4 --cflags --libs) -lstdc++fs
+    OPENCV_FLAGS=$(pkg-config opencv4 --cflags --libs)
 elif pkg-config opencv --cflags --libs >/dev/null 2>&1; then
-    sudo g++ -o /usr/local/bin/generate_plant_images ~/RaspberryPi4/generate_plant_images.cpp $(pkg-config opencv --cflags --libs) -lstdc++fs
+    OPENCV_FLAGS=$(pkg-config opencv --cflags --libs)
 else
     echo "Error: OpenCV pkg-config not found. Please ensure OpenCV development libraries are installed."
     exit 1
 fi
+sudo g++ -O2 -o /usr/local/bin/generate_plant_images ~/RaspberryPi4/generate_plant_images.cpp $OPENCV_FLAGS -lstdc++fs -pthread
 sudo chmod 755 /usr/local/bin/generate_plant_images
+# The fused segmentation kernel must match the OpenCV reference on this build
+if ! /usr/local/bin/generate_plant_images --self-test; then
+    echo "Error: generate_plant_images --self-test failed."
+    exit 1
+fi
 
-echo "--- Managing application.service ---"
+echo "--- Compiling image pipeline benchmarks (benchmark_plant_images.cpp) ---"
+sudo g++ -O2 -o /usr/local/bin/benchmark_plant_images ~/RaspberryPi4/benchmark_plant_images.cpp $OPENCV_FLAGS -lstdc++fs -pthread
+sudo chmod 755 /usr/local/bin/benchmark_plant_images
+
+echo "--- Managing application.service, generate_plant_images.service, ping.service and gateway.service ---"
 sudo mv ~/RaspberryPi4/application.service /etc/systemd/system/application.service
+sudo mv ~/RaspberryPi4/generate_plant_images.service /etc/systemd/system/generate_plant_images.service
+sudo mv ~/RaspberryPi4/ping.service /etc/systemd/system/ping.service
+sudo mv ~/RaspberryPi4/gateway.service /etc/systemd/system/gateway.service
 sudo systemctl daemon-reload
 
 sudo systemctl stop application.service || true
 sudo systemctl disable application.service || true
 sudo systemctl reset-failed application.service || true
+sudo systemctl stop generate_plant_images.service || true
+sudo systemctl disable generate_plant_images.service || true
+sudo systemctl reset-failed generate_plant_images.service || true
+sudo systemctl stop ping.service || true
+sudo systemctl disable ping.service || true
+sudo systemctl reset-failed ping.service || true
+sudo systemctl stop gateway.service || true
+sudo systemctl disable gateway.service || true
+sudo systemctl reset-failed gateway.service || true
 
 sleep 1
 
@@ -100,7 +135,16 @@ if [ ! -s /var/www/html/data/processes.txt ]; then
     sudo chmod 664 /var/www/html/data/processes.txt # Re-chmod after tee
 fi
 
+# Static dashboard pages for lighttpd until application.service re-renders them
+sudo -u www-data /usr/lib/cgi-bin/index.cgi --prerender || true
+
 
+sudo systemctl enable generate_plant_images.service
+sudo systemctl start generate_plant_images.service
+sudo systemctl enable ping.service
+sudo systemctl start ping.service
+sudo systemctl enable gateway.service
+sudo systemctl start gateway.service
 sudo systemctl enable application.service
 sudo systemctl start application.service
 
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
@@ -5,9 +6,32 @@
 #include <time.h>
 #include <unistd.h> // For access()
 #include <stdarg.h> // Required for va_start, va_end
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
 
-#define PING_FILE "/var/www/html/data/ping.txt"
-#define DEVICES_FILE "/var/www/html/data/devices.txt"
+#include "plant_state.h"
+
+// Overridable at compile time so the SCGI worker and its load generator can run against a scratch
+// directory.
+#ifndef PLANT_MONITOR_DATA_DIR
+#define PLANT_MONITOR_DATA_DIR "/var/www/html/data"
+#endif
+#define PING_FILE PLANT_MONITOR_DATA_DIR "/ping.txt"
+#define DEVICES_FILE PLANT_MONITOR_DATA_DIR "/devices.txt"
+
+// Resident SCGI mode (ping.cgi --scgi <socket>, mod_scgi in lighttpd.conf): commands are answered
+// from an in-memory table rebuilt when the application publishes a new device list in the state
+// segment (plant_state.h), or when devices.txt changes while the application is not running. Pings
+// are appended to ping.txt in one write every PING_FLUSH_INTERVAL_MS instead of once per request.
+#define SCGI_MAX_CONNECTIONS 512
+#define SCGI_REQUEST_MAX 4096
+#define PING_FLUSH_INTERVAL_MS 500
 
 // Helper function for logging with timestamp
 static void log_cgi_message(const char *format, ...) {
@@ -23,8 +47,505 @@ static void log_cgi_message(const char *format, ...) {
     fprintf(stderr, "\n");
 }
 
-// Main function for the ping.c CGI script
-int main(void) {
+// Reads a device's command out of one devices.txt line. Returns 1 and fills id and command when
+// the line has an ID.
+static int parse_device_command(char *line_buffer, uint64_t *id, char *command, size_t command_size) {
+    char *field_token;
+    char *saveptr_field;
+    field_token = strtok_r(line_buffer, ",", &saveptr_field); // ID
+    if (!field_token) return 0;
+    *id = strtoull(field_token, NULL, 10);
+    strtok_r(NULL, ",", &saveptr_field); // IP
+    strtok_r(NULL, ",", &saveptr_field); // Plant ID
+    strtok_r(NULL, ",", &saveptr_field); // Plant Name
+    strtok_r(NULL, ",", &saveptr_field); // Position
+    strtok_r(NULL, ",", &saveptr_field); // Ping Timestamp
+
+    field_token = strtok_r(NULL, "\n", &saveptr_field); // Command
+    snprintf(command, command_size, "%s", field_token ? field_token : "NO_COMMAND");
+    return 1;
+}
+
+// Parses a ping body: a decimal device ID and nothing else.
+static int parse_ping_body(const char *body, uint64_t *id) {
+    char *endptr;
+    *id = strtoull(body, &endptr, 10);
+    return endptr != body && *endptr == '\0';
+}
+
+// Looks a device's command up in the state segment under its seqlock. Returns 1 if found, 0 if
+// the device is not listed, or -1 if the segment cannot answer (not published, capped, or busy).
+static int command_from_state(const PlantState *state, uint64_t id, char *command, size_t command_size) {
+    if (!plant_state_live(state)) return -1;
+    for (int attempt = 0; attempt < PLANT_STATE_SNAPSHOT_ATTEMPTS; ++attempt) {
+        uint64_t sequence = __atomic_load_n(&state->sequence, __ATOMIC_ACQUIRE);
+        if (sequence & 1) {
+            sched_yield();
+            continue;
+        }
+        uint32_t count = state->device_count;
+        int found = state->device_total > count ? -1 : 0;
+        if (count > PLANT_STATE_MAX_DEVICES) count = PLANT_STATE_MAX_DEVICES;
+        char value[sizeof(state->devices[0].command)];
+        for (uint32_t i = 0; i < count; ++i) {
+            if (state->devices[i].id != id) continue;
+            memcpy(value, state->devices[i].command, sizeof(value));
+            found = 1;
+            break;
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&state->sequence, __ATOMIC_RELAXED) != sequence) continue;
+        if (found == 1) {
+            value[sizeof(value) - 1] = '\0';
+            snprintf(command, command_size, "%s", value);
+        }
+        return found;
+    }
+    return -1;
+}
+
+typedef struct { uint64_t id; char command[64]; uint8_t used; } CommandSlot;
+typedef struct {
+    CommandSlot *slots;
+    uint64_t capacity;
+    uint8_t from_state;                // built from the state segment rather than devices.txt
+    int64_t writer_pid;                // segment writer and devices_version it was built from
+    uint64_t devices_version;
+} CommandTable;
+static CommandTable command_table = {NULL, 0, 0, 0, 0};
+static const PlantState *shared_state = NULL;
+static PlantState *state_snapshot = NULL;
+
+typedef struct {
+    int fd;
+    size_t length, sent, response_length;
+    char buffer[SCGI_REQUEST_MAX];
+    char response[128];
+} ScgiConnection;
+
+static char *pending_pings = NULL;
+static size_t pending_pings_length = 0, pending_pings_capacity = 0;
+
+static uint64_t hash_device_id(uint64_t id) { return id * 11400714819323198485ULL; }
+
+static const char *command_for_device(uint64_t id) {
+    if (!command_table.capacity) return NULL;
+    for (uint64_t i = hash_device_id(id) >> 32 & (command_table.capacity - 1);; i = (i + 1) & (command_table.capacity - 1)) {
+        CommandSlot *slot = &command_table.slots[i];
+        if (!slot->used) return NULL;
+        if (slot->id == id) return slot->command;
+    }
+}
+
+static CommandSlot *command_table_alloc(uint64_t entries, uint64_t *capacity_out) {
+    uint64_t capacity = 16;
+    while (capacity < entries * 2) capacity *= 2;
+    *capacity_out = capacity;
+    return (CommandSlot*)calloc(capacity, sizeof(CommandSlot));
+}
+
+// Adds a command unless the ID is already present: the first entry for an ID wins, as in the CGI scan.
+static void command_table_insert(CommandSlot *slots, uint64_t capacity, uint64_t id, const char *command) {
+    uint64_t i = hash_device_id(id) >> 32 & (capacity - 1);
+    while (slots[i].used && slots[i].id != id) i = (i + 1) & (capacity - 1);
+    if (slots[i].used) return;
+    slots[i].used = 1;
+    slots[i].id = id;
+    snprintf(slots[i].command, sizeof(slots[i].command), "%s", command);
+}
+
+static void command_table_replace(CommandSlot *slots, uint64_t capacity) {
+    free(command_table.slots);
+    command_table.slots = slots;
+    command_table.capacity = capacity;
+}
+
+// Rebuilds the command table from the state segment if the application published a device list
+// the table does not reflect yet. Returns 0 if the segment cannot be used (not published or
+// capped), in which case devices.txt stays authoritative.
+static int refresh_command_table_from_state(void) {
+    if (!shared_state || __atomic_load_n(&shared_state->magic, __ATOMIC_ACQUIRE) != PLANT_STATE_MAGIC) return 0;
+    if (command_table.from_state &&
+        __atomic_load_n(&shared_state->devices_version, __ATOMIC_RELAXED) == command_table.devices_version &&
+        __atomic_load_n(&shared_state->writer_pid, __ATOMIC_RELAXED) == command_table.writer_pid) return 1;
+
+    if (!state_snapshot && !(state_snapshot = (PlantState*)malloc(sizeof(PlantState)))) return 0;
+    if (!plant_state_snapshot(shared_state, state_snapshot) || state_snapshot->magic != PLANT_STATE_MAGIC ||
+        state_snapshot->device_total > state_snapshot->device_count) return 0;
+    uint64_t capacity;
+    CommandSlot *slots = command_table_alloc(state_snapshot->device_count, &capacity);
+    if (!slots) {
+        log_cgi_message("ERROR: Could not allocate the command table.");
+        return 0;
+    }
+    for (uint32_t i = 0; i < state_snapshot->device_count; ++i) {
+        const PlantStateDevice *device = &state_snapshot->devices[i];
+        command_table_insert(slots, capacity, device->id, device->command);
+    }
+    command_table_replace(slots, capacity);
+    command_table.from_state = 1;
+    command_table.writer_pid = state_snapshot->writer_pid;
+    command_table.devices_version = state_snapshot->devices_version;
+    return 1;
+}
+
+// Rebuilds the command table from devices.txt.
+static void load_command_table(void) {
+    FILE *devices_file_ptr = fopen(DEVICES_FILE, "r");
+    if (!devices_file_ptr) {
+        log_cgi_message("ERROR: Could not open devices.txt for reading.");
+        return;
+    }
+    char line_buffer[512];
+    uint64_t line_count = 0;
+    while (fgets(line_buffer, sizeof(line_buffer), devices_file_ptr) != NULL) line_count++;
+
+    uint64_t capacity;
+    CommandSlot *slots = command_table_alloc(line_count, &capacity);
+    if (!slots) {
+        log_cgi_message("ERROR: Could not allocate the command table.");
+        fclose(devices_file_ptr);
+        return;
+    }
+    rewind(devices_file_ptr);
+    while (fgets(line_buffer, sizeof(line_buffer), devices_file_ptr) != NULL) {
+        line_buffer[strcspn(line_buffer, "\n")] = 0;
+        uint64_t id;
+        char command[64];
+        if (!parse_device_command(line_buffer, &id, command, sizeof(command))) continue;
+        command_table_insert(slots, capacity, id, command);
+    }
+    fclose(devices_file_ptr);
+    command_table_replace(slots, capacity);
+    command_table.from_state = 0;
+}
+
+// Picks the command source after devices.txt changed (and at startup): the state segment while
+// the application that publishes it is running, devices.txt otherwise.
+static void reload_command_table(void) {
+    if (!shared_state) shared_state = plant_state_map();
+    if (plant_state_live(shared_state) && refresh_command_table_from_state()) return;
+    load_command_table();
+}
+
+static void queue_ping(const char *ip) {
+    size_t length = strlen(ip);
+    if (pending_pings_length + length + 2 > pending_pings_capacity) {
+        size_t capacity = pending_pings_capacity ? pending_pings_capacity * 2 : 4096;
+        while (capacity < pending_pings_length + length + 2) capacity *= 2;
+        char *buffer = (char*)realloc(pending_pings, capacity);
+        if (!buffer) {
+            log_cgi_message("ERROR: Could not queue ping from %s.", ip);
+            return;
+        }
+        pending_pings = buffer;
+        pending_pings_capacity = capacity;
+    }
+    memcpy(pending_pings + pending_pings_length, ip, length);
+    pending_pings[pending_pings_length + length] = '\n';
+    pending_pings_length += length + 1;
+}
+
+// Appends the queued pings to ping.txt in one write.
+static void flush_pings(void) {
+    if (pending_pings_length == 0) return;
+    int fd = open(PING_FILE, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0664);
+    if (fd < 0) {
+        log_cgi_message("ERROR: Could not open ping.txt for writing (%s).", PING_FILE);
+        return;
+    }
+    size_t written = 0;
+    while (written < pending_pings_length) {
+        ssize_t n = write(fd, pending_pings + written, pending_pings_length - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            log_cgi_message("ERROR: Writing ping.txt: %s", strerror(errno));
+            break;
+        }
+        written += (size_t)n;
+    }
+    close(fd);
+    pending_pings_length = 0;
+}
+
+static void scgi_respond(ScgiConnection *connection, const char *status, const char *body) {
+    connection->response_length = (size_t)snprintf(connection->response, sizeof(connection->response),
+                                                   "Status: %s\r\nContent-Type: text/plain\r\n\r\n%s", status, body);
+    if (connection->response_length >= sizeof(connection->response)) connection->response_length = sizeof(connection->response) - 1;
+}
+
+// Handles a request once it is complete. Returns 0 while more input is needed.
+static int scgi_handle(ScgiConnection *connection, int *ping_queued) {
+    char *colon = memchr(connection->buffer, ':', connection->length);
+    if (!colon) {
+        if (connection->length > 10) scgi_respond(connection, "400 Bad Request", "Invalid SCGI request.");
+        return connection->length > 10;
+    }
+    size_t header_length = strtoul(connection->buffer, NULL, 10);
+    char *headers = colon + 1;
+    size_t header_end = (size_t)(headers - connection->buffer) + header_length;
+    if (header_end + 1 > sizeof(connection->buffer) - 1) {
+        scgi_respond(connection, "400 Bad Request", "Invalid SCGI request.");
+        return 1;
+    }
+    if (connection->length < header_end + 1) return 0;
+
+    const char *content_length_str = scgi_header(headers, header_length, "CONTENT_LENGTH");
+    const char *method = scgi_header(headers, header_length, "REQUEST_METHOD");
+    const char *sender_ip = scgi_header(headers, header_length, "REMOTE_ADDR");
+    long content_length = content_length_str ? strtol(content_length_str, NULL, 10) : 0;
+    if (!method || strcmp(method, "POST") != 0) {
+        scgi_respond(connection, "405 Method Not Allowed", "Method Not Allowed. This CGI only accepts POST requests.");
+        return 1;
+    }
+    if (content_length <= 0 || content_length > 1024) {
+        scgi_respond(connection, "400 Bad Request", "Invalid POST data length.");
+        return 1;
+    }
+    char *body = connection->buffer + header_end + 1;
+    if (connection->length < header_end + 1 + (size_t)content_length) return 0;
+    body[content_length] = '\0';
+
+    uint64_t device_id;
+    if (!parse_ping_body(body, &device_id)) {
+        scgi_respond(connection, "400 Bad Request", "Invalid device ping format.");
+        return 1;
+    }
+    queue_ping(sender_ip ? sender_ip : "UNKNOWN_IP");
+    *ping_queued = 1;
+    if (command_table.from_state && !refresh_command_table_from_state()) load_command_table();
+    const char *command = command_for_device(device_id);
+    // Same body as the CGI's puts() calls: an empty line, then the command.
+    char response_body[80];
+    snprintf(response_body, sizeof(response_body), "\n%s\n", command ? command : "NO_COMMAND");
+    scgi_respond(connection, "200 OK", response_body);
+    return 1;
+}
+
+static void scgi_close(int epoll_fd, ScgiConnection *connection, int *connection_count) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, connection->fd, NULL);
+    close(connection->fd);
+    free(connection);
+    (*connection_count)--;
+}
+
+// Resident ping endpoint for lighttpd's mod_scgi, serving one request per connection.
+static int run_scgi_server(const char *socket_path) {
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+    unlink(socket_path);
+    if (listen_fd < 0 || bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(listen_fd, 128) < 0) {
+        log_cgi_message("ERROR: Could not listen on %s: %s", socket_path, strerror(errno));
+        return 1;
+    }
+    chmod(socket_path, 0660);
+
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    int flush_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    int inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (epoll_fd < 0 || flush_fd < 0 || inotify_fd < 0 ||
+        inotify_add_watch(inotify_fd, PLANT_MONITOR_DATA_DIR, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        log_cgi_message("ERROR: Could not set up the event loop: %s", strerror(errno));
+        return 1;
+    }
+    struct epoll_event event = { .events = EPOLLIN };
+    event.data.ptr = &listen_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event);
+    event.data.ptr = &flush_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, flush_fd, &event);
+    event.data.ptr = &inotify_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, inotify_fd, &event);
+
+    reload_command_table();
+    log_cgi_message("ping SCGI worker listening on %s.", socket_path);
+    int connection_count = 0;
+    int flush_armed = 0;
+    while (1) {
+        struct epoll_event ready[64];
+        int n = epoll_wait(epoll_fd, ready, 64, -1);
+        if (n < 0 && errno != EINTR) {
+            log_cgi_message("ERROR: epoll_wait: %s", strerror(errno));
+            return 1;
+        }
+        int ping_queued = 0;
+        for (int i = 0; i < n; ++i) {
+            if (ready[i].data.ptr == &listen_fd) {
+                int fd;
+                while (connection_count < SCGI_MAX_CONNECTIONS &&
+                       (fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                    ScgiConnection *connection = (ScgiConnection*)malloc(sizeof(ScgiConnection));
+                    if (!connection) {
+                        close(fd);
+                        continue;
+                    }
+                    connection->fd = fd;
+                    connection->length = connection->sent = connection->response_length = 0;
+                    struct epoll_event client = { .events = EPOLLIN };
+                    client.data.ptr = connection;
+                    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &client);
+                    connection_count++;
+                }
+            } else if (ready[i].data.ptr == &flush_fd) {
+                uint64_t expirations;
+                if (read(flush_fd, &expirations, sizeof(expirations)) > 0) {
+                    flush_pings();
+                    flush_armed = 0;
+                }
+            } else if (ready[i].data.ptr == &inotify_fd) {
+                char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+                ssize_t length;
+                int reload = 0;
+                while ((length = read(inotify_fd, buffer, sizeof(buffer))) > 0) {
+                    for (char *ptr = buffer; ptr < buffer + length; ptr += sizeof(struct inotify_event) + ((struct inotify_event*)ptr)->len) {
+                        const struct inotify_event *changed = (const struct inotify_event*)ptr;
+                        if ((changed->mask & IN_Q_OVERFLOW) || (changed->len && strcmp(changed->name, "devices.txt") == 0)) reload = 1;
+                    }
+                }
+                if (reload) reload_command_table();
+            } else {
+                ScgiConnection *connection = (ScgiConnection*)ready[i].data.ptr;
+                if (connection->response_length == 0) {
+                    ssize_t received = read(connection->fd, connection->buffer + connection->length, sizeof(connection->buffer) - 1 - connection->length);
+                    if (received < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+                    if (received > 0) connection->length += (size_t)received;
+                    if (!scgi_handle(connection, &ping_queued)) {
+                        if (received <= 0 || connection->length >= sizeof(connection->buffer) - 1) scgi_close(epoll_fd, connection, &connection_count);
+                        continue;
+                    }
+                }
+                ssize_t sent = write(connection->fd, connection->response + connection->sent, connection->response_length - connection->sent);
+                if (sent < 0 && (errno == EAGAIN || errno == EINTR)) sent = 0;
+                if (sent < 0 || (connection->sent += (size_t)sent) == connection->response_length) {
+                    scgi_close(epoll_fd, connection, &connection_count);
+                } else {
+                    struct epoll_event client = { .events = EPOLLOUT };
+                    client.data.ptr = connection;
+                    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, connection->fd, &client);
+                }
+            }
+        }
+        if (ping_queued && !flush_armed) {
+            struct itimerspec flush_at = { {0, 0}, {PING_FLUSH_INTERVAL_MS / 1000, (PING_FLUSH_INTERVAL_MS % 1000) * 1000000L} };
+            timerfd_settime(flush_fd, 0, &flush_at, NULL);
+            flush_armed = 1;
+        }
+    }
+}
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+typedef struct { int fd; uint64_t start_ns; size_t received; char reply[256]; } LoadSlot;
+
+// Opens one connection to the SCGI worker and sends a ping from simulated camera `index`
+// (REMOTE_ADDR 127.0.x.y, device ID = index).
+static int start_load_request(const char *socket_path, long index, int epoll_fd, LoadSlot *slot) {
+    char headers[256], request[512];
+    char body[32], content_length[24], remote_addr[32];
+    snprintf(body, sizeof(body), "%ld", index);
+    snprintf(content_length, sizeof(content_length), "%zu", strlen(body));
+    snprintf(remote_addr, sizeof(remote_addr), "127.0.%ld.%ld", (index / 250) % 250, 1 + index % 250);
+    size_t header_length = 0;
+    const char *pairs[] = { "CONTENT_LENGTH", content_length, "SCGI", "1", "REQUEST_METHOD", "POST", "REMOTE_ADDR", remote_addr };
+    for (size_t i = 0; i < sizeof(pairs) / sizeof(pairs[0]); ++i) {
+        size_t length = strlen(pairs[i]) + 1;
+        memcpy(headers + header_length, pairs[i], length);
+        header_length += length;
+    }
+    int prefix = snprintf(request, sizeof(request), "%zu:", header_length);
+    memcpy(request + prefix, headers, header_length);
+    size_t request_length = (size_t)prefix + header_length;
+    request[request_length++] = ',';
+    memcpy(request + request_length, body, strlen(body));
+    request_length += strlen(body);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+    slot->start_ns = monotonic_ns();
+    if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || write(fd, request, request_length) != (ssize_t)request_length) {
+        fprintf(stderr, "Could not send a request to %s: %s\n", socket_path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    slot->fd = fd;
+    slot->received = 0;
+    struct epoll_event event = { .events = EPOLLIN };
+    event.data.ptr = slot;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    return 0;
+}
+
+// Local load generator for the SCGI worker: ping.cgi --scgi-load <socket> <requests> <concurrency>.
+// Keeps `concurrency` pings in flight from up to 62500 simulated cameras and reports throughput
+// and latency percentiles.
+static int run_scgi_load(const char *socket_path, long requests, int concurrency) {
+    if (requests <= 0 || concurrency <= 0) {
+        fprintf(stderr, "Usage: ping.cgi --scgi-load <socket> <requests> <concurrency>\n");
+        return 1;
+    }
+    if (concurrency > requests) concurrency = (int)requests;
+    uint64_t *latencies = (uint64_t*)malloc((size_t)requests * sizeof(uint64_t));
+    LoadSlot *slots = (LoadSlot*)calloc((size_t)concurrency, sizeof(LoadSlot));
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (!latencies || !slots || epoll_fd < 0) return 1;
+
+    long started = 0, completed = 0, failed = 0;
+    uint64_t start_ns = monotonic_ns();
+    for (int i = 0; i < concurrency; ++i) {
+        if (start_load_request(socket_path, started++ % 62500, epoll_fd, &slots[i]) != 0) return 1;
+    }
+    while (completed < requests) {
+        struct epoll_event ready[64];
+        int n = epoll_wait(epoll_fd, ready, 64, 5000);
+        if (n <= 0) {
+            fprintf(stderr, "No response from %s within 5 s.\n", socket_path);
+            return 1;
+        }
+        for (int i = 0; i < n; ++i) {
+            LoadSlot *slot = (LoadSlot*)ready[i].data.ptr;
+            ssize_t received = read(slot->fd, slot->reply + slot->received, sizeof(slot->reply) - 1 - slot->received);
+            if (received > 0) {
+                slot->received += (size_t)received;
+                if (slot->received < sizeof(slot->reply) - 1) continue;
+            }
+            slot->reply[slot->received] = '\0';
+            if (strncmp(slot->reply, "Status: 200", 11) != 0) failed++;
+            latencies[completed++] = monotonic_ns() - slot->start_ns;
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, slot->fd, NULL);
+            close(slot->fd);
+            if (started < requests && start_load_request(socket_path, started++ % 62500, epoll_fd, slot) != 0) return 1;
+        }
+    }
+    double elapsed_s = (monotonic_ns() - start_ns) / 1e9;
+    qsort(latencies, (size_t)requests, sizeof(uint64_t), compare_u64);
+    printf("%ld requests, %d concurrent: %.0f req/s, p50 %.1f us, p99 %.1f us, max %.1f us, %ld failed\n",
+           requests, concurrency, requests / elapsed_s, latencies[requests / 2] / 1e3,
+           latencies[requests * 99 / 100] / 1e3, latencies[requests - 1] / 1e3, failed);
+    free(latencies);
+    free(slots);
+    return failed ? 1 : 0;
+}
+
+// Main function for the ping.c CGI script. With --scgi <socket> it runs as the resident SCGI
+// worker instead, and --scgi-load drives a running worker for benchmarking.
+int main(int argc, char **argv) {
+    if (argc == 3 && strcmp(argv[1], "--scgi") == 0) return run_scgi_server(argv[2]);
+    if (argc == 5 && strcmp(argv[1], "--scgi-load") == 0) return run_scgi_load(argv[2], strtol(argv[3], NULL, 10), atoi(argv[4]));
+
     log_cgi_message("ping.c CGI (Refactored from Scratch V2) started."); // Very first log
 
     char *method = getenv("REQUEST_METHOD");
@@ -55,13 +576,9 @@ int main(void) {
     }
 
     uint64_t device_id_from_raw_ping = 0;
-    char *endptr;
 
     log_cgi_message("Attempting to parse POST body as raw device ID: '%s'", post_data_buffer);
-    device_id_from_raw_ping = strtoull(post_data_buffer, &endptr, 10);
-    
-    // Check if the entire buffer was consumed by the number and it's not empty
-    if (endptr == post_data_buffer || *endptr != '\0') { // If parsing failed or extra chars exist
+    if (!parse_ping_body(post_data_buffer, &device_id_from_raw_ping)) { // If parsing failed or extra chars exist
         log_cgi_message("POST body is not a valid raw device ID. Returning 400 Bad Request.");
         puts("Status: 400 Bad Request\nContent-Type: text/plain\n\nInvalid device ping format.");
         exit(0);
@@ -81,66 +598,49 @@ int main(void) {
     }
 
     char response_command[64] = "NO_COMMAND";
-    log_cgi_message("Reading devices.txt to find command for device ID %llu.", device_id_from_raw_ping);
-    
-    // --- Read devices.txt content using fgets line by line ---
-    FILE *devices_file_ptr = fopen(DEVICES_FILE, "r");
-    if (devices_file_ptr) {
-        char line_buffer[512]; // Buffer for reading each line
-        int device_found_in_devices_file = 0;
-
-        log_cgi_message("Iterating through devices.txt lines for command lookup.");
-        while (fgets(line_buffer, sizeof(line_buffer), devices_file_ptr) != NULL) {
-            line_buffer[strcspn(line_buffer, "\n")] = 0; // Remove newline
-            
-            char *line_copy_for_parsing = strdup(line_buffer); // Duplicate line for strtok_r
-            if (!line_copy_for_parsing) {
-                log_cgi_message("WARNING: strdup failed for line during command lookup. Skipping line: '%.50s'", line_buffer);
-                continue; 
-            }
+    const PlantState *state = plant_state_map();
+    int state_result = command_from_state(state, device_id_from_raw_ping, response_command, sizeof(response_command));
+    plant_state_unmap(state);
+    if (state_result >= 0) {
+        log_cgi_message("Looked up device ID %llu in the state segment: '%s'.", device_id_from_raw_ping, response_command);
+    } else {
+        log_cgi_message("Reading devices.txt to find command for device ID %llu.", device_id_from_raw_ping);
 
-            char *field_token;
-            char *saveptr_field;
-            uint64_t current_device_id_in_file;
+        // --- Read devices.txt content using fgets line by line ---
+        FILE *devices_file_ptr = fopen(DEVICES_FILE, "r");
+        if (devices_file_ptr) {
+            char line_buffer[512]; // Buffer for reading each line
+            int device_found_in_devices_file = 0;
 
-            log_cgi_message("Parsing line: '%.50s'", line_buffer);
-            field_token = strtok_r(line_copy_for_parsing, ",", &saveptr_field); // ID
-            if (field_token) {
-                current_device_id_in_file = strtoull(field_token, NULL, 10);
+            log_cgi_message("Iterating through devices.txt lines for command lookup.");
+            while (fgets(line_buffer, sizeof(line_buffer), devices_file_ptr) != NULL) {
+                line_buffer[strcspn(line_buffer, "\n")] = 0; // Remove newline
+            
+                uint64_t current_device_id_in_file;
+                char command[sizeof(response_command)];
+                log_cgi_message("Parsing line: '%.50s'", line_buffer);
+                if (!parse_device_command(line_buffer, &current_device_id_in_file, command, sizeof(command))) {
+                    log_cgi_message("WARNING: Could not parse ID from line: '%.50s'", line_buffer);
+                    continue;
+                }
                 log_cgi_message("  Parsed ID: %llu", current_device_id_in_file);
-
                 if (current_device_id_in_file == device_id_from_raw_ping) {
                     device_found_in_devices_file = 1;
-                    strtok_r(NULL, ",", &saveptr_field); // IP
-                    strtok_r(NULL, ",", &saveptr_field); // Plant ID
-                    strtok_r(NULL, ",", &saveptr_field); // Position
-                    strtok_r(NULL, ",", &saveptr_field); // Ping Timestamp
-                    
-                    field_token = strtok_r(NULL, "\n", &saveptr_field); // Command
-                    if (field_token) {
-                        strncpy(response_command, field_token, sizeof(response_command) - 1);
-                        response_command[sizeof(response_command) - 1] = '\0';
-                        log_cgi_message("  Found command '%s' for device ID %llu.", response_command, device_id_from_raw_ping);
-                    } else {
-                        log_cgi_message("  WARNING: Command field missing for device ID %llu. Defaulting to NO_COMMAND.", device_id_from_raw_ping);
-                    }
-                    free(line_copy_for_parsing);
+                    strcpy(response_command, command);
+                    log_cgi_message("  Found command '%s' for device ID %llu.", response_command, device_id_from_raw_ping);
                     break; // Command found, exit loop
                 }
-            } else {
-                log_cgi_message("WARNING: Could not parse ID from line: '%.50s'", line_buffer);
             }
-            free(line_copy_for_parsing);
-        }
-        fclose(devices_file_ptr);
+            fclose(devices_file_ptr);
 
-        if (!device_found_in_devices_file) {
-            log_cgi_message("Device ID %llu not found in devices.txt. Returning NO_COMMAND.", device_id_from_raw_ping);
+            if (!device_found_in_devices_file) {
+                log_cgi_message("Device ID %llu not found in devices.txt. Returning NO_COMMAND.", device_id_from_raw_ping);
+            }
+        } else {
+            log_cgi_message("ERROR: Could not open devices.txt for reading.");
         }
-    } else {
-        log_cgi_message("ERROR: Could not open devices.txt for reading.");
+        // --- End Read devices.txt ---
     }
-    // --- End Read devices.txt ---
 
     log_cgi_message("Sending plain text response: '%s'. Exiting CGI.", response_command);
     puts("Content-Type: text/plain\nStatus: 200 OK\n\n");
@@ -0,0 +1,311 @@
+// Shared-memory state segment. application.c owns the device registry, the plant list and the
+// global timer and publishes them here in fixed-layout records; index.cgi and ping.cgi map the
+// segment read-only instead of re-parsing devices.txt, plants.txt and processes.txt, which remain
+// the persistence/export format and the fallback while the application is not running.
+//
+// The segment is guarded by a seqlock: the single writer makes `sequence` odd while it updates
+// the records and even again afterwards, and a reader copies what it needs and retries if the
+// sequence was odd or moved meanwhile (see plant_state_snapshot).
+#ifndef PLANT_STATE_H
+#define PLANT_STATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define PLANT_STATE_PATH "/dev/shm/plant-monitor-state"
+#define PLANT_STATE_MAGIC 0x54534d50u   // "PMST"
+#define PLANT_STATE_LAYOUT 2u
+#define PLANT_STATE_MAX_DEVICES 1024
+#define PLANT_STATE_MAX_PLANTS 255
+#define PLANT_STATE_SNAPSHOT_ATTEMPTS 1000
+
+typedef struct {
+    uint64_t id;
+    uint64_t ping_timestamp;
+    char ip[48];
+    char plant_name[128];
+    char command[64];
+    uint8_t plant_id;
+    uint8_t position;
+    int8_t rssi;                       // from the last UDP heartbeat; 0 for HTTP-only devices
+    uint8_t heartbeat_flags;           // HEARTBEAT_FLAG_* from the last UDP heartbeat
+    uint8_t reserved[4];
+} PlantStateDevice;
+
+// Flag bits of a UDP heartbeat (application.c, esp32cam.ino), kept in PlantStateDevice.heartbeat_flags.
+#define HEARTBEAT_FLAG_CAPTURE_READY 0x01
+#define HEARTBEAT_FLAG_REPLY 0x80
+
+typedef struct {
+    char name[128];
+    int64_t remaining_duration;
+    int64_t configured_duration;
+    uint64_t capture_version;          // captures_version after this plant's last capture; 0 if none yet
+    int64_t last_capture;              // Unix time of that capture
+} PlantStatePlant;
+
+typedef struct {
+    uint32_t magic;                    // PLANT_STATE_MAGIC once the first state is published
+    uint32_t layout;
+    uint64_t sequence;                 // seqlock; odd while the writer is updating
+    int64_t writer_pid;
+    uint64_t devices_version, plants_version, processes_version;
+    uint64_t captures_version;         // bumped whenever a capture batch finishes
+    int64_t global_timer_start, global_timer_duration;
+    uint32_t processes_loaded;         // 0 while processes.txt is missing
+    uint32_t device_count;             // records in devices[], in registry order
+    uint64_t device_total;             // devices in the registry; more than device_count if capped
+    uint32_t plant_count;
+    uint32_t reserved;
+    PlantStateDevice devices[PLANT_STATE_MAX_DEVICES];
+    PlantStatePlant plants[PLANT_STATE_MAX_PLANTS];
+} PlantState;
+
+static inline void plant_state_write_begin(PlantState *state) {
+    __atomic_store_n(&state->sequence, state->sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void plant_state_write_end(PlantState *state) {
+    __atomic_store_n(&state->sequence, state->sequence + 1, __ATOMIC_RELEASE);
+}
+
+// Maps the segment read-only. Returns NULL if it does not exist or has another layout.
+static inline const PlantState *plant_state_map(void) {
+    int fd = open(PLANT_STATE_PATH, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(PlantState)) {
+        map = mmap(NULL, sizeof(PlantState), PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+    const PlantState *state = (const PlantState*)map;
+    if (state->layout != PLANT_STATE_LAYOUT) {
+        munmap(map, sizeof(PlantState));
+        return NULL;
+    }
+    return state;
+}
+
+static inline void plant_state_unmap(const PlantState *state) {
+    if (state) munmap((void*)state, sizeof(PlantState));
+}
+
+// Whether the segment holds a published state from an application that is still running. A
+// segment left behind by a stopped application is stale; callers fall back to the text files.
+static inline int plant_state_live(const PlantState *state) {
+    if (!state || __atomic_load_n(&state->magic, __ATOMIC_ACQUIRE) != PLANT_STATE_MAGIC) return 0;
+    pid_t pid = (pid_t)__atomic_load_n(&state->writer_pid, __ATOMIC_RELAXED);
+    return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+// Copies a consistent state into `copy`: the header and the used part of both record arrays.
+// Returns 0 if the writer kept the segment busy for PLANT_STATE_SNAPSHOT_ATTEMPTS tries.
+static inline int plant_state_snapshot(const PlantState *state, PlantState *copy) {
+    for (int attempt = 0; attempt < PLANT_STATE_SNAPSHOT_ATTEMPTS; ++attempt) {
+        uint64_t sequence = __atomic_load_n(&state->sequence, __ATOMIC_ACQUIRE);
+        if (sequence & 1) {
+            sched_yield();
+            continue;
+        }
+        memcpy(copy, state, offsetof(PlantState, devices));
+        if (copy->device_count > PLANT_STATE_MAX_DEVICES) copy->device_count = PLANT_STATE_MAX_DEVICES;
+        if (copy->plant_count > PLANT_STATE_MAX_PLANTS) copy->plant_count = PLANT_STATE_MAX_PLANTS;
+        memcpy(copy->devices, state->devices, copy->device_count * sizeof(PlantStateDevice));
+        memcpy(copy->plants, state->plants, copy->plant_count * sizeof(PlantStatePlant));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&state->sequence, __ATOMIC_RELAXED) == sequence) return 1;
+    }
+    return 0;
+}
+
+static inline char *plant_state_read_text(const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) return NULL;
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *text = size >= 0 ? (char*)malloc((size_t)size + 1) : NULL;
+    if (text) text[fread(text, 1, (size_t)size, fp)] = '\0';
+    fclose(fp);
+    return text;
+}
+
+// Fills a zeroed `state` from the data files, for when the application is not publishing the
+// segment. Records are capped like the segment's; device_total still counts every device line.
+static inline void plant_state_load_files(PlantState *state, const char *devices_path, const char *plants_path, const char *processes_path) {
+    state->global_timer_start = 0;
+    state->global_timer_duration = 3600;
+    char *content = plant_state_read_text(processes_path);
+    if (content) {
+        char *rest = content;
+        char *start_s = strtok_r(rest, ",", &rest);
+        char *duration_s = strtok_r(rest, "\n", &rest);
+        if (start_s) state->global_timer_start = strtoll(start_s, NULL, 10);
+        if (duration_s) state->global_timer_duration = strtoll(duration_s, NULL, 10);
+        state->processes_loaded = 1;
+        free(content);
+    }
+
+    content = plant_state_read_text(devices_path);
+    if (content) {
+        char *line, *lines = content;
+        while ((line = strtok_r(lines, "\n", &lines))) {
+            char *rest = line;
+            char *id_s = strtok_r(rest, ",", &rest);
+            char *ip_s = strtok_r(rest, ",", &rest);
+            char *plant_id_s = strtok_r(rest, ",", &rest);
+            char *plant_name_s = strtok_r(rest, ",", &rest);
+            char *position_s = strtok_r(rest, ",", &rest);
+            char *timestamp_s = strtok_r(rest, ",", &rest);
+            char *command_s = strtok_r(rest, "\n", &rest);
+            if (!(id_s && ip_s && plant_id_s && plant_name_s && position_s && timestamp_s && command_s)) continue;
+            state->device_total++;
+            if (state->device_count >= PLANT_STATE_MAX_DEVICES) continue;
+            PlantStateDevice *device = &state->devices[state->device_count++];
+            device->id = strtoull(id_s, NULL, 10);
+            device->ping_timestamp = strtoull(timestamp_s, NULL, 10);
+            snprintf(device->ip, sizeof(device->ip), "%s", ip_s);
+            snprintf(device->plant_name, sizeof(device->plant_name), "%s", plant_name_s);
+            snprintf(device->command, sizeof(device->command), "%s", command_s);
+            device->plant_id = (uint8_t)strtoul(plant_id_s, NULL, 10);
+            device->position = (uint8_t)position_s[0];
+        }
+        free(content);
+    }
+
+    content = plant_state_read_text(plants_path);
+    if (content) {
+        char *line, *lines = content;
+        while ((line = strtok_r(lines, "\n", &lines)) && state->plant_count < PLANT_STATE_MAX_PLANTS) {
+            char *rest = line;
+            char *name = strtok_r(rest, ",", &rest);
+            char *remaining_s = strtok_r(rest, ",", &rest);
+            char *configured_s = strtok_r(rest, ",", &rest);
+            if (!name) continue;
+            PlantStatePlant *plant = &state->plants[state->plant_count++];
+            snprintf(plant->name, sizeof(plant->name), "%s", name);
+            plant->remaining_duration = remaining_s ? strtoll(remaining_s, NULL, 10) : 0;
+            plant->configured_duration = configured_s ? strtoll(configured_s, NULL, 10) : 3600;
+        }
+        free(content);
+    }
+}
+
+// Fills `state` with a snapshot of the segment if the application is publishing it, otherwise
+// from the data files. Returns 1 for a segment snapshot, 0 for the files.
+static inline int plant_state_load(PlantState *state, const char *devices_path, const char *plants_path, const char *processes_path) {
+    const PlantState *shared = plant_state_map();
+    int from_segment = plant_state_live(shared) && plant_state_snapshot(shared, state) && state->magic == PLANT_STATE_MAGIC;
+    plant_state_unmap(shared);
+    if (from_segment) return 1;
+    memset(state, 0, sizeof(PlantState));
+    plant_state_load_files(state, devices_path, plants_path, processes_path);
+    return 0;
+}
+
+// Diagnostic images and metric graphs of a plant are rendered on demand (generate_plant_images,
+// RENDER request). plant_N_artifacts.stamp holds the modification times the plant's X, Y and Z
+// captures and its metric series (S) had when the rendering started, so the images are current
+// exactly while those files still carry them; a capture or sample that lands mid-render leaves
+// the stamp stale.
+#define PLANT_ARTIFACT_SIGNATURE_SIZE 128
+
+static inline void plant_artifacts_signature(const char *image_dir, int plant_id, char *signature, size_t size) {
+    const char sources[] = {'X', 'Y', 'Z', 'S'};
+    size_t used = 0;
+    signature[0] = '\0';
+    for (size_t i = 0; i < sizeof(sources) && used < size; ++i) {
+        char path[512];
+        struct stat st;
+        if (sources[i] == 'S') snprintf(path, sizeof(path), "%splant_%d_metrics.series", image_dir, plant_id);
+        else snprintf(path, sizeof(path), "%splant_%d_initial_%c.jpg", image_dir, plant_id, sources[i]);
+        if (stat(path, &st) != 0) memset(&st, 0, sizeof(st));
+        int n = snprintf(signature + used, size - used, "%c %lld.%09ld\n", sources[i], (long long)st.st_mtim.tv_sec, (long)st.st_mtim.tv_nsec);
+        if (n < 0) break;
+        used += (size_t)n;
+    }
+}
+
+static inline int plant_artifacts_fresh(const char *image_dir, int plant_id) {
+    char path[512], stamp[PLANT_ARTIFACT_SIGNATURE_SIZE], expected[PLANT_ARTIFACT_SIGNATURE_SIZE];
+    snprintf(path, sizeof(path), "%splant_%d_artifacts.stamp", image_dir, plant_id);
+    FILE *fp = fopen(path, "r");
+    if (!fp) return 0;
+    size_t n = fread(stamp, 1, sizeof(stamp) - 1, fp);
+    fclose(fp);
+    stamp[n] = '\0';
+    plant_artifacts_signature(image_dir, plant_id, expected, sizeof(expected));
+    return strcmp(stamp, expected) == 0;
+}
+
+// Per-plant metric history written by generate_plant_images: plant_N_metrics.series is a
+// SeriesHeader followed by MetricRecords in capture order; older blocks move to the compressed
+// plant_N_metrics.cold file (see generate_plant_images.cpp).
+#define SERIES_MAGIC 0x53544d50u      // "PMTS"
+#define SERIES_VERSION 1u
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t reserved;
+    uint64_t cold_records;
+    uint64_t cold_bytes;
+} SeriesHeader;
+
+typedef struct {
+    int64_t timestamp;
+    double canopy_area;
+    double color_index;
+    double height_hp;
+    double width1;
+    double width2;
+    double volumetric_proxy;
+} MetricRecord;
+
+// Reads the newest sample from <image_dir>plant_N_metrics.series. Returns 1 if there is one.
+static inline int plant_series_read_latest(const char *image_dir, uint32_t plant_id, MetricRecord *record) {
+    char path[512];
+    snprintf(path, sizeof(path), "%splant_%u_metrics.series", image_dir, plant_id);
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return 0;
+    SeriesHeader header;
+    int found = 0;
+    if (fread(&header, sizeof(header), 1, fp) == 1 && header.magic == SERIES_MAGIC &&
+        header.version == SERIES_VERSION && header.record_size == sizeof(MetricRecord) &&
+        fseek(fp, 0, SEEK_END) == 0) {
+        long record_count = (ftell(fp) - (long)sizeof(header)) / (long)sizeof(MetricRecord);
+        found = record_count > 0 &&
+            fseek(fp, (long)sizeof(header) + (record_count - 1) * (long)sizeof(MetricRecord), SEEK_SET) == 0 &&
+            fread(record, sizeof(*record), 1, fp) == 1;
+    }
+    fclose(fp);
+    return found;
+}
+
+// Looks up a header in an SCGI request's netstring-framed header block (ping.cgi, gateway).
+static inline const char *scgi_header(const char *headers, size_t length, const char *name) {
+    const char *end = headers + length;
+    while (headers < end) {
+        const char *value = headers + strlen(headers) + 1;
+        if (value >= end) return NULL;
+        if (strcmp(headers, name) == 0) return value;
+        headers = value + strlen(value) + 1;
+    }
+    return NULL;
+}
+
+#endif